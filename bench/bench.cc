@@ -0,0 +1,927 @@
+#include <benchmark/benchmark.h>
+#include <stream/arena.hh>
+#include <stream/lexer.hh>
+#include <stream/multi_searcher.hh>
+#include <stream/stream.hh>
+#include <stream/symbol_table.hh>
+#include <stream/transcode.hh>
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "corpus.hh"
+
+using namespace streams;
+using namespace std::literals;
+
+// Every primitive is benchmarked next to a plain `std::string_view` loop
+// that does the same work, so that a regression in the stream shows up as
+// a gap between the two rather than needing a baseline from another run.
+//
+// Each function returns a checksum of what it found so that the compiler
+// cannot throw the work away, and so that the stream and baseline versions
+// can be compared by eye if a benchmark looks suspiciously fast.
+
+#ifndef LIBSTREAM_BENCH_MAX_BYTES
+#    define LIBSTREAM_BENCH_MAX_BYTES (std::int64_t(1) << 30)
+#endif
+
+namespace {
+void sizes(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(8)->Range(64, std::int64_t(LIBSTREAM_BENCH_MAX_BYTES));
+}
+
+template <typename CharType = char, typename Callback>
+void run(benchmark::State& state, corpus::kind k, Callback cb) {
+    auto text = corpus::get<CharType>(k, std::size_t(state.range(0)));
+    for (auto _ : state) {
+        auto sum = cb(text);
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(std::int64_t(state.iterations()) * std::int64_t(text.size() * sizeof(CharType)));
+}
+
+// ============================================================================
+//  take_until(char) — counting lines.
+// ============================================================================
+void stream_take_until_char(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty(); s.drop()) sum += s.take_until('\n').size();
+        return sum;
+    });
+}
+
+void baseline_take_until_char(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find('\n'), text.size());
+            sum += pos;
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  take_until(text) — finding a multi-character marker.
+// ============================================================================
+void stream_take_until_text(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty(); s.drop(5)) sum += s.take_until("ERROR"sv).size();
+        return sum;
+    });
+}
+
+void stream_take_until_searcher(benchmark::State& state) {
+    static constexpr searcher<char> error{"ERROR"sv};
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty(); s.drop(5)) sum += s.take_until(error).size();
+        return sum;
+    });
+}
+
+void baseline_take_until_text(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find("ERROR"sv), text.size());
+            sum += pos;
+            text.remove_prefix(std::min(pos + 5, text.size()));
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  take_until(multi_searcher) — finding the first of several needles.
+// ============================================================================
+void stream_take_until_multi(benchmark::State& state) {
+    static const multi_searcher needles{"ERROR"sv, "WARN"sv, "\r\n"sv};
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty(); s.drop(2)) {
+            auto [skipped, which] = s.take_until(needles);
+            sum += skipped.size() + which.value_or(3);
+        }
+        return sum;
+    });
+}
+
+void baseline_take_until_multi(benchmark::State& state) {
+    static constexpr std::array needles{"ERROR"sv, "WARN"sv, "\r\n"sv};
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            std::size_t pos = std::string_view::npos, which = 3;
+            for (std::size_t i = 0; i < needles.size(); ++i) {
+                if (auto p = text.find(needles[i]); p < pos) {
+                    pos = p;
+                    which = i;
+                }
+            }
+
+            pos = std::min(pos, text.size());
+            sum += pos + which;
+            text.remove_prefix(std::min(pos + 2, text.size()));
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  take_kv() — parsing HTTP headers.
+// ============================================================================
+void stream_take_kv(benchmark::State& state) {
+    run(state, corpus::kind::headers, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (auto [name, value] : stream{text}.kv_pairs(':', "\r\n")) sum += name.size() + value.size();
+        return sum;
+    });
+}
+
+void baseline_take_kv(benchmark::State& state) {
+    run(state, corpus::kind::headers, [](std::string_view text) {
+        auto trim = [](std::string_view s) {
+            auto first = s.find_first_not_of(" \t\n\r\v\f");
+            if (first == std::string_view::npos) return std::string_view{};
+            return s.substr(first, s.find_last_not_of(" \t\n\r\v\f") + 1 - first);
+        };
+
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto end = std::min(text.find_first_of("\r\n"), text.size());
+            auto line = text.substr(0, end);
+            text.remove_prefix(std::min(end + 1, text.size()));
+            auto colon = line.find(':');
+            if (colon == std::string_view::npos) continue;
+            sum += trim(line.substr(0, colon)).size() + trim(line.substr(colon + 1)).size();
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  take_until_any() — splitting CSV fields.
+// ============================================================================
+void stream_take_until_any(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty(); s.drop()) sum += s.take_until_any(",\n").size() + 1;
+        return sum;
+    });
+}
+
+void baseline_take_until_any(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find_first_of(",\n"), text.size());
+            sum += pos + 1;
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  take_until(char_set) — the same, with a precompiled set.
+// ============================================================================
+void stream_take_until_set(benchmark::State& state) {
+    static constexpr char_set<char> separators{",\n"sv};
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty(); s.drop()) sum += s.take_until(separators).size() + 1;
+        return sum;
+    });
+}
+
+// ============================================================================
+//  split_into() — the same, a batch of fields at a time.
+// ============================================================================
+void stream_split_into_set(benchmark::State& state) {
+    static constexpr char_set<char> separators{",\n"sv};
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        std::array<std::string_view, 64> fields;
+        for (stream s{text}; not s.empty();)
+            for (auto f : std::span{fields}.first(s.split_into(fields, separators)))
+                sum += f.size() + 1;
+        return sum;
+    });
+}
+
+void stream_classify(benchmark::State& state) {
+    static constexpr char_set<char> separators{",\n"sv};
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        std::array<std::uint64_t, 16> masks;
+        for (stream s{text}; not s.empty();) {
+            auto n = s.classify(separators, masks);
+            for (std::size_t w = 0; w * 64 < n; ++w) sum += std::size_t(std::popcount(masks[w]));
+            s.drop(n);
+        }
+        return sum;
+    });
+}
+
+void baseline_classify(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (auto c : text) sum += c == ',' or c == '\n';
+        return sum;
+    });
+}
+
+void stream_split_into_char(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        std::array<std::string_view, 64> fields;
+        for (stream s{text}; not s.empty();)
+            for (auto f : std::span{fields}.first(s.split_into(fields, ',')))
+                sum += f.size() + 1;
+        return sum;
+    });
+}
+
+void baseline_split_into_char(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find(','), text.size());
+            sum += pos + 1;
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  take_while_any() — skipping indentation and words.
+// ============================================================================
+void stream_take_while_any(benchmark::State& state) {
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty();) {
+            sum += s.take_while_any(" \t\n").size();
+            sum += s.take_until_any(" \t\n").size();
+        }
+        return sum;
+    });
+}
+
+void baseline_take_while_any(benchmark::State& state) {
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto ws = std::min(text.find_first_not_of(" \t\n"), text.size());
+            sum += ws;
+            text.remove_prefix(ws);
+            auto word = std::min(text.find_first_of(" \t\n"), text.size());
+            sum += word;
+            text.remove_prefix(word);
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  take_while(pred) — extracting identifiers.
+// ============================================================================
+void stream_take_while_pred(benchmark::State& state) {
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty();) {
+            s.drop_until(pred::alpha | pred::is('_'));
+            sum += s.take_while(pred::alnum | pred::is('_')).size();
+        }
+        return sum;
+    });
+}
+
+void stream_take_while_lambda(benchmark::State& state) {
+    static constexpr auto ident_start = [](char c) { return (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or c == '_'; };
+    static constexpr auto ident = [](char c) { return ident_start(c) or (c >= '0' and c <= '9'); };
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty();) {
+            s.drop_until(ident_start);
+            sum += s.take_while(ident).size();
+        }
+        return sum;
+    });
+}
+
+void baseline_take_while_pred(benchmark::State& state) {
+    static constexpr auto ident_start = [](char c) { return (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or c == '_'; };
+    static constexpr auto ident = [](char c) { return ident_start(c) or (c >= '0' and c <= '9'); };
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        std::size_t i = 0;
+        while (i < text.size()) {
+            while (i < text.size() and not ident_start(text[i])) ++i;
+            auto start = i;
+            while (i < text.size() and ident(text[i])) ++i;
+            sum += i - start;
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  lexer — tokenising source code.
+// ============================================================================
+using source_lexer = lexer<
+    skip<pred::space, pred::space>,
+    rule<"ident", pred::alpha | pred::is('_'), pred::alnum | pred::is('_')>,
+    rule<"number", pred::digit, pred::digit>,
+    literal<"comment", "//">,
+    literal<"arrow", "->">,
+    literal<"eq", "==">,
+    rule<"punct", pred::punct>
+>;
+
+void stream_lexer(benchmark::State& state) {
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        stream s{text};
+        while (auto tok = source_lexer::next(s)) sum += tok->kind + tok->text.size();
+        return sum;
+    });
+}
+
+void baseline_lexer(benchmark::State& state) {
+    static constexpr auto ident_start = pred::alpha | pred::is('_');
+    static constexpr auto ident = pred::alnum | pred::is('_');
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        stream s{text};
+        auto consume = [&](std::string_view prefix) {
+            if (not s.starts_with(prefix)) return false;
+            s.drop(prefix.size());
+            return true;
+        };
+
+        for (;;) {
+            s.trim_front();
+            if (s.empty()) break;
+            if (ident_start(s.front().value())) sum += 1 + s.take_while(ident).size();
+            else if (pred::digit(s.front().value())) sum += 2 + s.take_while(pred::digit).size();
+            else if (consume("//")) sum += 3 + 2;
+            else if (consume("->")) sum += 4 + 2;
+            else if (consume("==")) sum += 5 + 2;
+            else if (pred::punct(s.front().value())) sum += 6 + s.take().size();
+            else break;
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  symbol_table — interning and looking up identifiers.
+// ============================================================================
+void stream_symbol_intern(benchmark::State& state) {
+    static constexpr auto ident = pred::alnum | pred::is('_');
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        symbol_table table;
+        for (stream s{text}; not s.empty();) {
+            s.drop_until(pred::alpha | pred::is('_'));
+            if (auto name = s.take_while(ident); not name.empty()) sum += table.intern(name);
+        }
+        return sum;
+    });
+}
+
+void stream_symbol_lookup(benchmark::State& state) {
+    static const auto table = [] {
+        symbol_table t;
+        for (auto kw : {"if", "auto", "return", "find", "count", "value"}) t.intern(kw);
+        return t;
+    }();
+
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty();) {
+            s.drop_until(pred::alpha | pred::is('_'));
+            if (auto id = s.take_symbol(table)) sum += *id;
+            else s.drop_while(pred::alnum | pred::is('_'));
+        }
+        return sum;
+    });
+}
+
+void baseline_symbol_intern(benchmark::State& state) {
+    static constexpr auto ident = pred::alnum | pred::is('_');
+    run(state, corpus::kind::source, [](std::string_view text) {
+        std::size_t sum = 0;
+        std::unordered_map<std::string, std::uint32_t> table;
+        for (stream s{text}; not s.empty();) {
+            s.drop_until(pred::alpha | pred::is('_'));
+            if (auto name = s.take_while(ident); not name.empty())
+                sum += table.try_emplace(std::string{name}, std::uint32_t(table.size())).first->second;
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  trim() — trimming every line.
+// ============================================================================
+void stream_trim(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (auto line : stream{text}.lines()) sum += line.trim().size();
+        return sum;
+    });
+}
+
+void baseline_trim(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        static constexpr auto ws = " \t\n\r\v\f"sv;
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find('\n'), text.size());
+            auto line = text.substr(0, pos);
+            text.remove_prefix(std::min(pos + 1, text.size()));
+            line.remove_prefix(std::min(line.find_first_not_of(ws), line.size()));
+            line.remove_suffix(line.size() - std::min(line.find_last_not_of(ws) + 1, line.size()));
+            sum += line.size();
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  lines() — iterating over lines, with and without CRLF handling.
+// ============================================================================
+void stream_lines(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (auto line : stream{text}.lines()) sum += line.size();
+        return sum;
+    });
+}
+
+void stream_lines_separator(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (auto line : stream{text}.lines("\n")) sum += line.size();
+        return sum;
+    });
+}
+
+void baseline_lines(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find('\n'), text.size());
+            auto line = text.substr(0, pos);
+            if (line.ends_with('\r') and pos != text.size()) line.remove_suffix(1);
+            sum += line.size();
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  rlines(), take_back_until() — reading a log from the end.
+// ============================================================================
+void stream_rlines(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (auto line : stream{text}.rlines()) sum += line.size();
+        return sum;
+    });
+}
+
+void stream_take_back_until_char(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty(); s.drop_back()) sum += s.take_back_until('\n').size();
+        return sum;
+    });
+}
+
+void baseline_take_back_until_char(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = text.rfind('\n');
+            auto start = pos == text.npos ? 0 : pos + 1;
+            sum += text.size() - start;
+            text.remove_suffix(text.size() - (pos == text.npos ? 0 : pos));
+        }
+        return sum;
+    });
+}
+
+// Only the last line of each log entry is looked at.
+void stream_take_back_while_pred(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (auto line : stream{text}.rlines()) sum += line.take_back_while(!pred::space).size();
+        return sum;
+    });
+}
+
+// ============================================================================
+//  take_delimited() — quoted CSV fields.
+// ============================================================================
+void stream_take_delimited(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        std::string_view field;
+        for (stream s{text}; not s.empty(); s.drop()) {
+            if (s.take_delimited('"', field)) sum += field.size();
+            else sum += s.take_until_any(",\n").size();
+        }
+        return sum;
+    });
+}
+
+void stream_take_quoted(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        std::array<char, 256> buffer;
+        for (stream s{text}; not s.empty(); s.drop()) {
+            if (auto field = s.take_quoted(buffer, '"', '"')) sum += field->size();
+            else sum += s.take_until_any(",\n").size();
+        }
+        return sum;
+    });
+}
+
+void baseline_take_delimited(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            std::size_t end;
+            if (text.starts_with('"') and (end = text.find('"', 1)) != text.npos) {
+                sum += end - 1;
+                text.remove_prefix(end + 1);
+            } else {
+                end = std::min(text.find_first_of(",\n"), text.size());
+                sum += end;
+                text.remove_prefix(end);
+            }
+            text.remove_prefix(std::min<std::size_t>(1, text.size()));
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  arena — keeping every field after the text is gone.
+// ============================================================================
+void stream_arena_copy(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        arena a;
+        std::vector<std::string_view> fields;
+        for (stream s{text}; not s.empty(); s.drop()) fields.push_back(a.copy(s.take_until_any(",\n")));
+        return fields.size() + a.size();
+    });
+}
+
+void baseline_arena_copy(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::size_t size = 0;
+        std::vector<std::string> fields;
+        for (stream s{text}; not s.empty(); s.drop()) {
+            fields.emplace_back(s.take_until_any(",\n"));
+            size += fields.back().size();
+        }
+        return fields.size() + size;
+    });
+}
+
+// ============================================================================
+//  take_uint() — parsing the numeric columns.
+// ============================================================================
+void stream_take_uint(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::uint64_t sum = 0;
+        for (stream s{text}; not s.empty(); s.drop()) {
+            if (auto n = s.take_uint<std::uint64_t>()) sum += *n;
+            else s.drop_until_any(",\n");
+        }
+        return sum;
+    });
+}
+
+void baseline_take_uint(benchmark::State& state) {
+    run(state, corpus::kind::csv, [](std::string_view text) {
+        std::uint64_t sum = 0;
+        auto p = text.data();
+        auto end = text.data() + text.size();
+        while (p != end) {
+            std::uint64_t n;
+            auto [ptr, ec] = std::from_chars(p, end, n);
+            if (ec == std::errc{}) {
+                sum += n;
+                p = ptr;
+            } else {
+                while (p != end and *p != ',' and *p != '\n') ++p;
+            }
+            if (p != end) ++p;
+        }
+        return sum;
+    });
+}
+
+// ============================================================================
+//  UTF-8 text.
+// ============================================================================
+void stream_validate_utf8(benchmark::State& state) {
+    run(state, corpus::kind::utf8, [](std::string_view text) {
+        return stream{text}.validate_utf8();
+    });
+}
+
+void stream_validate_utf8_ascii(benchmark::State& state) {
+    run(state, corpus::kind::log, [](std::string_view text) {
+        return stream{text}.validate_utf8();
+    });
+}
+
+void stream_take_codepoints(benchmark::State& state) {
+    run(state, corpus::kind::utf8, [](std::string_view text) {
+        std::size_t sum = 0;
+        for (stream s{text}; not s.empty();) {
+            auto n = s.take_codepoints(16).size();
+            if (n == 0) break;
+            sum += n;
+        }
+        return sum;
+    });
+}
+
+void baseline_validate_utf8(benchmark::State& state) {
+    run(state, corpus::kind::utf8, [](std::string_view text) {
+        for (std::size_t i = 0; i < text.size();) {
+            auto b = std::uint8_t(text[i]);
+            std::size_t len = b < 0x80 ? 1 : b < 0xE0 ? 2 : b < 0xF0 ? 3 : 4;
+            if (b >= 0x80 and (b < 0xC2 or b > 0xF4)) return false;
+            if (text.size() - i < len) return false;
+            char32_t c = len == 1 ? b : b & (0x7F >> len);
+            for (std::size_t k = 1; k < len; ++k) {
+                auto cont = std::uint8_t(text[i + k]);
+                if ((cont & 0xC0) != 0x80) return false;
+                c = (c << 6) | (cont & 0x3F);
+            }
+            constexpr char32_t min[]{0, 0, 0x80, 0x800, 0x1'0000};
+            if (c < min[len] or c > 0x10'FFFF or (c >= 0xD800 and c <= 0xDFFF)) return false;
+            i += len;
+        }
+        return true;
+    });
+}
+
+// ============================================================================
+//  UTF-16 text.
+// ============================================================================
+void stream_u16_take_until_char(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        for (u16stream s{text}; not s.empty(); s.drop()) sum += s.take_until(u'\n').size();
+        return sum;
+    });
+}
+
+void baseline_u16_take_until_char(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find(u'\n'), text.size());
+            sum += pos;
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+void stream_u16_take_while_pred(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        for (u16stream s{text}; not s.empty(); s.drop()) sum += s.take_while(!(pred::is('.') | pred::is('\n'))).size();
+        return sum;
+    });
+}
+
+void baseline_u16_take_while_pred(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            std::size_t pos = 0;
+            while (pos < text.size() and text[pos] != u'.' and text[pos] != u'\n') ++pos;
+            sum += pos;
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+void stream_u16_lines(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        for (auto line : u16stream{text}.lines()) sum += line.size();
+        return sum;
+    });
+}
+
+void baseline_u16_lines(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find(u'\n'), text.size());
+            auto line = text.substr(0, pos);
+            if (line.ends_with(u'\r') and pos != text.size()) line.remove_suffix(1);
+            sum += line.size();
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+void stream_u16_take_until_any(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        for (u16stream s{text}; not s.empty(); s.drop()) sum += s.take_until_any(u" ,.\n").size();
+        return sum;
+    });
+}
+
+void baseline_u16_take_until_any(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find_first_of(u" ,.\n"), text.size());
+            sum += pos;
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+void stream_u16_trim(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        for (auto line : u16stream{text}.lines()) sum += line.trim(u" .,").size();
+        return sum;
+    });
+}
+
+void stream_u16_transcode(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::size_t sum = 0;
+        for (auto block : transcode<char8_t>(u16stream{text})) sum += block.size();
+        return sum;
+    });
+}
+
+// Convert the whole text into a string first, which is what we would have
+// to do without a transcoding view.
+void baseline_u16_transcode(benchmark::State& state) {
+    run<char16_t>(state, corpus::kind::utf16, [](std::u16string_view text) {
+        std::u8string out;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            char32_t c = text[i];
+            if (c >= 0xD800 and c < 0xDC00 and i + 1 < text.size())
+                c = 0x1'0000 + ((c - 0xD800) << 10) + (text[++i] - 0xDC00);
+            if (c < 0x80) {
+                out += char8_t(c);
+            } else if (c < 0x800) {
+                out += char8_t(0xC0 | (c >> 6));
+                out += char8_t(0x80 | (c & 0x3F));
+            } else if (c < 0x1'0000) {
+                out += char8_t(0xE0 | (c >> 12));
+                out += char8_t(0x80 | ((c >> 6) & 0x3F));
+                out += char8_t(0x80 | (c & 0x3F));
+            } else {
+                out += char8_t(0xF0 | (c >> 18));
+                out += char8_t(0x80 | ((c >> 12) & 0x3F));
+                out += char8_t(0x80 | ((c >> 6) & 0x3F));
+                out += char8_t(0x80 | (c & 0x3F));
+            }
+        }
+        return out.size();
+    });
+}
+
+// ============================================================================
+//  UTF-32 text.
+// ============================================================================
+void stream_u32_take_until_char(benchmark::State& state) {
+    run<char32_t>(state, corpus::kind::utf16, [](std::u32string_view text) {
+        std::size_t sum = 0;
+        for (u32stream s{text}; not s.empty(); s.drop()) sum += s.take_until(U'\n').size();
+        return sum;
+    });
+}
+
+void baseline_u32_take_until_char(benchmark::State& state) {
+    run<char32_t>(state, corpus::kind::utf16, [](std::u32string_view text) {
+        std::size_t sum = 0;
+        while (not text.empty()) {
+            auto pos = std::min(text.find(U'\n'), text.size());
+            sum += pos;
+            text.remove_prefix(std::min(pos + 1, text.size()));
+        }
+        return sum;
+    });
+}
+
+void stream_u32_take_until_any(benchmark::State& state) {
+    run<char32_t>(state, corpus::kind::utf16, [](std::u32string_view text) {
+        std::size_t sum = 0;
+        for (u32stream s{text}; not s.empty(); s.drop()) sum += s.take_until_any(U".\n").size();
+        return sum;
+    });
+}
+} // namespace
+
+BENCHMARK(stream_take_until_char)->Apply(sizes);
+BENCHMARK(baseline_take_until_char)->Apply(sizes);
+BENCHMARK(stream_take_until_text)->Apply(sizes);
+BENCHMARK(stream_take_until_searcher)->Apply(sizes);
+BENCHMARK(baseline_take_until_text)->Apply(sizes);
+BENCHMARK(stream_take_until_multi)->Apply(sizes);
+BENCHMARK(baseline_take_until_multi)->Apply(sizes);
+BENCHMARK(stream_take_kv)->Apply(sizes);
+BENCHMARK(baseline_take_kv)->Apply(sizes);
+BENCHMARK(stream_take_until_any)->Apply(sizes);
+BENCHMARK(stream_take_until_set)->Apply(sizes);
+BENCHMARK(stream_split_into_set)->Apply(sizes);
+BENCHMARK(stream_classify)->Apply(sizes);
+BENCHMARK(baseline_classify)->Apply(sizes);
+BENCHMARK(stream_split_into_char)->Apply(sizes);
+BENCHMARK(baseline_split_into_char)->Apply(sizes);
+BENCHMARK(baseline_take_until_any)->Apply(sizes);
+BENCHMARK(stream_take_while_any)->Apply(sizes);
+BENCHMARK(baseline_take_while_any)->Apply(sizes);
+BENCHMARK(stream_take_while_pred)->Apply(sizes);
+BENCHMARK(stream_take_while_lambda)->Apply(sizes);
+BENCHMARK(baseline_take_while_pred)->Apply(sizes);
+BENCHMARK(stream_lexer)->Apply(sizes);
+BENCHMARK(baseline_lexer)->Apply(sizes);
+BENCHMARK(stream_symbol_intern)->Apply(sizes);
+BENCHMARK(stream_symbol_lookup)->Apply(sizes);
+BENCHMARK(baseline_symbol_intern)->Apply(sizes);
+BENCHMARK(stream_trim)->Apply(sizes);
+BENCHMARK(baseline_trim)->Apply(sizes);
+BENCHMARK(stream_lines)->Apply(sizes);
+BENCHMARK(stream_lines_separator)->Apply(sizes);
+BENCHMARK(baseline_lines)->Apply(sizes);
+BENCHMARK(stream_rlines)->Apply(sizes);
+BENCHMARK(stream_take_back_until_char)->Apply(sizes);
+BENCHMARK(baseline_take_back_until_char)->Apply(sizes);
+BENCHMARK(stream_take_back_while_pred)->Apply(sizes);
+BENCHMARK(stream_take_delimited)->Apply(sizes);
+BENCHMARK(stream_take_quoted)->Apply(sizes);
+BENCHMARK(baseline_take_delimited)->Apply(sizes);
+BENCHMARK(stream_arena_copy)->Apply(sizes);
+BENCHMARK(baseline_arena_copy)->Apply(sizes);
+BENCHMARK(stream_take_uint)->Apply(sizes);
+BENCHMARK(baseline_take_uint)->Apply(sizes);
+BENCHMARK(stream_validate_utf8)->Apply(sizes);
+BENCHMARK(stream_validate_utf8_ascii)->Apply(sizes);
+BENCHMARK(stream_take_codepoints)->Apply(sizes);
+BENCHMARK(baseline_validate_utf8)->Apply(sizes);
+BENCHMARK(stream_u16_take_until_char)->Apply(sizes);
+BENCHMARK(baseline_u16_take_until_char)->Apply(sizes);
+BENCHMARK(stream_u16_take_while_pred)->Apply(sizes);
+BENCHMARK(baseline_u16_take_while_pred)->Apply(sizes);
+BENCHMARK(stream_u16_lines)->Apply(sizes);
+BENCHMARK(baseline_u16_lines)->Apply(sizes);
+BENCHMARK(stream_u16_take_until_any)->Apply(sizes);
+BENCHMARK(baseline_u16_take_until_any)->Apply(sizes);
+BENCHMARK(stream_u16_trim)->Apply(sizes);
+BENCHMARK(stream_u16_transcode)->Apply(sizes);
+BENCHMARK(baseline_u16_transcode)->Apply(sizes);
+BENCHMARK(stream_u32_take_until_char)->Apply(sizes);
+BENCHMARK(baseline_u32_take_until_char)->Apply(sizes);
+BENCHMARK(stream_u32_take_until_any)->Apply(sizes);
+
+
+// Record which kernels were used; set LIBSTREAM_FORCE_ISA to compare them.
+int main(int argc, char** argv) {
+#if LIBSTREAM_SIMD_DISPATCH
+    benchmark::AddCustomContext("libstream_isa", streams::detail::dispatch().name);
+#endif
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
@@ -0,0 +1,224 @@
+#ifndef LIBSTREAM_BENCH_CORPUS_HH
+#define LIBSTREAM_BENCH_CORPUS_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/// Synthetic inputs for the benchmarks.
+///
+/// Every corpus is generated from a fixed seed, so runs are comparable
+/// across machines and commits. A corpus is generated once, as large as
+/// the largest size any benchmark has asked for so far; smaller inputs
+/// are prefixes of it.
+namespace corpus {
+enum class kind {
+    log,    ///< Timestamped log lines, some with CRLF line endings.
+    csv,    ///< Comma-separated records with quoted and numeric fields.
+    source, ///< Indented C-like source code.
+    utf16,  ///< Mixed Latin, Cyrillic, and CJK prose.
+    utf8,    ///< The same prose as \c utf16, encoded as UTF-8.
+    headers, ///< HTTP request headers, separated by blank lines.
+};
+
+class rng {
+    std::uint64_t _m_state;
+
+public:
+    explicit rng(std::uint64_t seed) noexcept : _m_state(seed) {}
+
+    auto operator()(std::uint64_t bound) noexcept -> std::uint64_t {
+        _m_state ^= _m_state << 13;
+        _m_state ^= _m_state >> 7;
+        _m_state ^= _m_state << 17;
+        return _m_state % bound;
+    }
+
+    template <typename T, std::size_t N>
+    auto pick(const std::array<T, N>& items) noexcept -> const T& { return items[(*this)(N)]; }
+};
+
+namespace detail {
+inline constexpr std::array<std::string_view, 12> words{
+    "request", "handler", "value", "buffer", "index", "stream",
+    "parser", "token", "result", "count", "offset", "error",
+};
+
+inline void append_number(std::string& out, std::uint64_t n) { out += std::to_string(n); }
+
+inline void append_log_line(std::string& out, rng& r) {
+    static constexpr std::array<std::string_view, 4> levels{"INFO ", "DEBUG", "WARN ", "ERROR"};
+    out += "2024-03-";
+    append_number(out, 10 + r(18));
+    out += "T1";
+    append_number(out, r(10));
+    out += ":3";
+    append_number(out, r(10));
+    out += ":0";
+    append_number(out, r(10));
+    out += "Z ";
+    out += r.pick(levels);
+    out += " [worker-";
+    append_number(out, r(16));
+    out += "] ";
+    for (auto n = 3 + r(8); n; --n) {
+        out += r.pick(words);
+        out += ' ';
+    }
+    out += "id=";
+    append_number(out, r(1'000'000));
+    out += "  took ";
+    append_number(out, r(5'000));
+    out += "ms  ";
+    out += r(8) == 0 ? "\r\n" : "\n";
+}
+
+inline void append_csv_line(std::string& out, rng& r) {
+    append_number(out, r(100'000'000));
+    out += ",\"";
+    out += r.pick(words);
+    out += ' ';
+    out += r.pick(words);
+    out += "\",";
+    append_number(out, r(1'000));
+    out += ',';
+    out += r.pick(words);
+    out += ',';
+    append_number(out, r(4'000'000'000));
+    out += '\n';
+}
+
+inline void append_source_line(std::string& out, rng& r) {
+    out.append(4 * (1 + r(3)), ' ');
+    switch (r(5)) {
+        case 0:
+            out += "if (";
+            out += r.pick(words);
+            out += "_count > ";
+            append_number(out, r(100));
+            out += ") {";
+            break;
+        case 1:
+            out += "auto ";
+            out += r.pick(words);
+            out += " = ";
+            out += r.pick(words);
+            out += ".find(";
+            out += r.pick(words);
+            out += "_";
+            out += r.pick(words);
+            out += ");";
+            break;
+        case 2:
+            out += "// TODO: handle the ";
+            out += r.pick(words);
+            out += " case here.";
+            break;
+        case 3:
+            out += "return ";
+            out += r.pick(words);
+            out += "[i] + ";
+            out += r.pick(words);
+            out += ";";
+            break;
+        default:
+            out += "}";
+            break;
+    }
+    out += '\n';
+}
+
+inline void append_utf16_line(std::u16string& out, rng& r) {
+    static constexpr std::array<std::u16string_view, 9> phrases{
+        u"the stream", u"parses text", u"quickly",
+        u"поток", u"разбирает", u"текст",
+        u"流解析", u"文本", u"非常快",
+    };
+
+    for (auto n = 4 + r(10); n; --n) {
+        out += r.pick(phrases);
+        out += r(6) == 0 ? u", " : u" ";
+    }
+    out += u".\n";
+}
+
+inline void append_utf8_line(std::string& out, rng& r) {
+    static constexpr std::array<std::string_view, 9> phrases{
+        "the stream", "parses text", "quickly",
+        "поток", "разбирает", "текст",
+        "流解析", "文本", "非常快",
+    };
+
+    for (auto n = 4 + r(10); n; --n) {
+        out += r.pick(phrases);
+        out += r(6) == 0 ? ", " : " ";
+    }
+    out += ".\n";
+}
+
+inline void append_headers(std::string& out, rng& r) {
+    static constexpr std::array<std::string_view, 8> names{
+        "Host", "User-Agent", "Accept", "Accept-Encoding",
+        "Connection", "Content-Length", "X-Request-Id", "Cache-Control",
+    };
+
+    for (auto n = 3 + r(6); n; --n) {
+        out += r.pick(names);
+        out += r(4) == 0 ? ":" : ": ";
+        for (auto w = 1 + r(4); w; --w) {
+            out += r.pick(words);
+            out += w == 1 ? "" : r(2) ? "; " : ", ";
+        }
+        out += "\r\n";
+    }
+    out += "\r\n";
+}
+
+template <typename String>
+auto generate(kind k, std::size_t size) -> String {
+    String out;
+    out.reserve(size + 256);
+    rng r{0x9E37'79B9'7F4A'7C15 + std::uint64_t(k)};
+    while (out.size() < size) {
+        if constexpr (std::is_same_v<String, std::u16string>) {
+            if (k != kind::utf16) return out;
+            append_utf16_line(out, r);
+        } else if constexpr (std::is_same_v<String, std::u32string>) {
+            // The phrases are all in the BMP, so widening them is enough.
+            if (k != kind::utf16) return out;
+            std::u16string line;
+            append_utf16_line(line, r);
+            out.append(line.begin(), line.end());
+        } else switch (k) {
+            case kind::log: append_log_line(out, r); break;
+            case kind::csv: append_csv_line(out, r); break;
+            case kind::source: append_source_line(out, r); break;
+            case kind::utf8: append_utf8_line(out, r); break;
+            case kind::headers: append_headers(out, r); break;
+            case kind::utf16: return out;
+        }
+    }
+    return out;
+}
+} // namespace detail
+
+/// Get the first \p bytes bytes of a corpus.
+///
+/// The UTF-16 corpus is only available as \c char16_t, or as \c char32_t
+/// for the same text in UTF-32, and all others only as \c char; asking for
+/// the wrong type yields an empty text.
+template <typename CharType = char>
+auto get(kind k, std::size_t bytes) -> std::basic_string_view<CharType> {
+    using string = std::basic_string<CharType>;
+    static std::array<string, 6> cache;
+    auto& text = cache[std::size_t(k)];
+    auto size = bytes / sizeof(CharType);
+    if (text.size() < size) text = detail::generate<string>(k, size);
+    return std::basic_string_view<CharType>{text}.substr(0, size);
+}
+} // namespace corpus
+
+#endif // LIBSTREAM_BENCH_CORPUS_HH
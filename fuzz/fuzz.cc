@@ -0,0 +1,487 @@
+#include <stream/multi_searcher.hh>
+#include <stream/stream.hh>
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "reference.hh"
+
+using namespace streams;
+
+// Every input is decoded as text of each of the five character types and
+// run through every operation, whose result and remaining text are compared
+// with those of the naive implementation in reference.hh; any difference
+// aborts with the operation, the character type, and the input.
+//
+// The first character of the text says how many of the characters after it
+// make up the argument of the operations, i.e. the needle, the set, or the
+// delimiter; the rest is the text to search. For multi-byte character types,
+// bytes from 0xF0 up start a character that is made of the next two bytes,
+// so that the fuzzer can reach characters that do not fit in a byte, and
+// surrogates, without making every other character wide.
+//
+// Built with -fsanitize=fuzzer, this is a libFuzzer target. Otherwise, it is
+// built with LIBSTREAM_FUZZ_STANDALONE, which adds a main() that accepts a
+// subset of libFuzzer's flags: it replays the files and directories it is
+// given, and then runs `-runs=N` random inputs. LIBSTREAM_FORCE_ISA selects
+// the kernels to check, as it does for the tests and benchmarks.
+
+namespace {
+// Sets are capped so that they never need more ranges than they have room for.
+constexpr std::size_t max_set_size = 8;
+
+template <typename CharType>
+constexpr const char* type_name = "char";
+
+template <> constexpr const char* type_name<wchar_t> = "wchar_t";
+template <> constexpr const char* type_name<char8_t> = "char8_t";
+template <> constexpr const char* type_name<char16_t> = "char16_t";
+template <> constexpr const char* type_name<char32_t> = "char32_t";
+
+template <typename CharType>
+void print(const char* label, std::basic_string_view<CharType> text) {
+    std::fprintf(stderr, "  %s (%zu):", label, text.size());
+    for (auto c : text) std::fprintf(stderr, " %X", unsigned(std::make_unsigned_t<CharType>(c)));
+    std::fprintf(stderr, "\n");
+}
+
+template <typename CharType>
+[[noreturn]] void mismatch(const char* op, std::basic_string_view<CharType> arg, std::basic_string_view<CharType> text) {
+    std::fprintf(stderr, "%s<%s> differs from the reference\n", op, type_name<CharType>);
+    print("argument", arg);
+    print("text", text);
+    std::abort();
+}
+
+template <typename CharType>
+auto decode(std::span<const std::uint8_t> bytes) -> std::basic_string<CharType> {
+    std::basic_string<CharType> out;
+    out.reserve(bytes.size());
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        auto b = bytes[i];
+        if (sizeof(CharType) == 1 or b < 0xF0 or bytes.size() - i < 3) {
+            out.push_back(CharType(b));
+            continue;
+        }
+
+        auto wide = std::uint32_t(b & 0x0F) << 16 | std::uint32_t(bytes[i + 1]) << 8 | bytes[i + 2];
+        out.push_back(CharType(wide));
+        i += 2;
+    }
+
+    return out;
+}
+
+// The parts of an input, along with the operations that use them.
+template <typename CharType>
+class checker {
+    using text_type = std::basic_string_view<CharType>;
+    using stream_type = basic_stream<CharType>;
+    using set_type = char_set<CharType>;
+    using outcome = reference::outcome<CharType>;
+
+    text_type _m_arg;
+    text_type _m_text;
+
+public:
+    checker(text_type arg, text_type text) noexcept : _m_arg(arg), _m_text(text) {}
+
+    void run() {
+        _m_searches();
+        _m_searches_back();
+        _m_trims();
+        _m_delimited();
+        _m_multi();
+        _m_lines();
+        _m_split();
+        _m_classify();
+        _m_numbers();
+        if constexpr (sizeof(CharType) == 1)
+            if (stream_type{_m_text}.validate_utf8() != reference::valid_utf8(_m_text)) _m_fail("validate_utf8");
+    }
+
+private:
+    [[noreturn]] void _m_fail(const char* op) const { mismatch(op, _m_arg, _m_text); }
+
+    // Run `take` on a stream over the text and compare the result and
+    // what is left of the stream with `want`.
+    template <typename Take>
+    void _m_expect(const char* op, Take take, outcome want) const {
+        stream_type s{_m_text};
+        text_type got = take(s);
+        if (got != want.result or s.text() != want.rest) _m_fail(op);
+    }
+
+    [[nodiscard]] auto _m_char() const noexcept -> CharType { return _m_arg.empty() ? CharType('\n') : _m_arg.front(); }
+    [[nodiscard]] auto _m_set_chars() const noexcept -> text_type { return _m_arg.substr(0, max_set_size); }
+
+    void _m_searches() const {
+        using reference::until;
+        auto c = _m_char();
+        auto chars = _m_set_chars();
+        auto set = set_type{chars};
+        auto inverse = ~set;
+        auto is = [&](CharType x) { return x == c; };
+        auto in = [&](CharType x) { return reference::contains(_m_arg, x); };
+        auto in_set = [&](CharType x) { return reference::contains(chars, x); };
+        auto not_in_set = [&](CharType x) { return not reference::contains(chars, x); };
+        auto space = [](CharType x) { return reference::contains(stream_type::whitespace(), x); };
+        auto alnum = [](CharType x) {
+            auto u = std::make_unsigned_t<CharType>(x);
+            return (u >= '0' and u <= '9') or (u >= 'a' and u <= 'z') or (u >= 'A' and u <= 'Z');
+        };
+        auto at = reference::find(_m_text, _m_arg);
+
+        for (bool or_empty : {false, true}) {
+            auto expect = [&](const char* op, auto take, auto take_or_empty, std::size_t pos) {
+                if (or_empty) _m_expect(op, take_or_empty, until(_m_text, pos, true));
+                else _m_expect(op, take, until(_m_text, pos, false));
+            };
+
+            expect("take_until(char_type)",
+                [&](stream_type& s) { return s.take_until(c); },
+                [&](stream_type& s) { return s.take_until_or_empty(c); },
+                reference::find_if(_m_text, is));
+            expect("take_until(text_type)",
+                [&](stream_type& s) { return s.take_until(_m_arg); },
+                [&](stream_type& s) { return s.take_until_or_empty(_m_arg); },
+                at);
+            expect("take_until(searcher)",
+                [&](stream_type& s) { return s.take_until(searcher<CharType>{_m_arg}); },
+                [&](stream_type& s) { return s.take_until_or_empty(searcher<CharType>{_m_arg}); },
+                at);
+            expect("take_until_any",
+                [&](stream_type& s) { return s.take_until_any(_m_arg); },
+                [&](stream_type& s) { return s.take_until_any_or_empty(_m_arg); },
+                reference::find_if(_m_text, in));
+            expect("take_until(char_set)",
+                [&](stream_type& s) { return s.take_until(set); },
+                [&](stream_type& s) { return s.take_until_or_empty(set); },
+                reference::find_if(_m_text, in_set));
+            expect("take_until(~char_set)",
+                [&](stream_type& s) { return s.take_until(inverse); },
+                [&](stream_type& s) { return s.take_until_or_empty(inverse); },
+                reference::find_if(_m_text, not_in_set));
+            expect("take_until(pred::space)",
+                [&](stream_type& s) { return s.take_until(pred::space); },
+                [&](stream_type& s) { return s.take_until_or_empty(pred::space); },
+                reference::find_if(_m_text, space));
+
+            expect("take_while(char_type)",
+                [&](stream_type& s) { return s.take_while(c); },
+                [&](stream_type& s) { return s.take_while_or_empty(c); },
+                reference::find_if(_m_text, is, false));
+            expect("take_while_any",
+                [&](stream_type& s) { return s.take_while_any(_m_arg); },
+                [&](stream_type& s) { return s.take_while_any_or_empty(_m_arg); },
+                reference::find_if(_m_text, in, false));
+            expect("take_while(char_set)",
+                [&](stream_type& s) { return s.take_while(set); },
+                [&](stream_type& s) { return s.take_while_or_empty(set); },
+                reference::find_if(_m_text, in_set, false));
+            expect("take_while(~char_set)",
+                [&](stream_type& s) { return s.take_while(inverse); },
+                [&](stream_type& s) { return s.take_while_or_empty(inverse); },
+                reference::find_if(_m_text, not_in_set, false));
+            expect("take_while(pred::alnum)",
+                [&](stream_type& s) { return s.take_while(pred::alnum); },
+                [&](stream_type& s) { return s.take_while_or_empty(pred::alnum); },
+                reference::find_if(_m_text, alnum, false));
+        }
+    }
+
+    void _m_searches_back() const {
+        using reference::back_until;
+        auto c = _m_char();
+        auto chars = _m_set_chars();
+        auto set = set_type{chars};
+        auto is = [&](CharType x) { return x == c; };
+        auto in = [&](CharType x) { return reference::contains(_m_arg, x); };
+        auto in_set = [&](CharType x) { return reference::contains(chars, x); };
+
+        for (bool or_empty : {false, true}) {
+            auto expect = [&](const char* op, auto take, auto take_or_empty, std::size_t pos, std::size_t len = 1) {
+                if (or_empty) _m_expect(op, take_or_empty, back_until(_m_text, pos, true, len));
+                else _m_expect(op, take, back_until(_m_text, pos, false, len));
+            };
+
+            expect("take_back_until(char_type)",
+                [&](stream_type& s) { return s.take_back_until(c); },
+                [&](stream_type& s) { return s.take_back_until_or_empty(c); },
+                reference::rfind_if(_m_text, is));
+            expect("take_back_until(text_type)",
+                [&](stream_type& s) { return s.take_back_until(_m_arg); },
+                [&](stream_type& s) { return s.take_back_until_or_empty(_m_arg); },
+                reference::rfind(_m_text, _m_arg), _m_arg.size());
+            expect("take_back_until_any",
+                [&](stream_type& s) { return s.take_back_until_any(_m_arg); },
+                [&](stream_type& s) { return s.take_back_until_any_or_empty(_m_arg); },
+                reference::rfind_if(_m_text, in));
+            expect("take_back_until(char_set)",
+                [&](stream_type& s) { return s.take_back_until(set); },
+                [&](stream_type& s) { return s.take_back_until_or_empty(set); },
+                reference::rfind_if(_m_text, in_set));
+
+            expect("take_back_while(char_type)",
+                [&](stream_type& s) { return s.take_back_while(c); },
+                [&](stream_type& s) { return s.take_back_while_or_empty(c); },
+                reference::rfind_if(_m_text, is, false));
+            expect("take_back_while_any",
+                [&](stream_type& s) { return s.take_back_while_any(_m_arg); },
+                [&](stream_type& s) { return s.take_back_while_any_or_empty(_m_arg); },
+                reference::rfind_if(_m_text, in, false));
+            expect("take_back_while(char_set)",
+                [&](stream_type& s) { return s.take_back_while(set); },
+                [&](stream_type& s) { return s.take_back_while_or_empty(set); },
+                reference::rfind_if(_m_text, in_set, false));
+        }
+    }
+
+    void _m_trims() const {
+        auto chars = _m_set_chars();
+        auto set = set_type{chars};
+        auto in = [&](CharType x) { return reference::contains(_m_arg, x); };
+        auto in_set = [&](CharType x) { return reference::contains(chars, x); };
+        auto space = [](CharType x) { return reference::contains(stream_type::whitespace(), x); };
+
+        auto expect = [&](const char* op, auto trim, auto is, bool front, bool back) {
+            stream_type s{_m_text};
+            trim(s);
+            if (s.text() != reference::trim(_m_text, is, front, back)) _m_fail(op);
+        };
+
+        expect("trim(text_type)", [&](stream_type& s) { s.trim(_m_arg); }, in, true, true);
+        expect("trim_front(text_type)", [&](stream_type& s) { s.trim_front(_m_arg); }, in, true, false);
+        expect("trim_back(text_type)", [&](stream_type& s) { s.trim_back(_m_arg); }, in, false, true);
+        expect("trim(char_set)", [&](stream_type& s) { s.trim(set); }, in_set, true, true);
+        expect("trim_front(char_set)", [&](stream_type& s) { s.trim_front(set); }, in_set, true, false);
+        expect("trim_back(char_set)", [&](stream_type& s) { s.trim_back(set); }, in_set, false, true);
+        expect("trim()", [&](stream_type& s) { s.trim(); }, space, true, true);
+    }
+
+    void _m_delimited() const {
+        auto expect = [&](const char* op, auto take, std::optional<outcome> want) {
+            stream_type s{_m_text};
+            text_type got;
+            auto found = take(s, got);
+            if (found != want.has_value()) _m_fail(op);
+            if (want ? got != want->result or s.text() != want->rest : s.text() != _m_text) _m_fail(op);
+        };
+
+        auto c = _m_char();
+        expect("take_delimited(text_type)",
+            [&](stream_type& s, text_type& got) { return s.take_delimited(got, _m_arg); },
+            reference::delimited(_m_text, _m_arg));
+        expect("take_delimited(char_type)",
+            [&](stream_type& s, text_type& got) { return s.take_delimited(c, got); },
+            reference::delimited(_m_text, text_type{&c, 1}));
+        expect("take_delimited_any",
+            [&](stream_type& s, text_type& got) { return s.take_delimited_any(got, _m_arg); },
+            reference::delimited_any(_m_text, _m_arg));
+    }
+
+    // The argument is split into needles at its first character.
+    void _m_multi() const {
+        std::vector<text_type> needles;
+        if (not _m_arg.empty()) {
+            auto rest = _m_arg.substr(1);
+            for (;;) {
+                auto pos = reference::find_if(rest, [&](CharType x) { return x == _m_arg.front(); });
+                needles.push_back(rest.substr(0, pos));
+                if (pos == reference::npos) break;
+                rest.remove_prefix(pos + 1);
+            }
+        }
+
+        basic_multi_searcher<CharType> searcher{std::span<const text_type>{needles}};
+        auto [pos, needle] = reference::find_multi<CharType>(_m_text, needles);
+        for (bool or_empty : {false, true}) {
+            stream_type s{_m_text};
+            auto got = or_empty ? s.take_until_or_empty(searcher) : s.take_until(searcher);
+            auto want = reference::until(_m_text, pos, or_empty);
+            if (got.text != want.result or s.text() != want.rest) _m_fail("take_until(multi_searcher)");
+            if (got.needle != (pos == reference::npos ? std::nullopt : std::optional{needle}))
+                _m_fail("take_until(multi_searcher)");
+        }
+    }
+
+    void _m_lines() const {
+        auto expect = [&](const char* op, auto view, std::vector<text_type> want) {
+            std::size_t i = 0;
+            for (auto line : view) {
+                if (i == want.size() or line.text() != want[i]) _m_fail(op);
+                ++i;
+            }
+
+            if (i != want.size()) _m_fail(op);
+        };
+
+        stream_type s{_m_text};
+        expect("lines()", s.lines(), reference::lines<CharType>(_m_text, std::nullopt));
+        expect("lines(text_type)", s.lines(_m_arg), reference::lines<CharType>(_m_text, _m_arg));
+    }
+
+    void _m_split() const {
+        auto c = _m_char();
+        auto chars = _m_set_chars();
+        auto set = set_type{chars};
+        std::array<text_type, 16> out;
+        auto max = std::size_t(_m_arg.size()) % out.size() + 1;
+        auto expect = [&](const char* op, auto split, auto is) {
+            stream_type s{_m_text};
+            auto n = split(s, std::span{out}.first(max));
+            auto want = reference::split(_m_text, is, max);
+            if (n != want.fields.size() or s.text() != want.rest) _m_fail(op);
+            for (std::size_t i = 0; i < n; ++i)
+                if (out[i] != want.fields[i]) _m_fail(op);
+        };
+
+        expect("split_into(char_type)",
+            [&](stream_type& s, std::span<text_type> o) { return s.split_into(o, c); },
+            [&](CharType x) { return x == c; });
+        expect("split_into(char_set)",
+            [&](stream_type& s, std::span<text_type> o) { return s.split_into(o, set); },
+            [&](CharType x) { return reference::contains(chars, x); });
+    }
+
+    void _m_classify() const {
+        auto chars = _m_set_chars();
+        std::array<std::uint64_t, 8> out;
+        out.fill(~std::uint64_t(0));
+        auto n = stream_type{_m_text}.classify(set_type{chars}, out);
+        if (n != std::min(_m_text.size(), 64 * out.size())) _m_fail("classify");
+        for (std::size_t i = 0; i < 64 * out.size(); ++i) {
+            bool want = i < n and reference::contains(chars, _m_text[i]);
+            if (bool(out[i / 64] >> i % 64 & 1) != want and i < (n + 63) / 64 * 64) _m_fail("classify");
+        }
+    }
+
+    // Numbers are checked against std::from_chars(), after narrowing the
+    // text; characters that do not fit are replaced by one that is never
+    // part of a number.
+    void _m_numbers() const {
+        std::string narrow;
+        for (auto c : _m_text) {
+            auto u = std::make_unsigned_t<CharType>(c);
+            narrow.push_back(u < 0x80 ? char(u) : '\x01');
+        }
+
+        auto expect = [&]<typename T>(const char* op, auto take, T, int base) {
+            stream_type s{_m_text};
+            std::optional<T> got = take(s, base);
+            T value{};
+            auto [end, ec] = std::from_chars(narrow.data(), narrow.data() + narrow.size(), value, base);
+            auto len = std::size_t(end - narrow.data());
+            if (ec != std::errc{} ? got or s.text() != _m_text : got != value or s.text() != _m_text.substr(len))
+                _m_fail(op);
+        };
+
+        for (int base : {10, 16}) {
+            expect("take_int", [](stream_type& s, int b) { return s.template take_int<std::int64_t>(b); }, std::int64_t{}, base);
+            expect("take_int", [](stream_type& s, int b) { return s.template take_int<std::int8_t>(b); }, std::int8_t{}, base);
+            expect("take_uint", [](stream_type& s, int b) { return s.template take_uint<std::uint32_t>(b); }, std::uint32_t{}, base);
+        }
+    }
+};
+
+template <typename CharType>
+void check(std::span<const std::uint8_t> bytes) {
+    auto chars = decode<CharType>(bytes);
+    auto text = std::basic_string_view<CharType>{chars};
+    if (text.empty()) return;
+    auto n = std::min<std::size_t>(std::make_unsigned_t<CharType>(text.front()) % 64, text.size() - 1);
+    checker<CharType>{text.substr(1, n), text.substr(1 + n)}.run();
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+    std::span<const std::uint8_t> bytes{data, size};
+    check<char>(bytes);
+    check<wchar_t>(bytes);
+    check<char8_t>(bytes);
+    check<char16_t>(bytes);
+    check<char32_t>(bytes);
+    return 0;
+}
+
+#if LIBSTREAM_FUZZ_STANDALONE
+namespace {
+auto option(std::string_view arg, std::string_view name, std::uint64_t& value) -> bool {
+    if (not arg.starts_with(name)) return false;
+    arg.remove_prefix(name.size());
+    auto [end, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    return ec == std::errc{} and end == arg.data() + arg.size();
+}
+
+void replay(const std::filesystem::path& path) {
+    std::ifstream in{path, std::ios::binary};
+    std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>{in}, {}};
+    LLVMFuzzerTestOneInput(bytes.data(), bytes.size());
+}
+
+// Random inputs are mostly drawn from a few characters that the operations
+// look for, so that they actually find something, with a few arbitrary
+// bytes mixed in.
+void random_runs(std::uint64_t runs, std::uint64_t seed, std::size_t max_len) {
+    constexpr std::string_view common = "ab \t\r\n\"',;-0123456789xXfF\xC3\xA9\xE2\x82\xAC\xF0\xED\xA0\x80";
+    auto state = seed | 1;
+    auto next = [&](std::uint64_t bound) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state % bound;
+    };
+
+    std::vector<std::uint8_t> bytes;
+    for (std::uint64_t i = 0; i < runs; ++i) {
+        bytes.resize(next(max_len + 1));
+        for (auto& b : bytes) b = next(8) ? std::uint8_t(common[next(common.size())]) : std::uint8_t(next(256));
+        if (not bytes.empty()) bytes[0] = std::uint8_t(next(12));
+        LLVMFuzzerTestOneInput(bytes.data(), bytes.size());
+    }
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    std::uint64_t runs = 0;
+    std::uint64_t seed = 1;
+    std::uint64_t max_len = 512;
+    std::size_t replayed = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (option(arg, "-runs=", runs) or option(arg, "-seed=", seed) or option(arg, "-max_len=", max_len)) continue;
+        if (arg.starts_with('-')) {
+            std::fprintf(stderr, "usage: %s [-runs=N] [-seed=N] [-max_len=N] [file or directory...]\n", argv[0]);
+            return 2;
+        }
+
+        std::error_code ec;
+        if (std::filesystem::is_directory(arg, ec)) {
+            for (auto& entry : std::filesystem::recursive_directory_iterator{arg}) {
+                if (not entry.is_regular_file()) continue;
+                replay(entry.path());
+                ++replayed;
+            }
+        } else {
+            replay(arg);
+            ++replayed;
+        }
+    }
+
+    random_runs(runs, seed, std::size_t(max_len));
+    std::printf("%zu inputs replayed, %llu random inputs checked\n", replayed, static_cast<unsigned long long>(runs));
+}
+#endif
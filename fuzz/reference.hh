@@ -0,0 +1,231 @@
+#ifndef LIBSTREAM_FUZZ_REFERENCE_HH
+#define LIBSTREAM_FUZZ_REFERENCE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Naive versions of the stream operations, for the fuzzer to check the
+/// stream against and for the throughput harness to compare it with.
+///
+/// Everything here is written from the documentation of \c basic_stream, one
+/// character at a time, without calling into the stream, the searchers, or any
+/// of the search functions of \c std::basic_string_view, so that a bug in a
+/// kernel cannot hide by also being in the reference.
+///
+/// Each operation returns what the stream would return and what it would be
+/// left with.
+namespace reference {
+inline constexpr std::size_t npos = std::size_t(-1);
+
+template <typename CharType>
+using text = std::basic_string_view<CharType>;
+
+template <typename CharType>
+struct outcome {
+    text<CharType> result;
+    text<CharType> rest;
+
+    friend constexpr auto operator==(const outcome&, const outcome&) noexcept -> bool = default;
+};
+
+template <typename CharType>
+[[nodiscard]] constexpr auto contains(text<CharType> chars, CharType c) noexcept -> bool {
+    for (auto x : chars)
+        if (x == c) return true;
+    return false;
+}
+
+template <typename CharType>
+[[nodiscard]] constexpr auto matches(text<CharType> t, std::size_t pos, text<CharType> needle) noexcept -> bool {
+    if (pos > t.size() or t.size() - pos < needle.size()) return false;
+    for (std::size_t i = 0; i < needle.size(); ++i)
+        if (t[pos + i] != needle[i]) return false;
+    return true;
+}
+
+// The first and last characters for which `pred` returns `want`.
+template <typename CharType, typename Pred>
+[[nodiscard]] constexpr auto find_if(text<CharType> t, Pred pred, bool want = true) -> std::size_t {
+    for (std::size_t i = 0; i < t.size(); ++i)
+        if (bool(pred(t[i])) == want) return i;
+    return npos;
+}
+
+template <typename CharType, typename Pred>
+[[nodiscard]] constexpr auto rfind_if(text<CharType> t, Pred pred, bool want = true) -> std::size_t {
+    for (auto i = t.size(); i-- > 0;)
+        if (bool(pred(t[i])) == want) return i;
+    return npos;
+}
+
+template <typename CharType>
+[[nodiscard]] constexpr auto find(text<CharType> t, text<CharType> needle, std::size_t from = 0) noexcept -> std::size_t {
+    for (auto i = from; i <= t.size(); ++i)
+        if (matches(t, i, needle)) return i;
+    return npos;
+}
+
+template <typename CharType>
+[[nodiscard]] constexpr auto rfind(text<CharType> t, text<CharType> needle) noexcept -> std::size_t {
+    if (needle.size() > t.size()) return npos;
+    for (auto i = t.size() - needle.size() + 1; i-- > 0;)
+        if (matches(t, i, needle)) return i;
+    return npos;
+}
+
+/// \c take_until() and friends: everything before \p pos.
+template <typename CharType>
+[[nodiscard]] constexpr auto until(text<CharType> t, std::size_t pos, bool or_empty) noexcept -> outcome<CharType> {
+    if (pos == npos) return or_empty ? outcome<CharType>{{}, t} : outcome<CharType>{t, {}};
+    return {t.substr(0, pos), t.substr(pos)};
+}
+
+/// \c take_back_until() and friends: everything after the \p len
+/// characters at \p pos.
+template <typename CharType>
+[[nodiscard]] constexpr auto back_until(text<CharType> t, std::size_t pos, bool or_empty, std::size_t len = 1) noexcept -> outcome<CharType> {
+    if (pos == npos) return or_empty ? outcome<CharType>{{}, t} : outcome<CharType>{t, {}};
+    return {t.substr(pos + len), t.substr(0, pos + len)};
+}
+
+/// \c trim_front() and \c trim_back() with a predicate for the characters
+/// to remove.
+template <typename CharType, typename Pred>
+[[nodiscard]] constexpr auto trim(text<CharType> t, Pred pred, bool front, bool back) -> text<CharType> {
+    if (front) {
+        auto first = find_if(t, pred, false);
+        t = first == npos ? text<CharType>{} : t.substr(first);
+    }
+
+    if (back) {
+        auto last = rfind_if(t, pred, false);
+        t = last == npos ? text<CharType>{} : t.substr(0, last + 1);
+    }
+
+    return t;
+}
+
+/// \c take_delimited(); an empty optional means the stream is unchanged.
+template <typename CharType>
+[[nodiscard]] constexpr auto delimited(text<CharType> t, text<CharType> delimiter) noexcept -> std::optional<outcome<CharType>> {
+    if (not matches(t, 0, delimiter)) return std::nullopt;
+    auto pos = find(t, delimiter, delimiter.size());
+    if (pos == npos) return std::nullopt;
+    return outcome<CharType>{t.substr(delimiter.size(), pos - delimiter.size()), t.substr(pos + delimiter.size())};
+}
+
+/// \c take_delimited_any().
+template <typename CharType>
+[[nodiscard]] constexpr auto delimited_any(text<CharType> t, text<CharType> delimiters) noexcept -> std::optional<outcome<CharType>> {
+    if (t.empty() or not contains(delimiters, t[0])) return std::nullopt;
+    return delimited(t, t.substr(0, 1));
+}
+
+/// \c take_until() with a multi-searcher: the earliest match, and the
+/// first needle in the list that matches there.
+template <typename CharType>
+[[nodiscard]] constexpr auto find_multi(text<CharType> t, std::span<const text<CharType>> needles) noexcept -> std::pair<std::size_t, std::size_t> {
+    for (std::size_t pos = 0; pos <= t.size(); ++pos)
+        for (std::size_t i = 0; i < needles.size(); ++i)
+            if (matches(t, pos, needles[i])) return {pos, i};
+    return {npos, 0};
+}
+
+/// \c lines(); an empty separator means the default of \c \\n or \c \\r\\n.
+template <typename CharType>
+[[nodiscard]] auto lines(text<CharType> t, std::optional<text<CharType>> separator) -> std::vector<text<CharType>> {
+    std::vector<text<CharType>> out;
+    if (t.empty()) return out;
+    if (separator and separator->empty()) {
+        for (std::size_t i = 0; i < t.size(); ++i) out.push_back(t.substr(i, 1));
+        return out;
+    }
+
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < t.size();) {
+        if (separator) {
+            if (not matches(t, i, *separator)) {
+                ++i;
+                continue;
+            }
+
+            out.push_back(t.substr(start, i - start));
+            i += separator->size();
+        } else {
+            if (t[i] != CharType('\n')) {
+                ++i;
+                continue;
+            }
+
+            auto end = i != start and t[i - 1] == CharType('\r') ? i - 1 : i;
+            out.push_back(t.substr(start, end - start));
+            ++i;
+        }
+
+        start = i;
+    }
+
+    out.push_back(t.substr(start));
+    return out;
+}
+
+/// \c split_into() with a predicate for the separators, and room for
+/// \p max fields.
+template <typename CharType>
+struct split_result {
+    std::vector<text<CharType>> fields;
+    text<CharType> rest;
+};
+
+template <typename CharType, typename Pred>
+[[nodiscard]] auto split(text<CharType> t, Pred pred, std::size_t max) -> split_result<CharType> {
+    split_result<CharType> out;
+    while (out.fields.size() < max and not t.empty()) {
+        auto pos = find_if(t, pred);
+        if (pos == npos) pos = t.size();
+        out.fields.push_back(t.substr(0, pos));
+        t.remove_prefix(pos == t.size() ? pos : pos + 1);
+    }
+
+    out.rest = t;
+    return out;
+}
+
+/// \c validate_utf8(), from the table of well-formed sequences in the
+/// Unicode standard.
+template <typename CharType>
+[[nodiscard]] constexpr auto valid_utf8(text<CharType> t) noexcept -> bool {
+    for (std::size_t i = 0; i < t.size();) {
+        auto b = std::uint8_t(t[i]);
+        std::size_t len;
+        std::uint8_t lo = 0x80;
+        std::uint8_t hi = 0xBF;
+        if (b < 0x80) len = 1;
+        else if (b >= 0xC2 and b <= 0xDF) len = 2;
+        else if (b >= 0xE0 and b <= 0xEF) len = 3;
+        else if (b >= 0xF0 and b <= 0xF4) len = 4;
+        else return false;
+
+        if (b == 0xE0) lo = 0xA0;
+        if (b == 0xED) hi = 0x9F;
+        if (b == 0xF0) lo = 0x90;
+        if (b == 0xF4) hi = 0x8F;
+        if (t.size() - i < len) return false;
+        for (std::size_t j = 1; j < len; ++j) {
+            auto c = std::uint8_t(t[i + j]);
+            if (c < (j == 1 ? lo : 0x80) or c > (j == 1 ? hi : 0xBF)) return false;
+        }
+
+        i += len;
+    }
+
+    return true;
+}
+} // namespace reference
+
+#endif // LIBSTREAM_FUZZ_REFERENCE_HH
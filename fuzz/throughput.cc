@@ -0,0 +1,546 @@
+#include <stream/stream.hh>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#    include <linux/perf_event.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#endif
+
+#include "../bench/corpus.hh"
+#include "reference.hh"
+
+using namespace streams;
+using namespace std::literals;
+
+// Measures how many bytes each kernel gets through per cycle, for all five
+// character types, next to the naive implementation from reference.hh, and
+// checks the results against a baseline from an earlier run:
+//
+//     libstream_throughput --record=baseline.txt      # before a change
+//     libstream_throughput --baseline=baseline.txt    # after it
+//
+// The second run exits with status 1 if any kernel has become slower than its
+// baseline by more than the threshold (10% by default), so that it can gate a
+// change in CI. Every kernel is run several times and the fastest run counts,
+// which keeps the noise well below that on a quiet machine.
+//
+// Cycles are counted with perf_event where the kernel allows it, since that
+// counts the cycles of the core itself, and with the time-stamp counter on
+// x86 otherwise; the latter ticks at a fixed rate, so it is only comparable
+// at the same clock speed, i.e. with frequency scaling turned off. Elsewhere,
+// nanoseconds are counted instead. Baselines record which counter was used,
+// and are only compared with runs that use the same one.
+//
+// The stream and the reference must agree on a checksum of what they found;
+// this is not a substitute for the fuzzer, but it does catch a kernel that is
+// fast because it is wrong.
+
+namespace {
+// ============================================================================
+//  Counters.
+// ============================================================================
+class counter {
+    std::string_view _m_name = "ns";
+    int _m_fd = -1;
+
+public:
+    explicit counter(std::string_view which) {
+#if defined(__linux__)
+        if (which == "auto" or which == "perf") {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            _m_fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (_m_fd >= 0) {
+                _m_name = "cycles";
+                return;
+            }
+        }
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+        if (which == "auto" or which == "tsc") {
+            _m_name = "tsc";
+            return;
+        }
+#endif
+
+        (void) which;
+    }
+
+    counter(const counter&) = delete;
+    auto operator=(const counter&) -> counter& = delete;
+
+    ~counter() {
+#if defined(__linux__)
+        if (_m_fd >= 0) close(_m_fd);
+#endif
+    }
+
+    [[nodiscard]] auto name() const noexcept -> std::string_view { return _m_name; }
+
+    [[nodiscard]] auto now() const noexcept -> std::uint64_t {
+#if defined(__linux__)
+        if (_m_fd >= 0) {
+            std::uint64_t value = 0;
+            if (read(_m_fd, &value, sizeof(value)) == sizeof(value)) return value;
+        }
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+        if (_m_name == "tsc") {
+            _mm_lfence();
+            return __rdtsc();
+        }
+#endif
+
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count());
+    }
+};
+
+// ============================================================================
+//  Kernels.
+// ============================================================================
+template <typename CharType>
+using text = std::basic_string_view<CharType>;
+
+template <typename CharType>
+using kernel_fn = auto (*)(text<CharType>) -> std::size_t;
+
+template <typename CharType>
+struct kernel {
+    std::string_view name;
+    corpus::kind kind;
+    kernel_fn<CharType> stream;
+    kernel_fn<CharType> reference;
+};
+
+template <typename CharType>
+constexpr auto widen(std::string_view s) -> std::basic_string<CharType> {
+    return {s.begin(), s.end()};
+}
+
+template <typename CharType>
+auto take_until_char(text<CharType> t) -> std::size_t {
+    std::size_t sum = 0;
+    for (basic_stream<CharType> s{t}; not s.empty(); s.drop()) sum += s.take_until(CharType('\n')).size();
+    return sum;
+}
+
+template <typename CharType>
+auto reference_take_until_char(text<CharType> t) -> std::size_t {
+    std::size_t sum = 0;
+    while (not t.empty()) {
+        auto pos = std::min(reference::find_if(t, [](CharType c) { return c == CharType('\n'); }), t.size());
+        sum += pos;
+        t.remove_prefix(std::min(pos + 1, t.size()));
+    }
+    return sum;
+}
+
+template <typename CharType>
+auto take_until_text(text<CharType> t) -> std::size_t {
+    static const auto needle = widen<CharType>("took ");
+    std::size_t sum = 0;
+    for (basic_stream<CharType> s{t}; not s.empty(); s.drop()) sum += s.take_until(text<CharType>{needle}).size();
+    return sum;
+}
+
+template <typename CharType>
+auto reference_take_until_text(text<CharType> t) -> std::size_t {
+    static const auto needle = widen<CharType>("took ");
+    std::size_t sum = 0;
+    while (not t.empty()) {
+        auto pos = std::min(reference::find(t, text<CharType>{needle}), t.size());
+        sum += pos;
+        t.remove_prefix(std::min(pos + 1, t.size()));
+    }
+    return sum;
+}
+
+template <typename CharType>
+auto take_until_set(text<CharType> t) -> std::size_t {
+    static const auto chars = widen<CharType>(",\"\n");
+    static const char_set<CharType> set{text<CharType>{chars}};
+    std::size_t sum = 0;
+    for (basic_stream<CharType> s{t}; not s.empty(); s.drop()) sum += s.take_until(set).size();
+    return sum;
+}
+
+template <typename CharType>
+auto take_until_any(text<CharType> t) -> std::size_t {
+    static const auto chars = widen<CharType>(",\"\n");
+    std::size_t sum = 0;
+    for (basic_stream<CharType> s{t}; not s.empty(); s.drop()) sum += s.take_until_any(text<CharType>{chars}).size();
+    return sum;
+}
+
+template <typename CharType>
+auto reference_take_until_any(text<CharType> t) -> std::size_t {
+    static const auto chars = widen<CharType>(",\"\n");
+    std::size_t sum = 0;
+    while (not t.empty()) {
+        auto pos = std::min(reference::find_if(t, [](CharType c) { return reference::contains(text<CharType>{chars}, c); }), t.size());
+        sum += pos;
+        t.remove_prefix(std::min(pos + 1, t.size()));
+    }
+    return sum;
+}
+
+// Indentation, and the runs of letters in between punctuation.
+template <typename CharType>
+auto take_while_any(text<CharType> t) -> std::size_t {
+    static const auto chars = widen<CharType>(" \tabcdefghijklmnopqrstuvwxyz");
+    std::size_t sum = 0;
+    for (basic_stream<CharType> s{t}; not s.empty(); s.drop()) sum += s.take_while_any(text<CharType>{chars}).size();
+    return sum;
+}
+
+template <typename CharType>
+auto take_while_set(text<CharType> t) -> std::size_t {
+    static const auto chars = widen<CharType>(" \tabcdefghijklmnopqrstuvwxyz");
+    static const char_set<CharType> set{text<CharType>{chars}};
+    std::size_t sum = 0;
+    for (basic_stream<CharType> s{t}; not s.empty(); s.drop()) sum += s.take_while(set).size();
+    return sum;
+}
+
+template <typename CharType>
+auto reference_take_while_any(text<CharType> t) -> std::size_t {
+    static const auto chars = widen<CharType>(" \tabcdefghijklmnopqrstuvwxyz");
+    std::size_t sum = 0;
+    while (not t.empty()) {
+        auto pos = std::min(reference::find_if(t, [](CharType c) { return reference::contains(text<CharType>{chars}, c); }, false), t.size());
+        sum += pos;
+        t.remove_prefix(std::min(pos + 1, t.size()));
+    }
+    return sum;
+}
+
+// Trimming every line, which is mostly the cost of finding the lines.
+template <typename CharType>
+auto trim(text<CharType> t) -> std::size_t {
+    std::size_t sum = 0;
+    for (auto line : basic_stream<CharType>{t}.lines()) sum += line.trim().size();
+    return sum;
+}
+
+template <typename CharType>
+auto reference_trim(text<CharType> t) -> std::size_t {
+    auto space = [](CharType c) { return reference::contains(basic_stream<CharType>::whitespace(), c); };
+    std::size_t sum = 0;
+    for (auto line : reference::lines<CharType>(t, std::nullopt)) sum += reference::trim(line, space, true, true).size();
+    return sum;
+}
+
+template <typename CharType>
+auto take_delimited(text<CharType> t) -> std::size_t {
+    static const auto ends = widen<CharType>(",\n");
+    std::size_t sum = 0;
+    text<CharType> field;
+    for (basic_stream<CharType> s{t}; not s.empty(); s.drop()) {
+        if (s.take_delimited(CharType('"'), field)) sum += field.size();
+        else sum += s.take_until_any(text<CharType>{ends}).size();
+    }
+    return sum;
+}
+
+template <typename CharType>
+auto reference_take_delimited(text<CharType> t) -> std::size_t {
+    static const auto ends = widen<CharType>(",\n");
+    static const auto quote = widen<CharType>("\"");
+    std::size_t sum = 0;
+    while (not t.empty()) {
+        if (auto d = reference::delimited(t, text<CharType>{quote})) {
+            sum += d->result.size();
+            t = d->rest;
+        } else {
+            auto pos = std::min(reference::find_if(t, [](CharType c) { return reference::contains(text<CharType>{ends}, c); }), t.size());
+            sum += pos;
+            t.remove_prefix(pos);
+        }
+        t.remove_prefix(std::min<std::size_t>(1, t.size()));
+    }
+    return sum;
+}
+
+template <typename CharType>
+auto take_back_until_char(text<CharType> t) -> std::size_t {
+    std::size_t sum = 0;
+    for (basic_stream<CharType> s{t}; not s.empty(); s.drop_back()) sum += s.take_back_until(CharType('\n')).size();
+    return sum;
+}
+
+template <typename CharType>
+auto reference_take_back_until_char(text<CharType> t) -> std::size_t {
+    std::size_t sum = 0;
+    while (not t.empty()) {
+        auto pos = reference::rfind_if(t, [](CharType c) { return c == CharType('\n'); });
+        auto n = pos == reference::npos ? t.size() : t.size() - pos - 1;
+        sum += n;
+        t.remove_suffix(std::min(n + 1, t.size()));
+    }
+    return sum;
+}
+
+template <typename CharType>
+auto lines(text<CharType> t) -> std::size_t {
+    std::size_t sum = 0;
+    for (auto line : basic_stream<CharType>{t}.lines()) sum += line.size() + 1;
+    return sum;
+}
+
+template <typename CharType>
+auto reference_lines(text<CharType> t) -> std::size_t {
+    std::size_t sum = 0;
+    for (auto line : reference::lines<CharType>(t, std::nullopt)) sum += line.size() + 1;
+    return sum;
+}
+
+template <typename CharType>
+auto validate_utf8(text<CharType> t) -> std::size_t { return basic_stream<CharType>{t}.validate_utf8(); }
+
+template <typename CharType>
+auto reference_validate_utf8(text<CharType> t) -> std::size_t { return reference::valid_utf8(t); }
+
+template <typename CharType>
+auto kernels() -> std::vector<kernel<CharType>> {
+    using corpus::kind;
+    std::vector<kernel<CharType>> k{
+        {"take_until_char", kind::log, &take_until_char<CharType>, &reference_take_until_char<CharType>},
+        {"take_until_text", kind::log, &take_until_text<CharType>, &reference_take_until_text<CharType>},
+        {"take_until_set", kind::csv, &take_until_set<CharType>, &reference_take_until_any<CharType>},
+        {"take_until_any", kind::csv, &take_until_any<CharType>, &reference_take_until_any<CharType>},
+        {"take_while_set", kind::source, &take_while_set<CharType>, &reference_take_while_any<CharType>},
+        {"take_while_any", kind::source, &take_while_any<CharType>, &reference_take_while_any<CharType>},
+        {"trim", kind::source, &trim<CharType>, &reference_trim<CharType>},
+        {"take_delimited", kind::csv, &take_delimited<CharType>, &reference_take_delimited<CharType>},
+        {"take_back_until_char", kind::log, &take_back_until_char<CharType>, &reference_take_back_until_char<CharType>},
+        {"lines", kind::log, &lines<CharType>, &reference_lines<CharType>},
+    };
+
+    if constexpr (sizeof(CharType) == 1)
+        k.push_back({"validate_utf8", kind::utf8, &validate_utf8<CharType>, &reference_validate_utf8<CharType>});
+    return k;
+}
+
+// The corpora are only generated as `char`; the other types get a copy
+// with every byte widened, so that they all search the same text.
+template <typename CharType>
+auto input(corpus::kind k, std::size_t bytes) -> text<CharType> {
+    static std::map<corpus::kind, std::basic_string<CharType>> cache;
+    auto& t = cache[k];
+    auto size = bytes / sizeof(CharType);
+    if (t.size() < size) {
+        auto narrow = corpus::get<char>(k, size);
+        t.assign(narrow.size(), CharType{});
+        std::ranges::transform(narrow, t.begin(), [](char c) { return CharType(std::uint8_t(c)); });
+    }
+
+    return text<CharType>{t}.substr(0, size);
+}
+
+// ============================================================================
+//  Driver.
+// ============================================================================
+struct options {
+    std::size_t bytes = 1'024 * 1'024;
+    std::size_t repeat = 9;
+    double threshold = 0.10;
+    std::string counter = "auto";
+    std::string baseline;
+    std::string record;
+    std::string filter;
+};
+
+struct result {
+    std::string name;
+    double stream = 0;
+    double reference = 0;
+};
+
+struct baseline {
+    std::string counter;
+    std::map<std::string, double, std::less<>> rates;
+};
+
+// Keeps the compiler from throwing the checksums away.
+volatile std::size_t sink;
+
+// Run `fn` as often as asked and return the fewest ticks that one run took.
+template <typename CharType>
+auto measure(const counter& c, kernel_fn<CharType> fn, text<CharType> t, std::size_t repeat, std::size_t& checksum) -> std::uint64_t {
+    auto best = std::numeric_limits<std::uint64_t>::max();
+    checksum = fn(t);
+    for (std::size_t i = 0; i < repeat; ++i) {
+        auto start = c.now();
+        auto sum = fn(t);
+        auto ticks = c.now() - start;
+        sink = sum;
+        best = std::min(best, std::max<std::uint64_t>(ticks, 1));
+    }
+    return best;
+}
+
+template <typename CharType>
+auto run(const counter& c, const options& opts, std::string_view type, std::vector<result>& results) -> bool {
+    bool ok = true;
+    for (auto& k : kernels<CharType>()) {
+        auto name = std::string{k.name} + "/" + std::string{type};
+        if (not opts.filter.empty() and name.find(opts.filter) == std::string::npos) continue;
+
+        auto t = input<CharType>(k.kind, opts.bytes);
+        auto bytes = double(t.size() * sizeof(CharType));
+        std::size_t got = 0, want = 0;
+        auto stream_ticks = measure(c, k.stream, t, opts.repeat, got);
+        auto reference_ticks = measure(c, k.reference, t, opts.repeat, want);
+        if (got != want) {
+            std::fprintf(stderr, "%s: checksum %zu differs from the reference's %zu\n", name.c_str(), got, want);
+            ok = false;
+        }
+
+        results.push_back({name, bytes / double(stream_ticks), bytes / double(reference_ticks)});
+    }
+    return ok;
+}
+
+auto parse(int argc, char** argv, options& opts) -> bool {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = [&](std::string_view name, auto& out) {
+            if (not arg.starts_with(name)) return false;
+            auto v = arg.substr(name.size());
+            if constexpr (std::is_same_v<std::remove_reference_t<decltype(out)>, std::string>) out = v;
+            else if (std::from_chars(v.data(), v.data() + v.size(), out).ec != std::errc{}) return false;
+            return true;
+        };
+
+        if (value("--bytes="sv, opts.bytes) or value("--repeat="sv, opts.repeat)
+            or value("--threshold="sv, opts.threshold) or value("--counter="sv, opts.counter)
+            or value("--baseline="sv, opts.baseline) or value("--record="sv, opts.record)
+            or value("--filter="sv, opts.filter)) continue;
+
+        std::fprintf(stderr,
+            "usage: %s [--bytes=N] [--repeat=N] [--counter=auto|perf|tsc|ns] [--filter=TEXT]\n"
+            "          [--baseline=FILE [--threshold=FRACTION]] [--record=FILE]\n",
+            argv[0]);
+        return false;
+    }
+
+    return true;
+}
+
+// A baseline has a `counter` line followed by one `name rate` line per
+// kernel; lines starting with `#` are comments.
+auto load(const std::string& path, baseline& b) -> bool {
+    std::ifstream in{path};
+    if (not in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        basic_stream<char> s{line};
+        if (s.trim().empty() or s.starts_with('#')) continue;
+        auto key = std::string{s.take_until_any(" \t")};
+        s.trim_front();
+        if (key == "counter") {
+            b.counter = std::string{s.text()};
+            continue;
+        }
+
+        double rate = 0;
+        if (std::from_chars(s.data(), s.data() + s.size(), rate).ec != std::errc{}) return false;
+        b.rates[key] = rate;
+    }
+
+    return true;
+}
+
+auto save(const std::string& path, const counter& c, const std::vector<result>& results) -> bool {
+    std::ofstream out{path};
+    out << "# bytes per " << (c.name() == "ns" ? "nanosecond" : "cycle") << ", from libstream_throughput\n";
+    out << "counter " << c.name() << '\n';
+    for (auto& r : results) out << r.name << ' ' << r.stream << '\n';
+    return bool(out);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    options opts;
+    if (not parse(argc, argv, opts)) return 2;
+
+    counter c{opts.counter};
+    if (opts.counter != "auto" and c.name() != (opts.counter == "perf" ? "cycles" : opts.counter)) {
+        std::fprintf(stderr, "counter '%s' is not available here\n", opts.counter.c_str());
+        return 2;
+    }
+
+    baseline base;
+    if (not opts.baseline.empty()) {
+        if (not load(opts.baseline, base)) {
+            std::fprintf(stderr, "%s: cannot read baseline\n", opts.baseline.c_str());
+            return 2;
+        }
+
+        if (base.counter != c.name()) {
+            std::fprintf(stderr, "%s was recorded with counter '%s', but this run uses '%.*s'\n",
+                opts.baseline.c_str(), base.counter.c_str(), int(c.name().size()), c.name().data());
+            return 2;
+        }
+    }
+
+    std::vector<result> results;
+    bool ok = run<char>(c, opts, "char", results);
+    ok = run<wchar_t>(c, opts, "wchar_t", results) and ok;
+    ok = run<char8_t>(c, opts, "char8_t", results) and ok;
+    ok = run<char16_t>(c, opts, "char16_t", results) and ok;
+    ok = run<char32_t>(c, opts, "char32_t", results) and ok;
+
+    auto unit = c.name() == "ns" ? "B/ns" : "B/cycle";
+    std::printf("%-32s %12s %12s %8s %10s\n", "kernel", unit, "reference", "speedup", "baseline");
+    for (auto& r : results) {
+        std::printf("%-32s %12.3f %12.3f %7.1fx", r.name.c_str(), r.stream, r.reference, r.stream / r.reference);
+        if (auto it = base.rates.find(r.name); it != base.rates.end()) {
+            auto change = r.stream / it->second - 1;
+            std::printf(" %+9.1f%%", 100 * change);
+            if (change < -opts.threshold) {
+                std::printf("  REGRESSION");
+                ok = false;
+            }
+        } else if (not opts.baseline.empty()) {
+            std::printf(" %10s", "new");
+        }
+        std::printf("\n");
+    }
+
+    if (not opts.record.empty() and not save(opts.record, c, results)) {
+        std::fprintf(stderr, "%s: cannot write baseline\n", opts.record.c_str());
+        return 2;
+    }
+
+    return ok ? 0 : 1;
+}
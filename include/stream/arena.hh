@@ -0,0 +1,187 @@
+#ifndef STREAM_ARENA_HH
+#define STREAM_ARENA_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace streams {
+/// \brief A bump allocator for text.
+///
+/// Streams never own their text, so keeping a token around for longer
+/// than the text it came from normally means copying it into a string,
+/// i.e. one heap allocation per token. An arena instead copies text into
+/// large chunks of memory, so each copy is a pointer bump, and frees all
+/// of it at once when it is reset or destroyed.
+///
+/// \code
+///     arena a;
+///     std::vector<std::string_view> names;
+///     for (auto line : s.lines()) names.push_back(a.copy(line.take_until(',')));
+/// \endcode
+///
+/// Resetting an arena keeps its chunks around to be reused, so an arena
+/// that is reset after each request or batch stops allocating once it
+/// has grown large enough. Copies larger than the chunk size get a chunk
+/// of their own, which is reused in the same way.
+///
+/// Views returned by an arena remain valid until it is reset or destroyed.
+/// Arenas can be used in constant expressions.
+template <typename CharType>
+class basic_arena {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using size_type = std::size_t;
+
+    /// The default size of a chunk, in characters.
+    static constexpr size_type default_chunk_size = 16 * 1'024 / sizeof(char_type);
+
+private:
+    struct chunk {
+        char_type* data;
+        size_type size;
+    };
+
+    std::vector<chunk> _m_chunks;
+    size_type _m_chunk_size;
+    size_type _m_current = 0;
+    size_type _m_used = 0;
+    size_type _m_size = 0;
+
+public:
+    /// Construct an empty arena; this does not allocate.
+    constexpr basic_arena() noexcept : _m_chunk_size(default_chunk_size) {}
+
+    /// Construct an arena that allocates chunks of \p chunk_size characters.
+    explicit constexpr basic_arena(size_type chunk_size) noexcept
+        : _m_chunk_size(std::max<size_type>(chunk_size, 1)) {}
+
+    basic_arena(const basic_arena&) = delete;
+    auto operator=(const basic_arena&) -> basic_arena& = delete;
+
+    constexpr basic_arena(basic_arena&& other) noexcept
+        : _m_chunks(std::exchange(other._m_chunks, {})),
+          _m_chunk_size(other._m_chunk_size),
+          _m_current(std::exchange(other._m_current, 0)),
+          _m_used(std::exchange(other._m_used, 0)),
+          _m_size(std::exchange(other._m_size, 0)) {}
+
+    constexpr auto operator=(basic_arena&& other) noexcept -> basic_arena& {
+        if (this == &other) return *this;
+        release();
+        _m_chunks = std::exchange(other._m_chunks, {});
+        _m_chunk_size = other._m_chunk_size;
+        _m_current = std::exchange(other._m_current, 0);
+        _m_used = std::exchange(other._m_used, 0);
+        _m_size = std::exchange(other._m_size, 0);
+        return *this;
+    }
+
+    constexpr ~basic_arena() { release(); }
+
+    /// \return The total number of characters that can be stored without
+    ///         allocating another chunk, including those already in use.
+    [[nodiscard]] constexpr auto
+    capacity() const noexcept -> size_type {
+        size_type n = 0;
+        for (auto& c : _m_chunks) n += c.size;
+        return n;
+    }
+
+    /// \brief Copy text into the arena.
+    ///
+    /// Pass the result of any \c take_*() function to this to keep the
+    /// token after the text it came from is gone.
+    ///
+    /// \return A view of the copy.
+    [[nodiscard]] constexpr auto
+    copy(text_type text) -> text_type {
+        if (text.empty()) return {};
+        auto ptr = _m_allocate(text.size());
+        if consteval {
+            for (size_type i = 0; i < text.size(); ++i) std::construct_at(ptr + i, text[i]);
+        } else {
+            std::char_traits<char_type>::copy(ptr, text.data(), text.size());
+        }
+
+        return {ptr, text.size()};
+    }
+
+    /// Free all chunks.
+    ///
+    /// This invalidates all views returned by \c copy().
+    constexpr void release() noexcept {
+        for (auto& c : _m_chunks) std::allocator<char_type>{}.deallocate(c.data, c.size);
+        _m_chunks.clear();
+        _m_current = _m_used = _m_size = 0;
+    }
+
+    /// Make all chunks available for reuse.
+    ///
+    /// This invalidates all views returned by \c copy(), but keeps the
+    /// memory they were stored in.
+    constexpr void reset() noexcept { _m_current = _m_used = _m_size = 0; }
+
+    /// \return The number of characters copied into the arena since it
+    ///         was last reset.
+    [[nodiscard]] constexpr auto
+    size() const noexcept -> size_type { return _m_size; }
+
+private:
+    constexpr auto _m_allocate(size_type n) -> char_type* {
+        _m_size += n;
+
+        // Oversized copies get a chunk of their own, placed before the
+        // current one so we can keep using what is left of it. Chunks
+        // after the current one are unused, so one of them may be large
+        // enough already.
+        if (n > _m_chunk_size) {
+            auto first_free = _m_current + (_m_used != 0);
+            for (auto i = first_free; i < _m_chunks.size(); ++i) {
+                if (_m_chunks[i].size >= n) {
+                    auto begin = _m_chunks.begin() + std::ptrdiff_t(_m_current);
+                    std::rotate(begin, _m_chunks.begin() + std::ptrdiff_t(i), _m_chunks.begin() + std::ptrdiff_t(i + 1));
+                    return _m_chunks[_m_current++].data;
+                }
+            }
+
+            auto ptr = std::allocator<char_type>{}.allocate(n);
+            _m_chunks.insert(_m_chunks.begin() + std::ptrdiff_t(_m_current++), chunk{ptr, n});
+            return ptr;
+        }
+
+        while (_m_current < _m_chunks.size()) {
+            auto& c = _m_chunks[_m_current];
+            if (c.size - _m_used >= n) {
+                auto ptr = c.data + _m_used;
+                _m_used += n;
+                return ptr;
+            }
+
+            _m_next_chunk();
+        }
+
+        auto ptr = std::allocator<char_type>{}.allocate(_m_chunk_size);
+        _m_chunks.push_back(chunk{ptr, _m_chunk_size});
+        _m_used = n;
+        return ptr;
+    }
+
+    constexpr void _m_next_chunk() noexcept {
+        ++_m_current;
+        _m_used = 0;
+    }
+};
+
+using arena = basic_arena<char>;
+using warena = basic_arena<wchar_t>;
+using u8arena = basic_arena<char8_t>;
+using u16arena = basic_arena<char16_t>;
+using u32arena = basic_arena<char32_t>;
+} // namespace streams
+
+#endif // STREAM_ARENA_HH
@@ -0,0 +1,236 @@
+#ifndef STREAM_ASYNC_STREAM_HH
+#define STREAM_ASYNC_STREAM_HH
+
+#include <coroutine>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <utility>
+
+#include "chunked_stream.hh"
+
+namespace streams {
+/// \brief A refillable stream that coroutines can wait on.
+///
+/// This is a \c basic_chunked_stream whose \c take_ functions are awaitable:
+/// instead of returning an empty optional when the buffered data is not enough
+/// to decide the result, they suspend the calling coroutine until it is, and
+/// the text is then scanned from where the last attempt stopped rather than
+/// from the start, so waiting for a long line is still linear.
+///
+/// \code
+///     auto handle(async_stream& s) -> task {
+///         while (auto line = co_await s.take_until('\n')) {
+///             s.drop();
+///             dispatch(stream{*line});
+///         }
+///     }
+///
+///     // In the read callback of the socket, or a coroutine that reads it:
+///     s.commit(n);
+/// \endcode
+///
+/// The stream does not read anything itself; whatever receives the input
+/// passes it in with \c append() or \c prepare() and \c commit(), and calls
+/// \c close() at the end of it. A waiting coroutine is resumed from within the
+/// call that made its result available, on the same thread, before that call
+/// returns. This works with any coroutine type and any event loop, since the
+/// stream never needs to schedule anything.
+///
+/// The results of awaiting are the same as those of the corresponding function
+/// of \c basic_chunked_stream once the data is there: the text before the
+/// delimiter, or whatever is left once the input is closed, or an empty
+/// optional if the input is closed and everything has been consumed. Since
+/// the text is just a view of the buffer, it can be parsed with \c basic_stream
+/// like any other, so the same parsing code works for both sync and async
+/// input; like with \c basic_chunked_stream, it is invalidated by the next call
+/// to \c append() or \c prepare().
+///
+/// Only one coroutine may wait on a stream at a time. The stream must not
+/// be destroyed while a coroutine is waiting on it, but that coroutine can
+/// be destroyed, which cancels the wait.
+template <typename CharType>
+class basic_async_stream {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using text_opt = std::optional<text_type>;
+    using size_type = std::size_t;
+    using stream_type = basic_stream<char_type>;
+    using char_set_type = char_set<char_type>;
+    using chunked_stream_type = basic_chunked_stream<char_type>;
+
+    /// Default initial buffer size, in characters.
+    static constexpr size_type default_capacity = chunked_stream_type::default_capacity;
+
+private:
+    // The awaiter of the coroutine that is waiting, which is asked to try again
+    // whenever more data arrives.
+    struct _waiter {
+        auto (*poll)(_waiter*) noexcept -> bool = nullptr;
+        std::coroutine_handle<> handle;
+    };
+
+    template <typename Take>
+    class _awaiter : _waiter {
+        basic_async_stream* _m_stream;
+        Take _m_take;
+        text_opt _m_result;
+
+    public:
+        _awaiter(basic_async_stream* s, Take take) noexcept : _m_stream(s), _m_take(take) {
+            this->poll = [](_waiter* w) noexcept { return static_cast<_awaiter*>(w)->_m_poll(); };
+        }
+
+        _awaiter(const _awaiter&) = delete;
+        auto operator=(const _awaiter&) -> _awaiter& = delete;
+
+        ~_awaiter() noexcept {
+            if (_m_stream->_m_waiter == this) _m_stream->_m_waiter = nullptr;
+        }
+
+        [[nodiscard]] auto await_ready() noexcept -> bool { return _m_poll(); }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept {
+            this->handle = h;
+            _m_stream->_m_waiter = this;
+        }
+
+        [[nodiscard]] auto await_resume() noexcept -> text_opt { return _m_result; }
+
+    private:
+        // A search that fails with the input closed has already returned
+        // everything there is, so that is not worth waiting for either.
+        auto _m_poll() noexcept -> bool {
+            _m_result = _m_take(_m_stream->_m_buffer);
+            return _m_result.has_value() or _m_stream->_m_buffer.eof();
+        }
+    };
+
+    template <typename Take>
+    auto _m_await(Take take) noexcept -> _awaiter<Take> { return {this, take}; }
+
+    chunked_stream_type _m_buffer;
+    _waiter* _m_waiter = nullptr;
+
+public:
+    /// Create a stream with an initial buffer size of \p capacity characters.
+    explicit basic_async_stream(size_type capacity = default_capacity) : _m_buffer(capacity) {}
+
+    basic_async_stream(const basic_async_stream&) = delete;
+    auto operator=(const basic_async_stream&) -> basic_async_stream& = delete;
+
+    /// Append data to the end of the stream, and resume the waiting
+    /// coroutine if this is enough for its result.
+    ///
+    /// \throw std::bad_alloc if the buffer needs to grow and allocation fails.
+    void append(text_type data) {
+        _m_buffer.append(data);
+        _m_wake();
+    }
+
+    /// \return The underlying buffer, e.g. for the \c take_ functions that
+    ///         must not wait.
+    [[nodiscard]] auto buffer() noexcept -> chunked_stream_type& { return _m_buffer; }
+
+    /// Mark the end of the input, and resume the waiting coroutine.
+    void close() noexcept {
+        _m_buffer.close();
+        _m_wake();
+    }
+
+    /// Append data written to the buffer returned by \c prepare(), and
+    /// resume the waiting coroutine if this is enough for its result.
+    ///
+    /// \see basic_chunked_stream::commit()
+    void commit(size_type n) noexcept {
+        _m_buffer.commit(n);
+        _m_wake();
+    }
+
+    /// Skip a character if it is buffered already.
+    ///
+    /// \return True if the next character was \p c and has been skipped.
+    [[nodiscard]] auto consume(char_type c) noexcept -> bool { return _m_buffer.consume(c); }
+
+    /// Discard up to \p n buffered characters.
+    auto drop(size_type n = 1) noexcept -> basic_async_stream& {
+        _m_buffer.drop(n);
+        return *this;
+    }
+
+    /// \return True if there is no unconsumed data in the buffer.
+    [[nodiscard]] auto empty() const noexcept -> bool { return _m_buffer.empty(); }
+
+    /// \return True if \c close() has been called.
+    [[nodiscard]] auto eof() const noexcept -> bool { return _m_buffer.eof(); }
+
+    /// \return True if the input is closed and all data has been consumed.
+    [[nodiscard]] auto exhausted() const noexcept -> bool { return _m_buffer.exhausted(); }
+
+    /// \see basic_chunked_stream::prepare()
+    [[nodiscard]] auto prepare(size_type min_size = 1) -> std::span<char_type> { return _m_buffer.prepare(min_size); }
+
+    /// \return The number of unconsumed characters.
+    [[nodiscard]] auto size() const noexcept -> size_type { return _m_buffer.size(); }
+
+    /// \return A stream over the unconsumed data.
+    [[nodiscard]] auto stream() const noexcept -> stream_type { return _m_buffer.stream(); }
+
+    /// \return True if a coroutine is waiting for data.
+    [[nodiscard]] auto waiting() const noexcept -> bool { return _m_waiter != nullptr; }
+
+    /// Wait for N characters.
+    ///
+    /// \return The characters, or fewer if the input ends first.
+    /// \see basic_chunked_stream::take()
+    [[nodiscard]] auto take(size_type n = 1) noexcept {
+        return _m_await([n](chunked_stream_type& b) noexcept { return b.take(n); });
+    }
+
+    ///@{
+    /// \brief Wait for characters up to a delimiter.
+    ///
+    /// \return The characters before the delimiter.
+    /// \see basic_chunked_stream::take_until()
+    [[nodiscard]] auto take_until(char_type c) noexcept {
+        return _m_await([c](chunked_stream_type& b) noexcept { return b.take_until(c); });
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] auto take_until(text_type s) noexcept {
+        return _m_await([s](chunked_stream_type& b) noexcept { return b.take_until(s); });
+    }
+
+    /// \see take_until(char_type)
+    ///
+    /// \p chars must stay alive until the result is available; a temporary
+    /// in the same \c co_await expression is fine.
+    [[nodiscard]] auto take_until(const char_set_type& chars) noexcept {
+        return _m_await([&chars](chunked_stream_type& b) noexcept { return b.take_until(chars); });
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] auto take_until_any(text_type chars) noexcept {
+        return _m_await([chars](chunked_stream_type& b) noexcept { return b.take_until_any(chars); });
+    }
+    ///@}
+
+    /// \return The unconsumed data.
+    [[nodiscard]] auto text() const noexcept -> text_type { return _m_buffer.text(); }
+
+private:
+    void _m_wake() noexcept {
+        if (not _m_waiter or not _m_waiter->poll(_m_waiter)) return;
+        std::exchange(_m_waiter, nullptr)->handle.resume();
+    }
+};
+
+using async_stream = basic_async_stream<char>;
+using wasync_stream = basic_async_stream<wchar_t>;
+using u8async_stream = basic_async_stream<char8_t>;
+using u16async_stream = basic_async_stream<char16_t>;
+using u32async_stream = basic_async_stream<char32_t>;
+} // namespace streams
+
+#endif // STREAM_ASYNC_STREAM_HH
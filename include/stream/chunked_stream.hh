@@ -0,0 +1,311 @@
+#ifndef STREAM_CHUNKED_STREAM_HH
+#define STREAM_CHUNKED_STREAM_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+
+#include "stream.hh"
+
+namespace streams {
+/// \brief A refillable stream for input that arrives in pieces.
+///
+/// This owns a buffer that data can be appended to as it becomes available,
+/// e.g. after each \c read() from a socket or pipe, and which can be parsed
+/// incrementally. The \c take_ functions of this class have the same semantics
+/// as those of \c basic_stream, except that they return an empty optional and
+/// consume nothing if the buffered data is not enough to decide the result,
+/// i.e. if no delimiter has been found yet.
+///
+/// Such a failed search remembers how far it got, so when it is retried after
+/// more data has been appended, only the new data is scanned; this is what
+/// makes parsing a partial line after each read linear rather than quadratic.
+///
+/// Consumed data is discarded lazily: when there is not enough room at the end
+/// of the buffer, the unconsumed part is moved to the front first, and the
+/// buffer only grows if a single unconsumed record does not fit in it, so in
+/// the steady state, appending never reallocates.
+///
+/// Once all input has been appended, call \c close(); after that, the \c take_
+/// functions behave exactly like those of \c basic_stream, returning whatever
+/// is left if there is no delimiter, and an empty optional once the stream has
+/// been exhausted.
+///
+/// Any text returned from or views obtained from this stream are invalidated
+/// by the next call to \c append() or \c prepare().
+template <typename CharType>
+class basic_chunked_stream {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using text_opt = std::optional<text_type>;
+    using size_type = std::size_t;
+    using stream_type = basic_stream<char_type>;
+    using char_set_type = char_set<char_type>;
+
+    /// Default initial buffer size, in characters.
+    static constexpr size_type default_capacity = 64 * 1'024 / sizeof(char_type);
+
+private:
+    // Needles up to this length are stored inline in the hint; longer
+    // ones are copied to the heap.
+    static constexpr size_type _s_inline_hint_size = 16;
+
+    enum class _hint_kind {
+        none,
+        character,
+        text,
+        any,
+        set,
+    };
+
+    // What the last failed search was looking for, and how far it got.
+    struct _hint {
+        _hint_kind kind = _hint_kind::none;
+        char_type inline_chars[_s_inline_hint_size]{};
+        std::unique_ptr<char_type[]> heap_chars;
+        size_type heap_capacity = 0;
+        size_type size = 0;
+        char_set_type set{};
+        size_type scanned = 0;
+
+        [[nodiscard]] auto chars() const noexcept -> text_type {
+            return {size > _s_inline_hint_size ? heap_chars.get() : inline_chars, size};
+        }
+
+        // Store a copy of the needle. This only allocates if it is longer than
+        // any we have stored before, and returns false if that fails.
+        [[nodiscard]] auto store(text_type needle) noexcept -> bool {
+            auto out = inline_chars;
+            if (needle.size() > _s_inline_hint_size) {
+                if (needle.size() > heap_capacity) {
+                    heap_chars.reset(new (std::nothrow) char_type[needle.size()]);
+                    heap_capacity = heap_chars ? needle.size() : 0;
+                    if (not heap_chars) return false;
+                }
+                out = heap_chars.get();
+            }
+
+            std::ranges::copy(needle, out);
+            size = needle.size();
+            return true;
+        }
+    };
+
+    std::unique_ptr<char_type[]> _m_buffer;
+    size_type _m_capacity = 0;
+    size_type _m_begin = 0;
+    size_type _m_end = 0;
+    bool _m_eof = false;
+    _hint _m_hint;
+
+public:
+    /// Create a stream with an initial buffer size of \p capacity characters.
+    explicit basic_chunked_stream(size_type capacity = default_capacity)
+        : _m_buffer(std::make_unique_for_overwrite<char_type[]>(std::max<size_type>(capacity, 1))),
+          _m_capacity(std::max<size_type>(capacity, 1)) {}
+
+    /// Append data to the end of the stream.
+    ///
+    /// \throw std::bad_alloc if the buffer needs to grow and allocation fails.
+    void append(text_type data) {
+        auto out = prepare(data.size());
+        std::ranges::copy(data, out.begin());
+        commit(data.size());
+    }
+
+    /// \return The size of the buffer, in characters.
+    [[nodiscard]] auto capacity() const noexcept -> size_type { return _m_capacity; }
+
+    /// Mark the end of the input.
+    ///
+    /// After this, searches no longer wait for more data.
+    void close() noexcept { _m_eof = true; }
+
+    /// Append data written to the buffer returned by \c prepare().
+    ///
+    /// \param n The number of characters written; this must not exceed
+    ///          the size of the buffer returned by \c prepare().
+    void commit(size_type n) noexcept {
+        _m_end += std::min(n, _m_capacity - _m_end);
+    }
+
+    /// Skip a character.
+    ///
+    /// \return True if the next character was \p c and has been skipped.
+    [[nodiscard]] auto consume(char_type c) noexcept -> bool {
+        if (empty() or _m_buffer[_m_begin] != c) return false;
+        drop();
+        return true;
+    }
+
+    /// Compact the buffer by moving the unconsumed data to the front.
+    void compact() noexcept {
+        if (_m_begin == 0) return;
+        std::copy(_m_buffer.get() + _m_begin, _m_buffer.get() + _m_end, _m_buffer.get());
+        _m_end -= _m_begin;
+        _m_begin = 0;
+    }
+
+    /// Discard up to \p n characters from the stream.
+    auto drop(size_type n = 1) noexcept -> basic_chunked_stream& {
+        _m_consume(std::min(n, size()));
+        return *this;
+    }
+
+    /// \return True if there is no unconsumed data in the buffer.
+    [[nodiscard]] auto empty() const noexcept -> bool { return _m_begin == _m_end; }
+
+    /// \return True if \c close() has been called.
+    [[nodiscard]] auto eof() const noexcept -> bool { return _m_eof; }
+
+    /// \return True if the input is closed and all data has been consumed.
+    [[nodiscard]] auto exhausted() const noexcept -> bool { return _m_eof and empty(); }
+
+    /// Get a buffer that data can be written to directly.
+    ///
+    /// This is for reading data into the stream without an extra copy; call
+    /// \c commit() afterwards with the number of characters written.
+    ///
+    /// \param min_size The minimum number of characters to make room for.
+    /// \return A buffer of at least \p min_size characters.
+    /// \throw std::bad_alloc if the buffer needs to grow and allocation fails.
+    [[nodiscard]] auto prepare(size_type min_size = 1) -> std::span<char_type> {
+        if (_m_capacity - _m_end < min_size) {
+            compact();
+            if (_m_capacity - _m_end < min_size) _m_grow(_m_end + min_size);
+        }
+
+        return {_m_buffer.get() + _m_end, _m_capacity - _m_end};
+    }
+
+    /// \return The number of unconsumed characters.
+    [[nodiscard]] auto size() const noexcept -> size_type { return _m_end - _m_begin; }
+
+    /// Get a stream over the unconsumed data.
+    ///
+    /// This does not consume anything; use \c drop() to discard whatever
+    /// was parsed using the returned stream.
+    [[nodiscard]] auto stream() const noexcept -> stream_type { return stream_type{text()}; }
+
+    /// Get N characters from the stream.
+    ///
+    /// \return The characters, or an empty optional if fewer than N
+    ///         characters are buffered and the input is not closed.
+    [[nodiscard]] auto take(size_type n = 1) noexcept -> text_opt {
+        if (n > size()) {
+            if (not _m_eof or empty()) return std::nullopt;
+            n = size();
+        }
+
+        return _m_consume(n);
+    }
+
+    ///@{
+    /// \brief Get characters from the stream up to a delimiter.
+    ///
+    /// These behave like the corresponding functions of \c basic_stream, but
+    /// if no delimiter is found and the input is not closed, they return an
+    /// empty optional and consume nothing.
+    ///
+    /// \return The characters before the delimiter.
+    [[nodiscard]] auto take_until(char_type c) noexcept -> text_opt {
+        auto start = _m_resume(_hint_kind::character, text_type{&c, 1}, nullptr, 0);
+        auto pos = text().find(c, start);
+        return _m_result(pos);
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] auto take_until(text_type s) noexcept -> text_opt {
+        auto start = _m_resume(_hint_kind::text, s, nullptr, s.empty() ? 0 : s.size() - 1);
+        auto pos = text().find(s, start);
+        return _m_result(pos);
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] auto take_until(const char_set_type& chars) noexcept -> text_opt {
+        auto start = _m_resume(_hint_kind::set, {}, &chars, 0);
+        auto pos = chars.find_first(text().substr(start));
+        return _m_result(pos == text_type::npos ? pos : start + pos);
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] auto take_until_any(text_type chars) noexcept -> text_opt {
+        auto start = _m_resume(_hint_kind::any, chars, nullptr, 0);
+        auto rest = stream_type{text().substr(start)};
+        auto skipped = rest.take_until_any(chars);
+        return _m_result(rest.empty() ? text_type::npos : start + skipped.size());
+    }
+    ///@}
+
+    /// \return The unconsumed data.
+    [[nodiscard]] auto text() const noexcept -> text_type {
+        return text_type{_m_buffer.get() + _m_begin, size()};
+    }
+
+private:
+    auto _m_consume(size_type n) noexcept -> text_type {
+        auto txt = text_type{_m_buffer.get() + _m_begin, n};
+        _m_begin += n;
+        _m_hint.scanned = _m_hint.scanned > n ? _m_hint.scanned - n : 0;
+
+        // Reuse the buffer from the start if everything was consumed.
+        if (_m_begin == _m_end) _m_begin = _m_end = 0;
+        return txt;
+    }
+
+    void _m_grow(size_type min_capacity) {
+        auto cap = std::max(min_capacity, _m_capacity * 2);
+        auto buf = std::make_unique_for_overwrite<char_type[]>(cap);
+        std::copy(_m_buffer.get() + _m_begin, _m_buffer.get() + _m_end, buf.get());
+        _m_end -= _m_begin;
+        _m_begin = 0;
+        _m_buffer = std::move(buf);
+        _m_capacity = cap;
+    }
+
+    // Get the position to resume a search from. If the last failed search was
+    // for the same thing, we can skip everything it has already looked at,
+    // except for the last `overlap` characters (for multi-character needles).
+    // Otherwise, start over and remember what we’re looking for.
+    auto _m_resume(
+        _hint_kind kind,
+        text_type chars,
+        const char_set_type* set,
+        size_type overlap
+    ) noexcept -> size_type {
+        auto same = _m_hint.kind == kind and (set ? _m_hint.set == *set : _m_hint.chars() == chars);
+        if (same) return _m_hint.scanned > overlap ? _m_hint.scanned - overlap : 0;
+
+        _m_hint.kind = _hint_kind::none;
+        _m_hint.scanned = 0;
+        if (set) {
+            _m_hint.kind = kind;
+            _m_hint.set = *set;
+            _m_hint.size = 0;
+        } else if (_m_hint.store(chars)) {
+            _m_hint.kind = kind;
+        }
+
+        return 0;
+    }
+
+    auto _m_result(size_type pos) noexcept -> text_opt {
+        if (pos != text_type::npos) return _m_consume(pos);
+        if (_m_eof) return empty() ? std::nullopt : text_opt{_m_consume(size())};
+        _m_hint.scanned = size();
+        return std::nullopt;
+    }
+};
+
+using chunked_stream = basic_chunked_stream<char>;
+using wchunked_stream = basic_chunked_stream<wchar_t>;
+using u8chunked_stream = basic_chunked_stream<char8_t>;
+using u16chunked_stream = basic_chunked_stream<char16_t>;
+using u32chunked_stream = basic_chunked_stream<char32_t>;
+} // namespace streams
+
+#endif // STREAM_CHUNKED_STREAM_HH
@@ -0,0 +1,428 @@
+#ifndef STREAM_COMPRESSED_STREAM_HH
+#define STREAM_COMPRESSED_STREAM_HH
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <system_error>
+
+#include "chunked_stream.hh"
+#include "detail/file.hh"
+
+// Compressed formats are supported if the headers of the libraries that decode
+// them are available; programs that open such files must also link against
+// them, i.e. `-lz` and `-lzstd`. Define these to 0 to disable a format.
+#ifndef LIBSTREAM_ZLIB
+#    if __has_include(<zlib.h>)
+#        define LIBSTREAM_ZLIB 1
+#    else
+#        define LIBSTREAM_ZLIB 0
+#    endif
+#endif
+
+#ifndef LIBSTREAM_ZSTD
+#    if __has_include(<zstd.h>)
+#        define LIBSTREAM_ZSTD 1
+#    else
+#        define LIBSTREAM_ZSTD 0
+#    endif
+#endif
+
+#if LIBSTREAM_ZLIB
+#    include <zlib.h>
+#endif
+
+#if LIBSTREAM_ZSTD
+#    include <zstd.h>
+#endif
+
+namespace streams {
+/// The format of a compressed file.
+enum struct compression : std::uint8_t {
+    none,   ///< The file is not compressed.
+    gzip,   ///< gzip or zlib, which requires \c LIBSTREAM_ZLIB.
+    zstd,   ///< Zstandard, which requires \c LIBSTREAM_ZSTD.
+    detect, ///< Pick one of the above from the first bytes of the file.
+};
+
+namespace detail {
+// Decompresses a file into whatever buffer it is given, reading the file in
+// blocks of `input_size` bytes. This holds pointers to itself in the zlib
+// state, so it cannot be moved.
+class decompressor {
+public:
+    static constexpr std::size_t input_size = 128 * 1'024;
+
+private:
+    input_file _m_file;
+    std::uint64_t _m_offset = 0;
+    compression _m_kind = compression::none;
+    std::unique_ptr<unsigned char[]> _m_in = std::make_unique_for_overwrite<unsigned char[]>(input_size);
+    std::size_t _m_in_pos = 0;
+    std::size_t _m_in_end = 0;
+    bool _m_in_eof = false;
+    bool _m_done = false;
+
+#if LIBSTREAM_ZLIB
+    z_stream _m_z{};
+    bool _m_z_init = false;
+#endif
+
+#if LIBSTREAM_ZSTD
+    ZSTD_DStream* _m_zstd = nullptr;
+
+    // The last result of ZSTD_decompressStream(), which is 0 at the end of a
+    // frame; anything else at the end of the input means it was truncated.
+    std::size_t _m_zstd_hint = 0;
+#endif
+
+public:
+    decompressor() = default;
+    decompressor(const decompressor&) = delete;
+    auto operator=(const decompressor&) -> decompressor& = delete;
+
+    ~decompressor() noexcept {
+#if LIBSTREAM_ZLIB
+        if (_m_z_init) ::inflateEnd(&_m_z);
+#endif
+#if LIBSTREAM_ZSTD
+        if (_m_zstd) ::ZSTD_freeDStream(_m_zstd);
+#endif
+    }
+
+    [[nodiscard]] auto kind() const noexcept -> compression { return _m_kind; }
+
+    [[nodiscard]] auto open(const std::filesystem::path& path, compression c, std::error_code& ec) noexcept -> bool {
+        _m_file = input_file::open(path, ec);
+        if (ec) return false;
+        if (c == compression::detect) {
+            if (not _m_fill(ec)) return false;
+            c = _s_detect(_m_in.get(), _m_in_end);
+        }
+
+        _m_kind = c;
+        switch (c) {
+            case compression::gzip:
+#if LIBSTREAM_ZLIB
+                // Adding 32 to the window size accepts both gzip and zlib headers.
+                if (::inflateInit2(&_m_z, 15 + 32) != Z_OK) return _m_fail(ec, std::errc::not_enough_memory);
+                _m_z_init = true;
+                return true;
+#else
+                return _m_fail(ec, std::errc::not_supported);
+#endif
+            case compression::zstd:
+#if LIBSTREAM_ZSTD
+                _m_zstd = ::ZSTD_createDStream();
+                if (not _m_zstd or ::ZSTD_isError(::ZSTD_initDStream(_m_zstd))) return _m_fail(ec, std::errc::not_enough_memory);
+                return true;
+#else
+                return _m_fail(ec, std::errc::not_supported);
+#endif
+            default:
+                return true;
+        }
+    }
+
+    // Decompress up to `n` bytes; this only returns 0 at the end of the data
+    // or on error.
+    [[nodiscard]] auto read(void* out, std::size_t n, std::error_code& ec) noexcept -> std::size_t {
+        if (_m_done or n == 0) return 0;
+        switch (_m_kind) {
+#if LIBSTREAM_ZLIB
+            case compression::gzip: return _m_read_gzip(static_cast<unsigned char*>(out), n, ec);
+#endif
+#if LIBSTREAM_ZSTD
+            case compression::zstd: return _m_read_zstd(out, n, ec);
+#endif
+            default: return _m_read_plain(static_cast<unsigned char*>(out), n, ec);
+        }
+    }
+
+private:
+    [[nodiscard]] static auto _s_detect(const unsigned char* p, std::size_t n) noexcept -> compression {
+        if (n >= 2 and p[0] == 0x1F and p[1] == 0x8B) return compression::gzip;
+        if (n >= 4 and p[0] == 0x28 and p[1] == 0xB5 and p[2] == 0x2F and p[3] == 0xFD) return compression::zstd;
+        return compression::none;
+    }
+
+    auto _m_fail(std::error_code& ec, std::errc e) noexcept -> bool {
+        ec = std::make_error_code(e);
+        _m_done = true;
+        return false;
+    }
+
+    // Read the next block of input, if there is one.
+    auto _m_fill(std::error_code& ec) noexcept -> bool {
+        auto got = _m_file.read(_m_in.get(), input_size, _m_offset, ec);
+        _m_offset += got;
+        _m_in_pos = 0;
+        _m_in_end = got;
+        _m_in_eof = got < input_size;
+        if (ec) _m_done = true;
+        return not ec;
+    }
+
+    // Whatever is left of the first block, which was read to detect the
+    // format, is copied out first.
+    auto _m_read_plain(unsigned char* out, std::size_t n, std::error_code& ec) noexcept -> std::size_t {
+        if (_m_in_pos != _m_in_end) {
+            auto k = std::min(n, _m_in_end - _m_in_pos);
+            std::memcpy(out, _m_in.get() + _m_in_pos, k);
+            _m_in_pos += k;
+            return k;
+        }
+
+        auto got = _m_file.read(out, n, _m_offset, ec);
+        _m_offset += got;
+        if (ec or got == 0) _m_done = true;
+        return got;
+    }
+
+#if LIBSTREAM_ZLIB
+    // A file can consist of several gzip members, which decompress to their
+    // concatenation, so start over whenever one ends and there is more input.
+    auto _m_read_gzip(unsigned char* out, std::size_t n, std::error_code& ec) noexcept -> std::size_t {
+        for (;;) {
+            if (_m_in_pos == _m_in_end and not _m_in_eof and not _m_fill(ec)) return 0;
+            _m_z.next_in = _m_in.get() + _m_in_pos;
+            _m_z.avail_in = uInt(_m_in_end - _m_in_pos);
+            _m_z.next_out = out;
+            _m_z.avail_out = uInt(std::min<std::size_t>(n, UINT_MAX));
+            auto ret = ::inflate(&_m_z, Z_NO_FLUSH);
+            _m_in_pos = _m_in_end - _m_z.avail_in;
+            auto produced = std::size_t(_m_z.next_out - out);
+
+            if (ret == Z_STREAM_END) {
+                if (_m_in_pos == _m_in_end and not _m_in_eof and not _m_fill(ec)) return produced;
+                if (_m_in_pos == _m_in_end) _m_done = true;
+                else ::inflateReset(&_m_z);
+            } else if (ret != Z_OK and ret != Z_BUF_ERROR) {
+                _m_fail(ec, std::errc::io_error);
+                return produced;
+            } else if (produced == 0 and _m_in_pos == _m_in_end and _m_in_eof) {
+                // Nothing is pending and there is no more input, but the
+                // member has not ended, so the file was cut off.
+                _m_fail(ec, std::errc::io_error);
+                return 0;
+            }
+
+            if (produced != 0 or _m_done) return produced;
+        }
+    }
+#endif
+
+#if LIBSTREAM_ZSTD
+    // The decoder moves on to the next frame by itself, so concatenated
+    // frames need no special handling.
+    auto _m_read_zstd(void* out, std::size_t n, std::error_code& ec) noexcept -> std::size_t {
+        for (;;) {
+            if (_m_in_pos == _m_in_end and _m_zstd_hint == 0 and _m_in_eof) {
+                _m_done = true;
+                return 0;
+            }
+
+            if (_m_in_pos == _m_in_end and not _m_in_eof and not _m_fill(ec)) return 0;
+            ZSTD_inBuffer in{_m_in.get(), _m_in_end, _m_in_pos};
+            ZSTD_outBuffer o{out, n, 0};
+            auto ret = ::ZSTD_decompressStream(_m_zstd, &o, &in);
+            _m_in_pos = in.pos;
+            if (::ZSTD_isError(ret)) {
+                _m_fail(ec, std::errc::io_error);
+                return o.pos;
+            }
+
+            _m_zstd_hint = ret;
+            if (o.pos != 0) return o.pos;
+
+            // No progress at all with the input used up means it was cut off.
+            if (_m_in_pos == _m_in_end and _m_in_eof and ret != 0) {
+                _m_fail(ec, std::errc::io_error);
+                return 0;
+            }
+        }
+    }
+#endif
+};
+} // namespace detail
+
+/// \brief A stream over a file that is decompressed as it is parsed.
+///
+/// This decompresses a gzip or Zstandard file (or reads an uncompressed one)
+/// into a \c basic_chunked_stream, which acts as a window onto the data: the
+/// \c take_ functions of this class behave like those of \c basic_stream, and
+/// whenever the window does not hold enough data to decide the result, more
+/// is decompressed into it, after moving the unconsumed data to its front.
+///
+/// \code
+///     std::error_code ec;
+///     auto s = compressed_stream::open("access.log.gz", ec);
+///     while (auto line = s->take_until('\n')) {
+///         s->drop();
+///         parse(*line);
+///     }
+/// \endcode
+///
+/// Memory use is thus bounded by the size of the window rather than that of
+/// the file; the window only grows if a single record takes up most of it.
+/// Records are never split by the edges of the decompressed blocks.
+///
+/// If the file is corrupt or cannot be read, the stream ends early, as if the
+/// file had ended there, and \c error() returns the reason; for compressed data
+/// that is corrupt or cut off, that is \c std::errc::io_error.
+///
+/// Any text returned from this stream is invalidated by the next call to one
+/// of its \c take_ functions or to \c refill().
+template <typename CharType>
+class basic_compressed_stream {
+    static_assert(sizeof(CharType) == 1, "Compressed streams are only supported for single-byte character types");
+
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using text_opt = std::optional<text_type>;
+    using size_type = std::size_t;
+    using stream_type = basic_stream<char_type>;
+    using char_set_type = char_set<char_type>;
+    using chunked_stream_type = basic_chunked_stream<char_type>;
+
+    /// Default size of the window, in characters.
+    static constexpr size_type default_capacity = 256 * 1'024;
+
+private:
+    chunked_stream_type _m_buffer;
+    std::unique_ptr<detail::decompressor> _m_decoder;
+    std::error_code _m_error;
+
+    explicit basic_compressed_stream(size_type capacity)
+        : _m_buffer(capacity), _m_decoder(std::make_unique<detail::decompressor>()) {}
+
+public:
+    /// Open a file for reading.
+    ///
+    /// \param path The file to open.
+    /// \param ec Set to the reason if the file could not be opened, or if
+    ///           it is compressed in a format that is not supported.
+    /// \param c The format of the file.
+    /// \param capacity The initial size of the window, in characters.
+    /// \return The stream, or an empty optional on error.
+    [[nodiscard]] static auto open(
+        const std::filesystem::path& path,
+        std::error_code& ec,
+        compression c = compression::detect,
+        size_type capacity = default_capacity
+    ) -> std::optional<basic_compressed_stream> {
+        ec.clear();
+        basic_compressed_stream s{capacity};
+        if (not s._m_decoder->open(path, c, ec)) return std::nullopt;
+        return s;
+    }
+
+    /// \return The window the file is decompressed into, e.g. to parse
+    ///         the buffered data directly; call \c refill() to add more.
+    [[nodiscard]] auto buffer() noexcept -> chunked_stream_type& { return _m_buffer; }
+
+    /// \return The format of the file.
+    [[nodiscard]] auto compression_format() const noexcept -> compression { return _m_decoder->kind(); }
+
+    /// Skip a character, decompressing more data first if the window is empty.
+    ///
+    /// \return True if the next character was \p c and has been skipped.
+    [[nodiscard]] auto consume(char_type c) -> bool {
+        if (_m_buffer.empty() and not _m_buffer.eof()) refill();
+        return _m_buffer.consume(c);
+    }
+
+    /// Discard up to \p n characters from the window.
+    auto drop(size_type n = 1) noexcept -> basic_compressed_stream& {
+        _m_buffer.drop(n);
+        return *this;
+    }
+
+    /// \return True if there is no unconsumed data in the window.
+    [[nodiscard]] auto empty() const noexcept -> bool { return _m_buffer.empty(); }
+
+    /// \return The reason the stream ended early, if it did.
+    [[nodiscard]] auto error() const noexcept -> std::error_code { return _m_error; }
+
+    /// \return True if the whole file has been decompressed and consumed.
+    [[nodiscard]] auto exhausted() const noexcept -> bool { return _m_buffer.exhausted(); }
+
+    /// Decompress the next block of the file into the window.
+    ///
+    /// \return False if the end of the file (or an error) was reached,
+    ///         in which case the window is closed.
+    /// \throw std::bad_alloc if the window needs to grow and allocation fails.
+    auto refill() -> bool {
+        if (_m_buffer.eof()) return false;
+
+        // Asking for a fair part of the window makes sure that what is
+        // decompressed at once is never tiny.
+        auto out = _m_buffer.prepare(std::max<size_type>(_m_buffer.capacity() / 4, 1));
+        auto n = _m_decoder->read(out.data(), out.size(), _m_error);
+        _m_buffer.commit(n);
+        if (n == 0) _m_buffer.close();
+        return n != 0;
+    }
+
+    /// \return A stream over the unconsumed data in the window.
+    [[nodiscard]] auto stream() const noexcept -> stream_type { return _m_buffer.stream(); }
+
+    /// Get N characters from the stream.
+    ///
+    /// \return The characters, or fewer if the file ends first, or an
+    ///         empty optional if the stream is exhausted.
+    [[nodiscard]] auto take(size_type n = 1) -> text_opt {
+        return _m_take([n](chunked_stream_type& b) { return b.take(n); });
+    }
+
+    ///@{
+    /// \brief Get characters from the stream up to a delimiter.
+    ///
+    /// \return The characters before the delimiter, or the rest of the file
+    ///         if there is none, or an empty optional if the stream is
+    ///         exhausted.
+    /// \see basic_chunked_stream::take_until()
+    [[nodiscard]] auto take_until(char_type c) -> text_opt {
+        return _m_take([c](chunked_stream_type& b) { return b.take_until(c); });
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] auto take_until(text_type s) -> text_opt {
+        return _m_take([s](chunked_stream_type& b) { return b.take_until(s); });
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] auto take_until(const char_set_type& chars) -> text_opt {
+        return _m_take([&chars](chunked_stream_type& b) { return b.take_until(chars); });
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] auto take_until_any(text_type chars) -> text_opt {
+        return _m_take([chars](chunked_stream_type& b) { return b.take_until_any(chars); });
+    }
+    ///@}
+
+private:
+    // Failed searches remember how far they got, so retrying after each
+    // refill only scans the new data.
+    template <typename Take>
+    auto _m_take(Take take) -> text_opt {
+        for (;;) {
+            if (auto r = take(_m_buffer)) return r;
+            if (_m_buffer.eof()) return std::nullopt;
+            refill();
+        }
+    }
+};
+
+using compressed_stream = basic_compressed_stream<char>;
+using u8compressed_stream = basic_compressed_stream<char8_t>;
+} // namespace streams
+
+#endif // STREAM_COMPRESSED_STREAM_HH
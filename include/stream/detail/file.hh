@@ -0,0 +1,129 @@
+#ifndef STREAM_DETAIL_FILE_HH
+#define STREAM_DETAIL_FILE_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#else
+#    include <cerrno>
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
+
+namespace streams::detail {
+// A file that is read at explicit offsets; errors are reported as error codes
+// since a file that cannot be read should not stop the rest of a batch.
+class input_file {
+#ifdef _WIN32
+    HANDLE _m_handle = INVALID_HANDLE_VALUE;
+#else
+    int _m_fd = -1;
+#endif
+
+public:
+    input_file() = default;
+
+    input_file(const input_file&) = delete;
+    auto operator=(const input_file&) -> input_file& = delete;
+
+#ifdef _WIN32
+    input_file(input_file&& other) noexcept : _m_handle(std::exchange(other._m_handle, INVALID_HANDLE_VALUE)) {}
+    auto operator=(input_file&& other) noexcept -> input_file& {
+        std::swap(_m_handle, other._m_handle);
+        return *this;
+    }
+
+    ~input_file() noexcept {
+        if (_m_handle != INVALID_HANDLE_VALUE) ::CloseHandle(_m_handle);
+    }
+#else
+    input_file(input_file&& other) noexcept : _m_fd(std::exchange(other._m_fd, -1)) {}
+    auto operator=(input_file&& other) noexcept -> input_file& {
+        std::swap(_m_fd, other._m_fd);
+        return *this;
+    }
+
+    ~input_file() noexcept {
+        if (_m_fd >= 0) ::close(_m_fd);
+    }
+#endif
+
+    [[nodiscard]] static auto open(const std::filesystem::path& path, std::error_code& ec) noexcept -> input_file {
+        input_file f;
+#ifdef _WIN32
+        f._m_handle = ::CreateFileW(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr
+        );
+
+        if (f._m_handle == INVALID_HANDLE_VALUE) ec = {int(::GetLastError()), std::system_category()};
+#else
+        f._m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (f._m_fd < 0) ec = {errno, std::system_category()};
+#    ifdef POSIX_FADV_SEQUENTIAL
+        else ::posix_fadvise(f._m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#    endif
+#endif
+        return f;
+    }
+
+    // Read up to `n` bytes at `offset`; this only returns fewer than `n`
+    // bytes at the end of the file or on error.
+    [[nodiscard]] auto read(void* p, std::size_t n, std::uint64_t offset, std::error_code& ec) noexcept -> std::size_t {
+        auto out = static_cast<char*>(p);
+        std::size_t done = 0;
+        while (done < n) {
+#ifdef _WIN32
+            OVERLAPPED at{};
+            at.Offset = DWORD(offset + done);
+            at.OffsetHigh = DWORD((offset + done) >> 32);
+            DWORD got = 0;
+            auto want = DWORD(std::min<std::size_t>(n - done, 1 << 30));
+            if (not ::ReadFile(_m_handle, out + done, want, &got, &at)) {
+                if (::GetLastError() == ERROR_HANDLE_EOF) break;
+                ec = {int(::GetLastError()), std::system_category()};
+                break;
+            }
+#else
+            auto got = ::pread(_m_fd, out + done, n - done, off_t(offset + done));
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                ec = {errno, std::system_category()};
+                break;
+            }
+#endif
+            if (got == 0) break;
+            done += std::size_t(got);
+        }
+
+        return done;
+    }
+
+    // Ask the kernel to start reading a range of the file in the background;
+    // this is only a hint, so errors are ignored.
+    void prefetch([[maybe_unused]] std::uint64_t offset, [[maybe_unused]] std::size_t n) noexcept {
+#if not defined(_WIN32) and defined(POSIX_FADV_WILLNEED)
+        ::posix_fadvise(_m_fd, off_t(offset), off_t(n), POSIX_FADV_WILLNEED);
+#endif
+    }
+};
+} // namespace streams::detail
+
+#endif // STREAM_DETAIL_FILE_HH
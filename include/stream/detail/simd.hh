@@ -0,0 +1,1724 @@
+#ifndef STREAM_DETAIL_SIMD_HH
+#define STREAM_DETAIL_SIMD_HH
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+#ifndef LIBSTREAM_SIMD
+#    define LIBSTREAM_SIMD 1
+#endif
+
+#if LIBSTREAM_SIMD and (defined(__x86_64__) or defined(_M_X64) or defined(__i386__))
+#    if defined(__AVX2__)
+#        define LIBSTREAM_SIMD_AVX2 1
+#    endif
+#    if defined(__SSSE3__) or defined(__AVX2__)
+#        define LIBSTREAM_SIMD_SSSE3 1
+#    endif
+#    if defined(__SSE2__) or defined(_M_X64) or defined(__SSSE3__)
+#        define LIBSTREAM_SIMD_SSE2 1
+#        include <immintrin.h>
+#    endif
+#elif LIBSTREAM_SIMD and defined(__ARM_NEON) and defined(__aarch64__)
+#    define LIBSTREAM_SIMD_NEON 1
+#    include <arm_neon.h>
+#endif
+
+// Binaries built for baseline x86-64 can still use the SSSE3 and AVX2
+// kernels if they are compiled with the `target` attribute and picked at
+// runtime; see the dispatch section below. There is nothing better to
+// dispatch to if AVX2 is already enabled.
+#ifndef LIBSTREAM_DISPATCH
+#    define LIBSTREAM_DISPATCH 1
+#endif
+
+#if LIBSTREAM_DISPATCH and LIBSTREAM_SIMD_SSE2 and defined(__x86_64__) and defined(__GNUC__) and not LIBSTREAM_SIMD_AVX2
+#    define LIBSTREAM_SIMD_DISPATCH 1
+#    include <cstdlib>
+#    define LIBSTREAM_TARGET_AVX2 [[gnu::target("avx2")]]
+#    define LIBSTREAM_SIMD_ALWAYS_INLINE __attribute__((always_inline))
+#    if LIBSTREAM_SIMD_SSSE3
+#        define LIBSTREAM_TARGET_SSSE3
+#    else
+#        define LIBSTREAM_TARGET_SSSE3 [[gnu::target("ssse3")]]
+#    endif
+#else
+#    define LIBSTREAM_TARGET_AVX2
+#    define LIBSTREAM_TARGET_SSSE3
+#    define LIBSTREAM_SIMD_ALWAYS_INLINE
+#endif
+
+namespace streams::detail {
+inline constexpr std::size_t npos = std::size_t(-1);
+
+/// \brief A 256-bit membership table for single-byte code units.
+///
+/// Bit `(b >> 4) & 7` of `lo[b & 15]` (for `b < 0x80`) or `hi[b & 15]`
+/// (for `b >= 0x80`) is set iff `b` is in the set. This is just a
+/// bitmap, but laid out so that the two halves can be used directly
+/// as shuffle tables by the vectorised kernels below.
+struct byte_set {
+    alignas(16) std::uint8_t lo[16]{};
+    alignas(16) std::uint8_t hi[16]{};
+
+    constexpr void insert(std::uint8_t b) noexcept {
+        (b & 0x80 ? hi : lo)[b & 15] |= std::uint8_t(1u << ((b >> 4) & 7));
+    }
+
+    [[nodiscard]] constexpr auto
+    contains(std::uint8_t b) const noexcept -> bool {
+        return (b & 0x80 ? hi : lo)[b & 15] & (1u << ((b >> 4) & 7));
+    }
+
+    [[nodiscard]] friend constexpr auto
+    operator==(const byte_set&, const byte_set&) noexcept -> bool = default;
+};
+
+/// Build a byte set from a list of characters.
+///
+/// Characters that do not fit in a single byte are ignored; callers
+/// are responsible for handling those themselves.
+template <typename CharType>
+[[nodiscard]] constexpr auto make_byte_set(std::basic_string_view<CharType> chars) noexcept -> byte_set {
+    byte_set s;
+    for (auto c : chars)
+        if (std::make_unsigned_t<CharType>(c) < 256)
+            s.insert(std::uint8_t(c));
+    return s;
+}
+
+/// The unsigned type that the kernels load code units of type \c CharType as.
+template <typename CharType>
+using lane_type = std::conditional_t<
+    sizeof(CharType) == 1,
+    std::uint8_t,
+    std::conditional_t<sizeof(CharType) == 2, std::uint16_t, std::uint32_t>
+>;
+
+// ============================================================================
+//  Vector kernels.
+//
+//  Each kernel classifies one block of bytes at a time and returns a mask
+//  with `1 << shift` bits per byte, set for bytes that are in the set. The
+//  generic loops below then only need to scan those masks.
+//
+//  The membership test for a byte `b` is a pair of table lookups: the low
+//  nibble selects an entry in `lo` or `hi` (shuffles return 0 for indices
+//  with their top bit set, which is how we pick the right half), and the
+//  high nibble selects the bit to test.
+// ============================================================================
+#if LIBSTREAM_SIMD_SSSE3 or LIBSTREAM_SIMD_DISPATCH
+struct ssse3_kernel {
+    using unit_type = std::uint8_t;
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 0;
+    static constexpr mask_type all = 0xFFFF;
+
+    __m128i lo, hi;
+
+    LIBSTREAM_TARGET_SSSE3 explicit ssse3_kernel(const byte_set& s) noexcept
+        : lo(_mm_load_si128(reinterpret_cast<const __m128i*>(s.lo))),
+          hi(_mm_load_si128(reinterpret_cast<const __m128i*>(s.hi))) {}
+
+    LIBSTREAM_TARGET_SSSE3 [[nodiscard]] auto match(const std::uint8_t* p) const noexcept -> mask_type {
+        return ~mask_type(_mm_movemask_epi8(misses(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))))) & all;
+    }
+
+    // 0xFF for every byte of `v` that is not in the set.
+    LIBSTREAM_TARGET_SSSE3 [[nodiscard]] auto misses(__m128i v) const noexcept -> __m128i {
+        const auto idx = _mm_set1_epi8(char(0x8F));
+        const auto top = _mm_set1_epi8(char(0x80));
+        const auto bits = _mm_set1_epi64x(0x8040'2010'0804'0201);
+        const auto m = _mm_or_si128(
+            _mm_shuffle_epi8(lo, _mm_and_si128(v, idx)),
+            _mm_shuffle_epi8(hi, _mm_and_si128(_mm_xor_si128(v, top), idx))
+        );
+        const auto bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F)));
+        return _mm_cmpeq_epi8(_mm_and_si128(m, bit), _mm_setzero_si128());
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2 or LIBSTREAM_SIMD_DISPATCH
+struct avx2_kernel {
+    using unit_type = std::uint8_t;
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 32;
+    static constexpr std::size_t shift = 0;
+    static constexpr mask_type all = 0xFFFF'FFFF;
+
+    __m256i lo, hi;
+
+    LIBSTREAM_TARGET_AVX2 explicit avx2_kernel(const byte_set& s) noexcept
+        : lo(_mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(s.lo)))),
+          hi(_mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(s.hi)))) {}
+
+    LIBSTREAM_TARGET_AVX2 [[nodiscard]] auto match(const std::uint8_t* p) const noexcept -> mask_type {
+        return ~mask_type(_mm256_movemask_epi8(misses(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)))));
+    }
+
+    // 0xFF for every byte of `v` that is not in the set.
+    LIBSTREAM_TARGET_AVX2 [[nodiscard]] auto misses(__m256i v) const noexcept -> __m256i {
+        const auto idx = _mm256_set1_epi8(char(0x8F));
+        const auto top = _mm256_set1_epi8(char(0x80));
+        const auto bits = _mm256_set1_epi64x(0x8040'2010'0804'0201);
+        const auto m = _mm256_or_si256(
+            _mm256_shuffle_epi8(lo, _mm256_and_si256(v, idx)),
+            _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_xor_si256(v, top), idx))
+        );
+        const auto bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F)));
+        return _mm256_cmpeq_epi8(_mm256_and_si256(m, bit), _mm256_setzero_si256());
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_NEON
+// There is no movemask on NEON; narrow a vector of 0x00/0xFF bytes to 4
+// bits per byte instead.
+[[nodiscard]] inline auto neon_movemask(uint8x16_t v) noexcept -> std::uint64_t {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+}
+
+struct neon_kernel {
+    using unit_type = std::uint8_t;
+    using mask_type = std::uint64_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 2;
+    static constexpr mask_type all = ~mask_type(0);
+
+    uint8x16x2_t tables;
+
+    explicit neon_kernel(const byte_set& s) noexcept
+        : tables{vld1q_u8(s.lo), vld1q_u8(s.hi)} {}
+
+    [[nodiscard]] auto match(const std::uint8_t* p) const noexcept -> mask_type {
+        return neon_movemask(hits(vld1q_u8(p)));
+    }
+
+    // 0xFF for every byte of `v` that is in the set.
+    [[nodiscard]] auto hits(uint8x16_t v) const noexcept -> uint8x16_t {
+        static constexpr std::uint8_t bit_table[16]{1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+
+        // Move the top bit into bit 4 to select between the two tables.
+        const auto idx = vorrq_u8(vandq_u8(v, vdupq_n_u8(0x0F)), vandq_u8(vshrq_n_u8(v, 3), vdupq_n_u8(0x10)));
+        const auto m = vqtbl2q_u8(tables, idx);
+        const auto bit = vqtbl1q_u8(vld1q_u8(bit_table), vshrq_n_u8(v, 4));
+        return vtstq_u8(m, bit);
+    }
+};
+#endif
+
+// ============================================================================
+//  Kernels for wider code units.
+//
+//  These load a block of 16- or 32-bit code units and narrow it to one byte
+//  per code unit, so that the result can be classified like a block of bytes
+//  and yields the same masks as the byte kernels above. Narrowing saturates,
+//  so code units that do not fit in a byte are tracked separately; they are
+//  never in a byte set.
+//
+//  The equality kernels find a single code unit, which may be wider than a
+//  byte, and work with plain SSE2. For bytes, `char_traits::find()` already
+//  calls `memchr()`, so they are only needed to visit every match.
+// ============================================================================
+#if LIBSTREAM_SIMD_SSE2
+template <typename Unit>
+struct sse2_lanes;
+
+template <>
+struct sse2_lanes<std::uint8_t> {
+    static auto splat(std::uint8_t c) noexcept -> __m128i { return _mm_set1_epi8(char(c)); }
+    static auto equal(const std::uint8_t* p, __m128i c) noexcept -> __m128i {
+        return _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), c);
+    }
+};
+
+template <>
+struct sse2_lanes<std::uint16_t> {
+    static auto splat(std::uint16_t c) noexcept -> __m128i { return _mm_set1_epi16(short(c)); }
+
+    // Narrow the code units at `p` to their low bytes; `fits` is set to
+    // 0xFF for those that fit in a byte.
+    static auto narrow(const std::uint16_t* p, __m128i& fits) noexcept -> __m128i {
+        const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+        const auto low = _mm_set1_epi16(0xFF);
+        fits = _mm_cmpeq_epi8(_mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)), _mm_setzero_si128());
+        return _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+    }
+
+    static auto equal(const std::uint16_t* p, __m128i c) noexcept -> __m128i {
+        return _mm_packs_epi16(
+            _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), c),
+            _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8)), c)
+        );
+    }
+};
+
+template <>
+struct sse2_lanes<std::uint32_t> {
+    static auto splat(std::uint32_t c) noexcept -> __m128i { return _mm_set1_epi32(int(c)); }
+
+    // Signed saturation preserves both 0x00/0xFF masks and whether a value
+    // is zero, which is all we need here.
+    static auto narrow(const std::uint32_t* p, __m128i& fits) noexcept -> __m128i {
+        __m128i v[4], high[4];
+        const auto low = _mm_set1_epi32(0xFF);
+        for (int i = 0; i < 4; ++i) {
+            v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4 * i));
+            high[i] = _mm_srli_epi32(v[i], 8);
+            v[i] = _mm_and_si128(v[i], low);
+        }
+
+        fits = _mm_cmpeq_epi8(
+            _mm_packus_epi16(_mm_packs_epi32(high[0], high[1]), _mm_packs_epi32(high[2], high[3])),
+            _mm_setzero_si128()
+        );
+        return _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+    }
+
+    static auto equal(const std::uint32_t* p, __m128i c) noexcept -> __m128i {
+        __m128i v[4];
+        for (int i = 0; i < 4; ++i) v[i] = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4 * i)), c);
+        return _mm_packs_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+    }
+};
+
+template <typename Unit>
+struct sse2_eq_kernel {
+    using unit_type = Unit;
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 0;
+    static constexpr mask_type all = 0xFFFF;
+
+    __m128i c;
+
+    explicit sse2_eq_kernel(Unit u) noexcept : c(sse2_lanes<Unit>::splat(u)) {}
+
+    [[nodiscard]] auto match(const Unit* p) const noexcept -> mask_type {
+        return mask_type(_mm_movemask_epi8(sse2_lanes<Unit>::equal(p, c)));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_SSSE3 or LIBSTREAM_SIMD_DISPATCH
+template <typename Unit>
+struct ssse3_wide_kernel {
+    using unit_type = Unit;
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 0;
+    static constexpr mask_type all = 0xFFFF;
+
+    ssse3_kernel bytes;
+
+    LIBSTREAM_TARGET_SSSE3 explicit ssse3_wide_kernel(const byte_set& s) noexcept : bytes(s) {}
+
+    LIBSTREAM_TARGET_SSSE3 [[nodiscard]] auto match(const Unit* p) const noexcept -> mask_type {
+        __m128i fits;
+        const auto v = sse2_lanes<Unit>::narrow(p, fits);
+        return mask_type(_mm_movemask_epi8(_mm_andnot_si128(bytes.misses(v), fits)));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2 or LIBSTREAM_SIMD_DISPATCH
+// Packing works within 128-bit lanes, so the bytes these produce are out
+// of order; `order()` puts them back in order. This is cheaper if done
+// once, after classifying the bytes.
+template <typename Unit>
+struct avx2_lanes;
+
+template <>
+struct avx2_lanes<std::uint8_t> {
+    LIBSTREAM_TARGET_AVX2 static auto splat(std::uint8_t c) noexcept -> __m256i { return _mm256_set1_epi8(char(c)); }
+    LIBSTREAM_TARGET_AVX2 static auto order(__m256i v) noexcept -> __m256i { return v; }
+    LIBSTREAM_TARGET_AVX2 static auto equal(const std::uint8_t* p, __m256i c) noexcept -> __m256i {
+        return _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), c);
+    }
+};
+
+template <>
+struct avx2_lanes<std::uint16_t> {
+    LIBSTREAM_TARGET_AVX2 static auto splat(std::uint16_t c) noexcept -> __m256i { return _mm256_set1_epi16(short(c)); }
+    LIBSTREAM_TARGET_AVX2 static auto order(__m256i v) noexcept -> __m256i { return _mm256_permute4x64_epi64(v, 0xD8); }
+
+    LIBSTREAM_TARGET_AVX2 static auto narrow(const std::uint16_t* p, __m256i& fits) noexcept -> __m256i {
+        const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 16));
+        const auto low = _mm256_set1_epi16(0xFF);
+        fits = _mm256_cmpeq_epi8(_mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)), _mm256_setzero_si256());
+        return _mm256_packus_epi16(_mm256_and_si256(a, low), _mm256_and_si256(b, low));
+    }
+
+    LIBSTREAM_TARGET_AVX2 static auto equal(const std::uint16_t* p, __m256i c) noexcept -> __m256i {
+        return _mm256_packs_epi16(
+            _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), c),
+            _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 16)), c)
+        );
+    }
+};
+
+template <>
+struct avx2_lanes<std::uint32_t> {
+    LIBSTREAM_TARGET_AVX2 static auto splat(std::uint32_t c) noexcept -> __m256i { return _mm256_set1_epi32(int(c)); }
+    LIBSTREAM_TARGET_AVX2 static auto order(__m256i v) noexcept -> __m256i {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+
+    LIBSTREAM_TARGET_AVX2 static auto narrow(const std::uint32_t* p, __m256i& fits) noexcept -> __m256i {
+        __m256i v[4], high[4];
+        const auto low = _mm256_set1_epi32(0xFF);
+        for (int i = 0; i < 4; ++i) {
+            v[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 8 * i));
+            high[i] = _mm256_srli_epi32(v[i], 8);
+            v[i] = _mm256_and_si256(v[i], low);
+        }
+
+        fits = _mm256_cmpeq_epi8(
+            _mm256_packus_epi16(_mm256_packs_epi32(high[0], high[1]), _mm256_packs_epi32(high[2], high[3])),
+            _mm256_setzero_si256()
+        );
+        return _mm256_packus_epi16(_mm256_packs_epi32(v[0], v[1]), _mm256_packs_epi32(v[2], v[3]));
+    }
+
+    LIBSTREAM_TARGET_AVX2 static auto equal(const std::uint32_t* p, __m256i c) noexcept -> __m256i {
+        __m256i v[4];
+        for (int i = 0; i < 4; ++i) v[i] = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 8 * i)), c);
+        return _mm256_packs_epi16(_mm256_packs_epi32(v[0], v[1]), _mm256_packs_epi32(v[2], v[3]));
+    }
+};
+
+template <typename Unit>
+struct avx2_wide_kernel {
+    using unit_type = Unit;
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 32;
+    static constexpr std::size_t shift = 0;
+    static constexpr mask_type all = 0xFFFF'FFFF;
+
+    avx2_kernel bytes;
+
+    LIBSTREAM_TARGET_AVX2 explicit avx2_wide_kernel(const byte_set& s) noexcept : bytes(s) {}
+
+    LIBSTREAM_TARGET_AVX2 [[nodiscard]] auto match(const Unit* p) const noexcept -> mask_type {
+        __m256i fits;
+        const auto v = avx2_lanes<Unit>::narrow(p, fits);
+        return mask_type(_mm256_movemask_epi8(avx2_lanes<Unit>::order(_mm256_andnot_si256(bytes.misses(v), fits))));
+    }
+};
+
+template <typename Unit>
+struct avx2_eq_kernel {
+    using unit_type = Unit;
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 32;
+    static constexpr std::size_t shift = 0;
+    static constexpr mask_type all = 0xFFFF'FFFF;
+
+    __m256i c;
+
+    LIBSTREAM_TARGET_AVX2 explicit avx2_eq_kernel(Unit u) noexcept : c(avx2_lanes<Unit>::splat(u)) {}
+
+    LIBSTREAM_TARGET_AVX2 [[nodiscard]] auto match(const Unit* p) const noexcept -> mask_type {
+        return mask_type(_mm256_movemask_epi8(avx2_lanes<Unit>::order(avx2_lanes<Unit>::equal(p, c))));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_NEON
+template <typename Unit>
+struct neon_lanes;
+
+template <>
+struct neon_lanes<std::uint8_t> {
+    static auto splat(std::uint8_t c) noexcept -> uint8x16_t { return vdupq_n_u8(c); }
+    static auto equal(const std::uint8_t* p, uint8x16_t c) noexcept -> uint8x16_t { return vceqq_u8(vld1q_u8(p), c); }
+};
+
+template <>
+struct neon_lanes<std::uint16_t> {
+    static auto splat(std::uint16_t c) noexcept -> uint16x8_t { return vdupq_n_u16(c); }
+
+    static auto narrow(const std::uint16_t* p, uint8x16_t& fits) noexcept -> uint8x16_t {
+        const auto a = vld1q_u16(p);
+        const auto b = vld1q_u16(p + 8);
+        fits = vceqq_u8(vcombine_u8(vshrn_n_u16(a, 8), vshrn_n_u16(b, 8)), vdupq_n_u8(0));
+        return vcombine_u8(vmovn_u16(a), vmovn_u16(b));
+    }
+
+    static auto equal(const std::uint16_t* p, uint16x8_t c) noexcept -> uint8x16_t {
+        return vcombine_u8(vmovn_u16(vceqq_u16(vld1q_u16(p), c)), vmovn_u16(vceqq_u16(vld1q_u16(p + 8), c)));
+    }
+};
+
+template <>
+struct neon_lanes<std::uint32_t> {
+    static auto splat(std::uint32_t c) noexcept -> uint32x4_t { return vdupq_n_u32(c); }
+
+    // Use saturating narrowing for the high bits so that nothing that is
+    // non-zero becomes zero.
+    static auto narrow(const std::uint32_t* p, uint8x16_t& fits) noexcept -> uint8x16_t {
+        uint32x4_t v[4];
+        for (int i = 0; i < 4; ++i) v[i] = vld1q_u32(p + 4 * i);
+        const auto high_a = vcombine_u16(vqshrn_n_u32(v[0], 8), vqshrn_n_u32(v[1], 8));
+        const auto high_b = vcombine_u16(vqshrn_n_u32(v[2], 8), vqshrn_n_u32(v[3], 8));
+        fits = vceqq_u8(vcombine_u8(vqmovn_u16(high_a), vqmovn_u16(high_b)), vdupq_n_u8(0));
+        return vcombine_u8(
+            vmovn_u16(vcombine_u16(vmovn_u32(v[0]), vmovn_u32(v[1]))),
+            vmovn_u16(vcombine_u16(vmovn_u32(v[2]), vmovn_u32(v[3])))
+        );
+    }
+
+    static auto equal(const std::uint32_t* p, uint32x4_t c) noexcept -> uint8x16_t {
+        uint16x4_t v[4];
+        for (int i = 0; i < 4; ++i) v[i] = vmovn_u32(vceqq_u32(vld1q_u32(p + 4 * i), c));
+        return vcombine_u8(vmovn_u16(vcombine_u16(v[0], v[1])), vmovn_u16(vcombine_u16(v[2], v[3])));
+    }
+};
+
+template <typename Unit>
+struct neon_wide_kernel {
+    using unit_type = Unit;
+    using mask_type = std::uint64_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 2;
+    static constexpr mask_type all = ~mask_type(0);
+
+    neon_kernel bytes;
+
+    explicit neon_wide_kernel(const byte_set& s) noexcept : bytes(s) {}
+
+    [[nodiscard]] auto match(const Unit* p) const noexcept -> mask_type {
+        uint8x16_t fits;
+        const auto v = neon_lanes<Unit>::narrow(p, fits);
+        return neon_movemask(vandq_u8(bytes.hits(v), fits));
+    }
+};
+
+template <typename Unit>
+struct neon_eq_kernel {
+    using unit_type = Unit;
+    using mask_type = std::uint64_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 2;
+    static constexpr mask_type all = ~mask_type(0);
+
+    decltype(neon_lanes<Unit>::splat(0)) c;
+
+    explicit neon_eq_kernel(Unit u) noexcept : c(neon_lanes<Unit>::splat(u)) {}
+
+    [[nodiscard]] auto match(const Unit* p) const noexcept -> mask_type {
+        return neon_movemask(neon_lanes<Unit>::equal(p, c));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2
+#    define LIBSTREAM_SIMD_KERNEL 1
+using native_kernel = avx2_kernel;
+template <typename Unit> using native_wide_kernel = avx2_wide_kernel<Unit>;
+#elif LIBSTREAM_SIMD_SSSE3
+#    define LIBSTREAM_SIMD_KERNEL 1
+using native_kernel = ssse3_kernel;
+template <typename Unit> using native_wide_kernel = ssse3_wide_kernel<Unit>;
+#elif LIBSTREAM_SIMD_NEON
+#    define LIBSTREAM_SIMD_KERNEL 1
+using native_kernel = neon_kernel;
+template <typename Unit> using native_wide_kernel = neon_wide_kernel<Unit>;
+#endif
+
+#if LIBSTREAM_SIMD_AVX2
+#    define LIBSTREAM_SIMD_EQ_KERNEL 1
+template <typename Unit> using native_eq_kernel = avx2_eq_kernel<Unit>;
+#elif LIBSTREAM_SIMD_SSE2
+#    define LIBSTREAM_SIMD_EQ_KERNEL 1
+template <typename Unit> using native_eq_kernel = sse2_eq_kernel<Unit>;
+#elif LIBSTREAM_SIMD_NEON
+#    define LIBSTREAM_SIMD_EQ_KERNEL 1
+template <typename Unit> using native_eq_kernel = neon_eq_kernel<Unit>;
+#endif
+
+#if LIBSTREAM_SIMD_KERNEL
+// The byte set kernel for code units of type `CharType`.
+template <typename CharType>
+using kernel_for = std::conditional_t<
+    sizeof(CharType) == 1,
+    native_kernel,
+    native_wide_kernel<lane_type<CharType>>
+>;
+#endif
+
+// ============================================================================
+//  Substring search kernels.
+//
+//  These compare a block of bytes against the first byte of a needle and the
+//  block `offset` bytes further along against its last byte; only positions
+//  where both match need to be verified. This only needs equality tests, so
+//  unlike the byte set kernels, it works with plain SSE2.
+// ============================================================================
+#if LIBSTREAM_SIMD_SSE2
+struct sse2_pair_kernel {
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 0;
+
+    __m128i first, last;
+
+    sse2_pair_kernel(std::uint8_t f, std::uint8_t l) noexcept
+        : first(_mm_set1_epi8(char(f))), last(_mm_set1_epi8(char(l))) {}
+
+    [[nodiscard]] auto match(const std::uint8_t* p, std::size_t offset) const noexcept -> mask_type {
+        const auto a = _mm_cmpeq_epi8(first, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        const auto b = _mm_cmpeq_epi8(last, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + offset)));
+        return mask_type(_mm_movemask_epi8(_mm_and_si128(a, b)));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2 or LIBSTREAM_SIMD_DISPATCH
+struct avx2_pair_kernel {
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 32;
+    static constexpr std::size_t shift = 0;
+
+    __m256i first, last;
+
+    LIBSTREAM_TARGET_AVX2 avx2_pair_kernel(std::uint8_t f, std::uint8_t l) noexcept
+        : first(_mm256_set1_epi8(char(f))), last(_mm256_set1_epi8(char(l))) {}
+
+    LIBSTREAM_TARGET_AVX2 [[nodiscard]] auto match(const std::uint8_t* p, std::size_t offset) const noexcept -> mask_type {
+        const auto a = _mm256_cmpeq_epi8(first, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        const auto b = _mm256_cmpeq_epi8(last, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + offset)));
+        return mask_type(_mm256_movemask_epi8(_mm256_and_si256(a, b)));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_NEON
+struct neon_pair_kernel {
+    using mask_type = std::uint64_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 2;
+
+    uint8x16_t first, last;
+
+    neon_pair_kernel(std::uint8_t f, std::uint8_t l) noexcept
+        : first(vdupq_n_u8(f)), last(vdupq_n_u8(l)) {}
+
+    [[nodiscard]] auto match(const std::uint8_t* p, std::size_t offset) const noexcept -> mask_type {
+        return neon_movemask(vandq_u8(vceqq_u8(first, vld1q_u8(p)), vceqq_u8(last, vld1q_u8(p + offset))));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2
+#    define LIBSTREAM_SIMD_PAIR_KERNEL 1
+using native_pair_kernel = avx2_pair_kernel;
+#elif LIBSTREAM_SIMD_SSE2
+#    define LIBSTREAM_SIMD_PAIR_KERNEL 1
+using native_pair_kernel = sse2_pair_kernel;
+#elif LIBSTREAM_SIMD_NEON
+#    define LIBSTREAM_SIMD_PAIR_KERNEL 1
+using native_pair_kernel = neon_pair_kernel;
+#endif
+
+#if LIBSTREAM_SIMD_PAIR_KERNEL
+/// Find the first occurrence of a needle of at least 2 bytes.
+///
+/// This is O(n * m) in the worst case, so it should only be used for
+/// short needles.
+template <typename Kernel>
+[[nodiscard]] auto find_substr_vec(
+    const std::uint8_t* p,
+    std::size_t n,
+    const std::uint8_t* needle,
+    std::size_t m
+) noexcept -> std::size_t {
+    constexpr auto group = (typename Kernel::mask_type(1) << (1 << Kernel::shift)) - 1;
+    if (n < m) return npos;
+    const Kernel k{needle[0], needle[m - 1]};
+
+    auto verify = [&](std::size_t i, typename Kernel::mask_type mask) {
+        while (mask) {
+            auto bit = std::size_t(std::countr_zero(mask)) >> Kernel::shift;
+            if (std::memcmp(p + i + bit + 1, needle + 1, m - 2) == 0) return i + bit;
+            mask &= ~(group << (bit << Kernel::shift));
+        }
+        return npos;
+    };
+
+    // Too short for even a single block.
+    const auto positions = n - m + 1;
+    if (positions < Kernel::width) {
+        for (std::size_t i = 0; i < positions; ++i)
+            if (p[i] == needle[0] and std::memcmp(p + i + 1, needle + 1, m - 1) == 0)
+                return i;
+        return npos;
+    }
+
+    std::size_t i = 0;
+    for (; i + Kernel::width <= positions; i += Kernel::width)
+        if (auto pos = verify(i, k.match(p + i, m - 1)); pos != npos) return pos;
+
+    // Rescan the last block, ignoring the positions we have already checked.
+    if (i != positions) {
+        auto j = positions - Kernel::width;
+        auto seen = (typename Kernel::mask_type(1) << ((i - j) << Kernel::shift)) - 1;
+        return verify(j, k.match(p + j, m - 1) & ~seen);
+    }
+
+    return npos;
+}
+#endif
+
+// ============================================================================
+//  Multi-needle search kernels.
+//
+//  This is the Teddy algorithm from Hyperscan. Needles are sorted into up to
+//  8 buckets; for each of the first `length` bytes of a needle, the bit for
+//  its bucket is set in one table indexed by the low nibble of that byte and
+//  another indexed by its high nibble. Looking up every byte of a block in
+//  both tables and ANDing the results for `length` consecutive bytes leaves
+//  a bucket bit set only at positions where some needle in that bucket may
+//  start; these candidates are then verified by the caller.
+// ============================================================================
+struct teddy_masks {
+    static constexpr std::size_t max_length = 3;
+    static constexpr std::size_t max_buckets = 8;
+
+    alignas(16) std::uint8_t lo[max_length][16]{};
+    alignas(16) std::uint8_t hi[max_length][16]{};
+    std::size_t length = 0;
+
+    // Add the first `length` bytes at `p` to a bucket.
+    constexpr void insert(std::size_t bucket, const std::uint8_t* p) noexcept {
+        for (std::size_t j = 0; j < length; ++j) {
+            lo[j][p[j] & 15] |= std::uint8_t(1u << bucket);
+            hi[j][p[j] >> 4] |= std::uint8_t(1u << bucket);
+        }
+    }
+
+    // The buckets that may have a needle starting at `p`; this is what
+    // the kernels compute for every position of a block.
+    [[nodiscard]] constexpr auto buckets(const std::uint8_t* p) const noexcept -> std::uint8_t {
+        std::uint8_t b = 0xFF;
+        for (std::size_t j = 0; j < length; ++j) b &= lo[j][p[j] & 15] & hi[j][p[j] >> 4];
+        return b;
+    }
+};
+
+#if LIBSTREAM_SIMD_SSSE3 or LIBSTREAM_SIMD_DISPATCH
+struct ssse3_teddy_kernel {
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 0;
+
+    __m128i lo[teddy_masks::max_length], hi[teddy_masks::max_length];
+    std::size_t length;
+
+    LIBSTREAM_TARGET_SSSE3 explicit ssse3_teddy_kernel(const teddy_masks& t) noexcept : length(t.length) {
+        for (std::size_t j = 0; j < length; ++j) {
+            lo[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(t.lo[j]));
+            hi[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(t.hi[j]));
+        }
+    }
+
+    LIBSTREAM_TARGET_SSSE3 [[nodiscard]] auto match(const std::uint8_t* p) const noexcept -> mask_type {
+        const auto nibble = _mm_set1_epi8(0x0F);
+        auto m = _mm_set1_epi8(char(0xFF));
+        for (std::size_t j = 0; j < length; ++j) {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + j));
+            m = _mm_and_si128(m, _mm_and_si128(
+                _mm_shuffle_epi8(lo[j], _mm_and_si128(v, nibble)),
+                _mm_shuffle_epi8(hi[j], _mm_and_si128(_mm_srli_epi16(v, 4), nibble))
+            ));
+        }
+
+        return ~mask_type(_mm_movemask_epi8(_mm_cmpeq_epi8(m, _mm_setzero_si128()))) & 0xFFFF;
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2 or LIBSTREAM_SIMD_DISPATCH
+struct avx2_teddy_kernel {
+    using mask_type = std::uint32_t;
+    static constexpr std::size_t width = 32;
+    static constexpr std::size_t shift = 0;
+
+    __m256i lo[teddy_masks::max_length], hi[teddy_masks::max_length];
+    std::size_t length;
+
+    LIBSTREAM_TARGET_AVX2 explicit avx2_teddy_kernel(const teddy_masks& t) noexcept : length(t.length) {
+        for (std::size_t j = 0; j < length; ++j) {
+            lo[j] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.lo[j])));
+            hi[j] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.hi[j])));
+        }
+    }
+
+    LIBSTREAM_TARGET_AVX2 [[nodiscard]] auto match(const std::uint8_t* p) const noexcept -> mask_type {
+        const auto nibble = _mm256_set1_epi8(0x0F);
+        auto m = _mm256_set1_epi8(char(0xFF));
+        for (std::size_t j = 0; j < length; ++j) {
+            const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + j));
+            m = _mm256_and_si256(m, _mm256_and_si256(
+                _mm256_shuffle_epi8(lo[j], _mm256_and_si256(v, nibble)),
+                _mm256_shuffle_epi8(hi[j], _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble))
+            ));
+        }
+
+        return ~mask_type(_mm256_movemask_epi8(_mm256_cmpeq_epi8(m, _mm256_setzero_si256())));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_NEON
+struct neon_teddy_kernel {
+    using mask_type = std::uint64_t;
+    static constexpr std::size_t width = 16;
+    static constexpr std::size_t shift = 2;
+
+    uint8x16_t lo[teddy_masks::max_length], hi[teddy_masks::max_length];
+    std::size_t length;
+
+    explicit neon_teddy_kernel(const teddy_masks& t) noexcept : length(t.length) {
+        for (std::size_t j = 0; j < length; ++j) {
+            lo[j] = vld1q_u8(t.lo[j]);
+            hi[j] = vld1q_u8(t.hi[j]);
+        }
+    }
+
+    [[nodiscard]] auto match(const std::uint8_t* p) const noexcept -> mask_type {
+        auto m = vdupq_n_u8(0xFF);
+        for (std::size_t j = 0; j < length; ++j) {
+            const auto v = vld1q_u8(p + j);
+            m = vandq_u8(m, vandq_u8(vqtbl1q_u8(lo[j], vandq_u8(v, vdupq_n_u8(0x0F))), vqtbl1q_u8(hi[j], vshrq_n_u8(v, 4))));
+        }
+
+        return neon_movemask(vtstq_u8(m, m));
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2
+#    define LIBSTREAM_SIMD_TEDDY 1
+using native_teddy_kernel = avx2_teddy_kernel;
+#elif LIBSTREAM_SIMD_SSSE3
+#    define LIBSTREAM_SIMD_TEDDY 1
+using native_teddy_kernel = ssse3_teddy_kernel;
+#elif LIBSTREAM_SIMD_NEON
+#    define LIBSTREAM_SIMD_TEDDY 1
+using native_teddy_kernel = neon_teddy_kernel;
+#endif
+
+#if LIBSTREAM_SIMD_TEDDY or LIBSTREAM_SIMD_DISPATCH
+/// Find the first position at which the next `t.length` bytes match
+/// the fingerprint of any bucket.
+template <typename Kernel>
+[[nodiscard]] auto find_teddy_vec(const std::uint8_t* p, std::size_t n, const teddy_masks& t) noexcept -> std::size_t {
+    if (n < t.length) return npos;
+    const auto positions = n - t.length + 1;
+    if (positions < Kernel::width) {
+        for (std::size_t i = 0; i < positions; ++i)
+            if (t.buckets(p + i)) return i;
+        return npos;
+    }
+
+    const Kernel k{t};
+    auto first = [](typename Kernel::mask_type m) { return std::size_t(std::countr_zero(m)) >> Kernel::shift; };
+    std::size_t i = 0;
+    for (; i + Kernel::width <= positions; i += Kernel::width)
+        if (auto m = k.match(p + i)) return i + first(m);
+
+    // Rescan the last block, ignoring the positions we have already checked.
+    if (i != positions) {
+        auto j = positions - Kernel::width;
+        auto seen = (typename Kernel::mask_type(1) << ((i - j) << Kernel::shift)) - 1;
+        if (auto m = k.match(p + j) & ~seen) return j + first(m);
+    }
+
+    return npos;
+}
+#endif
+
+#if LIBSTREAM_SIMD_KERNEL or LIBSTREAM_SIMD_EQ_KERNEL
+// Find the last code unit matched by `match(i)`, which classifies the
+// block at `i`. This requires `n >= Kernel::width`.
+template <typename Kernel, typename Match>
+[[nodiscard]] auto find_last_match_vec(std::size_t n, Match match) noexcept -> std::size_t {
+    constexpr auto bits = std::size_t(std::numeric_limits<typename Kernel::mask_type>::digits);
+
+    // Masks for narrower kernels are zero-extended, so count from the
+    // top of the block rather than the top of the mask.
+    constexpr auto top = (bits >> Kernel::shift) - Kernel::width;
+    auto last = [&](auto m) { return Kernel::width - 1 - ((std::size_t(std::countl_zero(m)) >> Kernel::shift) - top); };
+
+    std::size_t i = n;
+    for (; i >= Kernel::width; i -= Kernel::width)
+        if (auto m = match(i - Kernel::width)) return i - Kernel::width + last(m);
+
+    // Rescan the first block; the overlapping part is known not to match.
+    if (i != 0)
+        if (auto m = match(0)) return last(m);
+
+    return npos;
+}
+#endif
+
+#if LIBSTREAM_SIMD_KERNEL or LIBSTREAM_SIMD_DISPATCH
+template <typename Kernel, bool _negate>
+[[nodiscard]] auto find_first_vec(const typename Kernel::unit_type* p, std::size_t n, const byte_set& s) noexcept -> std::size_t {
+    const Kernel k{s};
+    auto scan = [&](std::size_t i) {
+        auto m = k.match(p + i);
+        if constexpr (_negate) m ^= Kernel::all;
+        return m;
+    };
+
+    std::size_t i = 0;
+    for (; i + Kernel::width <= n; i += Kernel::width)
+        if (auto m = scan(i)) return i + (std::size_t(std::countr_zero(m)) >> Kernel::shift);
+
+    // Rescan the last block; the overlapping part is known not to match.
+    if (i != n) {
+        i = n - Kernel::width;
+        if (auto m = scan(i)) return i + (std::size_t(std::countr_zero(m)) >> Kernel::shift);
+    }
+
+    return npos;
+}
+
+template <typename Kernel, bool _negate>
+[[nodiscard]] auto find_last_vec(const typename Kernel::unit_type* p, std::size_t n, const byte_set& s) noexcept -> std::size_t {
+    const Kernel k{s};
+    return find_last_match_vec<Kernel>(n, [&](std::size_t i) {
+        auto m = k.match(p + i) & Kernel::all;
+        if constexpr (_negate) m ^= Kernel::all;
+        return m;
+    });
+}
+
+/// Classify `64 * words` code units, setting bit `i % 64` of `out[i / 64]`
+/// iff `p[i]` is in `s`.
+template <typename Kernel>
+void classify_vec(const typename Kernel::unit_type* p, std::size_t words, const byte_set& s, std::uint64_t* out) noexcept {
+    static_assert(64 % Kernel::width == 0);
+    const Kernel k{s};
+    for (std::size_t w = 0; w < words; ++w, p += 64) {
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0; j < 64; j += Kernel::width) {
+            std::uint64_t m = k.match(p + j) & Kernel::all;
+
+            // Keep one bit out of each group of 4 for NEON.
+            if constexpr (Kernel::shift == 2) {
+                m &= 0x1111'1111'1111'1111;
+                m = (m | m >> 3) & 0x0303'0303'0303'0303;
+                m = (m | m >> 6) & 0x000F'000F'000F'000F;
+                m = (m | m >> 12) & 0x0000'00FF'0000'00FF;
+                m = (m | m >> 24) & 0xFFFF;
+            }
+
+            bits |= m << j;
+        }
+
+        out[w] = bits;
+    }
+}
+#endif
+
+#if LIBSTREAM_SIMD_KERNEL or LIBSTREAM_SIMD_EQ_KERNEL
+// Call `cb(i)` for the index of every byte matched by `match(i)`, which
+// classifies the block at `i`, in order, until it returns false. This
+// requires `n >= Kernel::width`.
+template <typename Kernel, typename Match, typename Callback>
+void for_each_match_vec(std::size_t n, Match match, Callback& cb) {
+    constexpr auto group = (typename Kernel::mask_type(1) << (1 << Kernel::shift)) - 1;
+    auto report = [&](std::size_t i, typename Kernel::mask_type mask) {
+        while (mask) {
+            auto bit = std::size_t(std::countr_zero(mask)) >> Kernel::shift;
+            if (not cb(i + bit)) return false;
+            mask &= ~(group << (bit << Kernel::shift));
+        }
+        return true;
+    };
+
+    std::size_t i = 0;
+    for (; i + Kernel::width <= n; i += Kernel::width)
+        if (not report(i, match(i))) return;
+
+    // Rescan the last block, ignoring the bytes we have already reported.
+    if (i != n) {
+        auto j = n - Kernel::width;
+        auto seen = (typename Kernel::mask_type(1) << ((i - j) << Kernel::shift)) - 1;
+        report(j, match(j) & ~seen);
+    }
+}
+#endif
+
+#if LIBSTREAM_SIMD_EQ_KERNEL
+// Find the first or last occurrence of `c`. This requires `n >= Kernel::width`.
+template <typename Kernel>
+[[nodiscard]] auto find_char_vec(const typename Kernel::unit_type* p, std::size_t n, typename Kernel::unit_type c) noexcept -> std::size_t {
+    const Kernel k{c};
+    auto pos = npos;
+    auto found = [&](std::size_t i) {
+        pos = i;
+        return false;
+    };
+
+    for_each_match_vec<Kernel>(n, [&](std::size_t i) { return k.match(p + i); }, found);
+    return pos;
+}
+
+template <typename Kernel>
+[[nodiscard]] auto rfind_char_vec(const typename Kernel::unit_type* p, std::size_t n, typename Kernel::unit_type c) noexcept -> std::size_t {
+    const Kernel k{c};
+    return find_last_match_vec<Kernel>(n, [&](std::size_t i) { return k.match(p + i); });
+}
+#endif
+
+// ============================================================================
+//  UTF-8 validation.
+//
+//  This is the lookup algorithm from Keiser & Lemire, "Validating UTF-8 In
+//  Less Than One Instruction Per Byte" (2021). Almost every error can be
+//  detected by looking at a pair of adjacent bytes: three table lookups,
+//  indexed by the high and low nibble of the first byte and the high nibble
+//  of the second, each yield a set of the errors that the pair might be an
+//  instance of, and the pair is an error iff all three agree on one. The
+//  only exception is a continuation byte following another one, which is
+//  only valid in the third and fourth byte of a sequence; this is checked
+//  by looking three bytes back.
+//
+//  The ops structs below provide the few vector operations this needs.
+// ============================================================================
+namespace utf8 {
+inline constexpr std::uint8_t too_short = 1 << 0;      // 11______ 0_______, 11______ 11______
+inline constexpr std::uint8_t too_long = 1 << 1;       // 0_______ 10______
+inline constexpr std::uint8_t overlong_3 = 1 << 2;     // 11100000 100_____
+inline constexpr std::uint8_t too_large = 1 << 3;      // 11110100 1001____, 11110101+ 10______
+inline constexpr std::uint8_t surrogate = 1 << 4;      // 11101101 101_____
+inline constexpr std::uint8_t overlong_2 = 1 << 5;     // 1100000_ 10______
+inline constexpr std::uint8_t too_large_1000 = 1 << 6; // 11110101+ 1000____
+inline constexpr std::uint8_t overlong_4 = 1 << 6;     // 11110000 1000____
+inline constexpr std::uint8_t two_conts = 1 << 7;      // 10______ 10______
+inline constexpr std::uint8_t carry = too_short | too_long | two_conts;
+
+alignas(16) inline constexpr std::uint8_t byte_1_high[16]{
+    too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+    two_conts, two_conts, two_conts, two_conts,
+    too_short | overlong_2,
+    too_short,
+    too_short | overlong_3 | surrogate,
+    too_short | too_large | too_large_1000 | overlong_4,
+};
+
+alignas(16) inline constexpr std::uint8_t byte_1_low[16]{
+    carry | overlong_3 | overlong_2 | overlong_4,
+    carry | overlong_2,
+    carry,
+    carry,
+    carry | too_large,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000 | surrogate,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+};
+
+alignas(16) inline constexpr std::uint8_t byte_2_high[16]{
+    too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+    too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+    too_long | overlong_2 | two_conts | overlong_3 | too_large,
+    too_long | overlong_2 | two_conts | surrogate | too_large,
+    too_long | overlong_2 | two_conts | surrogate | too_large,
+    too_short, too_short, too_short, too_short,
+};
+} // namespace utf8
+
+#if LIBSTREAM_SIMD_SSSE3 or LIBSTREAM_SIMD_DISPATCH
+struct ssse3_utf8_ops {
+    using vec = __m128i;
+    static constexpr std::size_t width = 16;
+
+    LIBSTREAM_TARGET_SSSE3 static auto load(const std::uint8_t* p) noexcept -> vec { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    LIBSTREAM_TARGET_SSSE3 static auto table(const std::uint8_t* t) noexcept -> vec { return _mm_load_si128(reinterpret_cast<const __m128i*>(t)); }
+    LIBSTREAM_TARGET_SSSE3 static auto splat(std::uint8_t b) noexcept -> vec { return _mm_set1_epi8(char(b)); }
+    LIBSTREAM_TARGET_SSSE3 static auto zero() noexcept -> vec { return _mm_setzero_si128(); }
+    LIBSTREAM_TARGET_SSSE3 static auto lookup(vec t, vec idx) noexcept -> vec { return _mm_shuffle_epi8(t, idx); }
+    LIBSTREAM_TARGET_SSSE3 static auto high_nibbles(vec v) noexcept -> vec { return _mm_and_si128(_mm_srli_epi16(v, 4), splat(0x0F)); }
+    LIBSTREAM_TARGET_SSSE3 static auto low_nibbles(vec v) noexcept -> vec { return _mm_and_si128(v, splat(0x0F)); }
+    LIBSTREAM_TARGET_SSSE3 static auto subs(vec a, vec b) noexcept -> vec { return _mm_subs_epu8(a, b); }
+    LIBSTREAM_TARGET_SSSE3 static auto and_(vec a, vec b) noexcept -> vec { return _mm_and_si128(a, b); }
+    LIBSTREAM_TARGET_SSSE3 static auto or_(vec a, vec b) noexcept -> vec { return _mm_or_si128(a, b); }
+    LIBSTREAM_TARGET_SSSE3 static auto xor_(vec a, vec b) noexcept -> vec { return _mm_xor_si128(a, b); }
+    LIBSTREAM_TARGET_SSSE3 static auto is_ascii(vec v) noexcept -> bool { return _mm_movemask_epi8(v) == 0; }
+    LIBSTREAM_TARGET_SSSE3 static auto any(vec v) noexcept -> bool { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero())) != 0xFFFF; }
+
+    // The last N bytes of `prev` followed by all but the last N bytes of `cur`.
+    template <int N>
+    LIBSTREAM_TARGET_SSSE3 static auto prev(vec cur, vec prev) noexcept -> vec { return _mm_alignr_epi8(cur, prev, 16 - N); }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2 or LIBSTREAM_SIMD_DISPATCH
+struct avx2_utf8_ops {
+    using vec = __m256i;
+    static constexpr std::size_t width = 32;
+
+    LIBSTREAM_TARGET_AVX2 static auto load(const std::uint8_t* p) noexcept -> vec { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    LIBSTREAM_TARGET_AVX2 static auto table(const std::uint8_t* t) noexcept -> vec { return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t))); }
+    LIBSTREAM_TARGET_AVX2 static auto splat(std::uint8_t b) noexcept -> vec { return _mm256_set1_epi8(char(b)); }
+    LIBSTREAM_TARGET_AVX2 static auto zero() noexcept -> vec { return _mm256_setzero_si256(); }
+    LIBSTREAM_TARGET_AVX2 static auto lookup(vec t, vec idx) noexcept -> vec { return _mm256_shuffle_epi8(t, idx); }
+    LIBSTREAM_TARGET_AVX2 static auto high_nibbles(vec v) noexcept -> vec { return _mm256_and_si256(_mm256_srli_epi16(v, 4), splat(0x0F)); }
+    LIBSTREAM_TARGET_AVX2 static auto low_nibbles(vec v) noexcept -> vec { return _mm256_and_si256(v, splat(0x0F)); }
+    LIBSTREAM_TARGET_AVX2 static auto subs(vec a, vec b) noexcept -> vec { return _mm256_subs_epu8(a, b); }
+    LIBSTREAM_TARGET_AVX2 static auto and_(vec a, vec b) noexcept -> vec { return _mm256_and_si256(a, b); }
+    LIBSTREAM_TARGET_AVX2 static auto or_(vec a, vec b) noexcept -> vec { return _mm256_or_si256(a, b); }
+    LIBSTREAM_TARGET_AVX2 static auto xor_(vec a, vec b) noexcept -> vec { return _mm256_xor_si256(a, b); }
+    LIBSTREAM_TARGET_AVX2 static auto is_ascii(vec v) noexcept -> bool { return _mm256_movemask_epi8(v) == 0; }
+    LIBSTREAM_TARGET_AVX2 static auto any(vec v) noexcept -> bool { return not _mm256_testz_si256(v, v); }
+
+    // Shuffles only work within 128-bit lanes, so first build a vector whose
+    // low lane is the high lane of `prev` and whose high lane is the low lane
+    // of `cur`.
+    template <int N>
+    LIBSTREAM_TARGET_AVX2 static auto prev(vec cur, vec prev) noexcept -> vec {
+        return _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(prev, cur, 0x21), 16 - N);
+    }
+};
+#endif
+
+#if LIBSTREAM_SIMD_NEON
+struct neon_utf8_ops {
+    using vec = uint8x16_t;
+    static constexpr std::size_t width = 16;
+
+    static auto load(const std::uint8_t* p) noexcept -> vec { return vld1q_u8(p); }
+    static auto table(const std::uint8_t* t) noexcept -> vec { return vld1q_u8(t); }
+    static auto splat(std::uint8_t b) noexcept -> vec { return vdupq_n_u8(b); }
+    static auto zero() noexcept -> vec { return vdupq_n_u8(0); }
+    static auto lookup(vec t, vec idx) noexcept -> vec { return vqtbl1q_u8(t, idx); }
+    static auto high_nibbles(vec v) noexcept -> vec { return vshrq_n_u8(v, 4); }
+    static auto low_nibbles(vec v) noexcept -> vec { return vandq_u8(v, splat(0x0F)); }
+    static auto subs(vec a, vec b) noexcept -> vec { return vqsubq_u8(a, b); }
+    static auto and_(vec a, vec b) noexcept -> vec { return vandq_u8(a, b); }
+    static auto or_(vec a, vec b) noexcept -> vec { return vorrq_u8(a, b); }
+    static auto xor_(vec a, vec b) noexcept -> vec { return veorq_u8(a, b); }
+    static auto is_ascii(vec v) noexcept -> bool { return vmaxvq_u8(v) < 0x80; }
+    static auto any(vec v) noexcept -> bool { return vmaxvq_u8(v) != 0; }
+
+    template <int N>
+    static auto prev(vec cur, vec prev) noexcept -> vec { return vextq_u8(prev, cur, 16 - N); }
+};
+#endif
+
+#if LIBSTREAM_SIMD_AVX2
+#    define LIBSTREAM_SIMD_UTF8 1
+using native_utf8_ops = avx2_utf8_ops;
+#elif LIBSTREAM_SIMD_SSSE3
+#    define LIBSTREAM_SIMD_UTF8 1
+using native_utf8_ops = ssse3_utf8_ops;
+#elif LIBSTREAM_SIMD_NEON
+#    define LIBSTREAM_SIMD_UTF8 1
+using native_utf8_ops = neon_utf8_ops;
+#endif
+
+#if LIBSTREAM_SIMD_UTF8 or LIBSTREAM_SIMD_DISPATCH
+// Unlike the other loops, this passes vectors around by value, which
+// only works if it is inlined into a function with the same target.
+#    if LIBSTREAM_SIMD_DISPATCH
+#        pragma GCC diagnostic push
+#        pragma GCC diagnostic ignored "-Wpsabi"
+#    endif
+
+/// Check if a string is valid UTF-8.
+template <typename Ops>
+[[nodiscard]] LIBSTREAM_SIMD_ALWAYS_INLINE inline auto validate_utf8_vec(const std::uint8_t* p, std::size_t n) noexcept -> bool {
+    using vec = typename Ops::vec;
+    constexpr auto w = Ops::width;
+
+    // A block is incomplete if it ends in the middle of a sequence, i.e.
+    // if any of the last 3 bytes starts a sequence that is too long to fit.
+    alignas(32) static constexpr auto max_bytes = [] {
+        std::uint8_t b[w];
+        for (auto& x : b) x = 0xFF;
+        b[w - 3] = 0xF0 - 1;
+        b[w - 2] = 0xE0 - 1;
+        b[w - 1] = 0xC0 - 1;
+        return std::to_array(b);
+    }();
+
+    const auto byte_1_high = Ops::table(utf8::byte_1_high);
+    const auto byte_1_low = Ops::table(utf8::byte_1_low);
+    const auto byte_2_high = Ops::table(utf8::byte_2_high);
+    const auto max = Ops::load(max_bytes.data());
+
+    vec error = Ops::zero();
+    vec prev_input = Ops::zero();
+    vec prev_incomplete = Ops::zero();
+    auto check = [&](const vec& input) LIBSTREAM_SIMD_ALWAYS_INLINE {
+        if (Ops::is_ascii(input)) {
+            error = Ops::or_(error, prev_incomplete);
+            prev_incomplete = Ops::zero();
+        } else {
+            auto prev1 = Ops::template prev<1>(input, prev_input);
+            auto special = Ops::and_(
+                Ops::and_(
+                    Ops::lookup(byte_1_high, Ops::high_nibbles(prev1)),
+                    Ops::lookup(byte_1_low, Ops::low_nibbles(prev1))
+                ),
+                Ops::lookup(byte_2_high, Ops::high_nibbles(input))
+            );
+
+            // Only 111_____ is >= 0x80 after subtracting 0x60, and only
+            // 1111____ after subtracting 0x70.
+            auto third = Ops::subs(Ops::template prev<2>(input, prev_input), Ops::splat(0xE0 - 0x80));
+            auto fourth = Ops::subs(Ops::template prev<3>(input, prev_input), Ops::splat(0xF0 - 0x80));
+            auto must_be_cont = Ops::and_(Ops::or_(third, fourth), Ops::splat(0x80));
+            error = Ops::or_(error, Ops::xor_(must_be_cont, special));
+            prev_incomplete = Ops::subs(input, max);
+        }
+
+        prev_input = input;
+    };
+
+    std::size_t i = 0;
+    for (; i + w <= n; i += w) check(Ops::load(p + i));
+
+    // Pad the rest with zeros; this also catches a truncated sequence at
+    // the very end, since it would be followed by an ASCII byte.
+    std::uint8_t tail[w]{};
+    if (i != n) std::memcpy(tail, p + i, n - i);
+    check(Ops::load(tail));
+    return not Ops::any(error);
+}
+
+#    if LIBSTREAM_SIMD_DISPATCH
+#        pragma GCC diagnostic pop
+#    endif
+#endif
+
+// ============================================================================
+//  Runtime dispatch.
+//
+//  A binary built for baseline x86-64 only has the SSE2 kernels inlined into
+//  it. The SSSE3 and AVX2 kernels are still compiled, but only into entry
+//  points with the matching `target` attribute, which `flatten` the loops
+//  above into themselves; each instruction set has a table of these, and
+//  the best table that the CPU supports is picked the first time a search
+//  needs it. The environment variable `LIBSTREAM_FORCE_ISA` can be set to
+//  `scalar`, `sse2`, `ssse3`, or `avx2` to use a lower level instead, e.g.
+//  to compare them in benchmarks.
+//
+//  Null entries mean that there is no kernel at that level, in which case
+//  callers use their scalar loops. Searches over single-byte characters are
+//  still left to `memchr()`, which the C library already dispatches, and
+//  `find_each()` keeps using the inlined kernels where there are any, since
+//  its callback cannot be passed through a function pointer.
+//
+//  Define `LIBSTREAM_DISPATCH` to 0 to disable all of this. If the program
+//  links against the `libstream_dispatch` library, `LIBSTREAM_DISPATCH_LIBRARY`
+//  is defined, and the tables and entry points are only compiled there.
+// ============================================================================
+#if LIBSTREAM_SIMD_DISPATCH
+#    define LIBSTREAM_DISPATCH_TARGET(isa) [[gnu::target(isa), gnu::flatten]]
+#    if LIBSTREAM_DISPATCH_LIBRARY
+#        define LIBSTREAM_DISPATCH_LINKAGE
+#    else
+#        define LIBSTREAM_DISPATCH_LINKAGE inline
+#    endif
+
+enum struct isa : std::uint8_t {
+    scalar,
+    sse2,
+    ssse3,
+    avx2,
+};
+
+template <typename Unit>
+struct dispatch_ops {
+    std::size_t (*find_first[2])(const Unit*, std::size_t, const byte_set&) noexcept;
+    std::size_t (*find_last[2])(const Unit*, std::size_t, const byte_set&) noexcept;
+    std::size_t (*find_char)(const Unit*, std::size_t, Unit) noexcept;
+    std::size_t (*rfind_char)(const Unit*, std::size_t, Unit) noexcept;
+    void (*classify)(const Unit*, std::size_t, const byte_set&, std::uint64_t*) noexcept;
+};
+
+struct dispatch_table {
+    isa level;
+    const char* name;
+
+    // Texts shorter than this must not be passed to the byte set and
+    // equality entries, respectively.
+    std::size_t set_width;
+    std::size_t eq_width;
+
+    dispatch_ops<std::uint8_t> u8;
+    dispatch_ops<std::uint16_t> u16;
+    dispatch_ops<std::uint32_t> u32;
+    std::size_t (*find_substr)(const std::uint8_t*, std::size_t, const std::uint8_t*, std::size_t) noexcept;
+    std::size_t (*find_teddy)(const std::uint8_t*, std::size_t, const teddy_masks&) noexcept;
+    bool (*validate_utf8)(const std::uint8_t*, std::size_t) noexcept;
+
+    template <typename Unit>
+    [[nodiscard]] constexpr auto ops() const noexcept -> const dispatch_ops<Unit>& {
+        if constexpr (std::is_same_v<Unit, std::uint8_t>) return u8;
+        else if constexpr (std::is_same_v<Unit, std::uint16_t>) return u16;
+        else return u32;
+    }
+};
+
+/// The dispatch table that searches use; this is resolved on first use.
+[[nodiscard]] LIBSTREAM_DISPATCH_LINKAGE auto dispatch() noexcept -> const dispatch_table&;
+
+#    if not LIBSTREAM_DISPATCH_LIBRARY or defined(LIBSTREAM_DISPATCH_SOURCE)
+template <typename Unit, typename ByteKernel, template <typename> typename WideKernel>
+using set_kernel_for = std::conditional_t<std::is_same_v<Unit, std::uint8_t>, ByteKernel, WideKernel<Unit>>;
+
+template <typename Unit>
+struct sse2_entries {
+    static auto find_char(const Unit* p, std::size_t n, Unit c) noexcept -> std::size_t {
+        return find_char_vec<sse2_eq_kernel<Unit>>(p, n, c);
+    }
+
+    static auto rfind_char(const Unit* p, std::size_t n, Unit c) noexcept -> std::size_t {
+        return rfind_char_vec<sse2_eq_kernel<Unit>>(p, n, c);
+    }
+
+    static constexpr dispatch_ops<Unit> ops{{}, {}, &find_char, &rfind_char, nullptr};
+};
+
+template <typename Unit>
+struct ssse3_entries {
+    using set_kernel = set_kernel_for<Unit, ssse3_kernel, ssse3_wide_kernel>;
+
+    template <bool _negate>
+    LIBSTREAM_DISPATCH_TARGET("ssse3")
+    static auto find_first(const Unit* p, std::size_t n, const byte_set& s) noexcept -> std::size_t {
+        return find_first_vec<set_kernel, _negate>(p, n, s);
+    }
+
+    template <bool _negate>
+    LIBSTREAM_DISPATCH_TARGET("ssse3")
+    static auto find_last(const Unit* p, std::size_t n, const byte_set& s) noexcept -> std::size_t {
+        return find_last_vec<set_kernel, _negate>(p, n, s);
+    }
+
+    LIBSTREAM_DISPATCH_TARGET("ssse3")
+    static void classify(const Unit* p, std::size_t words, const byte_set& s, std::uint64_t* out) noexcept {
+        classify_vec<set_kernel>(p, words, s, out);
+    }
+
+    static constexpr dispatch_ops<Unit> ops{
+        {&find_first<false>, &find_first<true>},
+        {&find_last<false>, &find_last<true>},
+        &sse2_entries<Unit>::find_char,
+        &sse2_entries<Unit>::rfind_char,
+        &classify,
+    };
+};
+
+template <typename Unit>
+struct avx2_entries {
+    using set_kernel = set_kernel_for<Unit, avx2_kernel, avx2_wide_kernel>;
+
+    template <bool _negate>
+    LIBSTREAM_DISPATCH_TARGET("avx2")
+    static auto find_first(const Unit* p, std::size_t n, const byte_set& s) noexcept -> std::size_t {
+        return find_first_vec<set_kernel, _negate>(p, n, s);
+    }
+
+    template <bool _negate>
+    LIBSTREAM_DISPATCH_TARGET("avx2")
+    static auto find_last(const Unit* p, std::size_t n, const byte_set& s) noexcept -> std::size_t {
+        return find_last_vec<set_kernel, _negate>(p, n, s);
+    }
+
+    LIBSTREAM_DISPATCH_TARGET("avx2")
+    static void classify(const Unit* p, std::size_t words, const byte_set& s, std::uint64_t* out) noexcept {
+        classify_vec<set_kernel>(p, words, s, out);
+    }
+
+    LIBSTREAM_DISPATCH_TARGET("avx2")
+    static auto find_char(const Unit* p, std::size_t n, Unit c) noexcept -> std::size_t {
+        return find_char_vec<avx2_eq_kernel<Unit>>(p, n, c);
+    }
+
+    LIBSTREAM_DISPATCH_TARGET("avx2")
+    static auto rfind_char(const Unit* p, std::size_t n, Unit c) noexcept -> std::size_t {
+        return rfind_char_vec<avx2_eq_kernel<Unit>>(p, n, c);
+    }
+
+    static constexpr dispatch_ops<Unit> ops{
+        {&find_first<false>, &find_first<true>},
+        {&find_last<false>, &find_last<true>},
+        &find_char,
+        &rfind_char,
+        &classify,
+    };
+};
+
+LIBSTREAM_DISPATCH_TARGET("ssse3")
+inline auto ssse3_validate_utf8(const std::uint8_t* p, std::size_t n) noexcept -> bool {
+    return validate_utf8_vec<ssse3_utf8_ops>(p, n);
+}
+
+LIBSTREAM_DISPATCH_TARGET("avx2")
+inline auto avx2_validate_utf8(const std::uint8_t* p, std::size_t n) noexcept -> bool {
+    return validate_utf8_vec<avx2_utf8_ops>(p, n);
+}
+
+LIBSTREAM_DISPATCH_TARGET("avx2")
+inline auto avx2_find_substr(const std::uint8_t* p, std::size_t n, const std::uint8_t* needle, std::size_t m) noexcept -> std::size_t {
+    return find_substr_vec<avx2_pair_kernel>(p, n, needle, m);
+}
+
+inline auto sse2_find_substr(const std::uint8_t* p, std::size_t n, const std::uint8_t* needle, std::size_t m) noexcept -> std::size_t {
+    return find_substr_vec<sse2_pair_kernel>(p, n, needle, m);
+}
+
+LIBSTREAM_DISPATCH_TARGET("ssse3")
+inline auto ssse3_find_teddy(const std::uint8_t* p, std::size_t n, const teddy_masks& t) noexcept -> std::size_t {
+    return find_teddy_vec<ssse3_teddy_kernel>(p, n, t);
+}
+
+LIBSTREAM_DISPATCH_TARGET("avx2")
+inline auto avx2_find_teddy(const std::uint8_t* p, std::size_t n, const teddy_masks& t) noexcept -> std::size_t {
+    return find_teddy_vec<avx2_teddy_kernel>(p, n, t);
+}
+
+inline constexpr dispatch_table dispatch_tables[]{
+    {isa::scalar, "scalar", 16, 16, {}, {}, {}, nullptr, nullptr, nullptr},
+    {
+        isa::sse2,
+        "sse2",
+        16,
+        16,
+        sse2_entries<std::uint8_t>::ops,
+        sse2_entries<std::uint16_t>::ops,
+        sse2_entries<std::uint32_t>::ops,
+        &sse2_find_substr,
+        nullptr,
+        nullptr,
+    },
+    {
+        isa::ssse3,
+        "ssse3",
+        16,
+        16,
+        ssse3_entries<std::uint8_t>::ops,
+        ssse3_entries<std::uint16_t>::ops,
+        ssse3_entries<std::uint32_t>::ops,
+        &sse2_find_substr,
+        &ssse3_find_teddy,
+        &ssse3_validate_utf8,
+    },
+    {
+        isa::avx2,
+        "avx2",
+        32,
+        32,
+        avx2_entries<std::uint8_t>::ops,
+        avx2_entries<std::uint16_t>::ops,
+        avx2_entries<std::uint32_t>::ops,
+        &avx2_find_substr,
+        &avx2_find_teddy,
+        &avx2_validate_utf8,
+    },
+};
+
+[[nodiscard]] inline auto resolve_dispatch() noexcept -> const dispatch_table& {
+    __builtin_cpu_init();
+    auto best = isa::sse2;
+    if (__builtin_cpu_supports("ssse3")) best = isa::ssse3;
+    if (__builtin_cpu_supports("avx2")) best = isa::avx2;
+
+    // Never go above what the CPU supports, even if asked to.
+    if (auto forced = std::getenv("LIBSTREAM_FORCE_ISA")) {
+        for (auto& t : dispatch_tables) {
+            if (std::string_view{forced} == t.name) {
+                if (t.level < best) best = t.level;
+                break;
+            }
+        }
+    }
+
+    return dispatch_tables[std::size_t(best)];
+}
+
+LIBSTREAM_DISPATCH_LINKAGE auto dispatch() noexcept -> const dispatch_table& {
+    static const dispatch_table& table = resolve_dispatch();
+    return table;
+}
+#    endif
+#endif
+
+/// \return The number of leading ASCII bytes in a string.
+[[nodiscard]] inline auto ascii_prefix(const std::uint8_t* p, std::size_t n) noexcept -> std::size_t {
+    std::size_t i = 0;
+#if LIBSTREAM_SIMD_SSE2
+    for (; i + 16 <= n; i += 16)
+        if (auto m = unsigned(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)))))
+            return i + std::size_t(std::countr_zero(m));
+#elif LIBSTREAM_SIMD_NEON
+    for (; i + 16 <= n and vmaxvq_u8(vld1q_u8(p + i)) < 0x80; i += 16);
+#endif
+
+    if constexpr (std::endian::native == std::endian::little) {
+        for (; i + 8 <= n; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            if (auto m = word & 0x8080'8080'8080'8080) return i + (std::size_t(std::countr_zero(m)) >> 3);
+        }
+    }
+
+    while (i < n and p[i] < 0x80) ++i;
+    return i;
+}
+
+#if LIBSTREAM_SIMD_DISPATCH
+/// The widest block of code units that a byte set kernel looks at.
+template <typename CharType>
+inline constexpr std::size_t set_kernel_width = 32;
+#elif LIBSTREAM_SIMD_KERNEL
+template <typename CharType>
+inline constexpr std::size_t set_kernel_width = kernel_for<CharType>::width;
+#endif
+
+/// \brief Find the first character that is (or, if \p _negate is set, is
+/// not) in a byte set.
+///
+/// Characters wider than a byte are never considered to be in the set.
+///
+/// \return The index of the character, or \c npos if there is none.
+template <bool _negate, typename CharType>
+[[nodiscard]] constexpr auto find_first(std::basic_string_view<CharType> text, const byte_set& s) noexcept -> std::size_t {
+#if LIBSTREAM_SIMD_DISPATCH
+    if not consteval {
+        auto& t = dispatch();
+        if (auto f = t.ops<lane_type<CharType>>().find_first[_negate]; f and text.size() >= t.set_width)
+            return f(reinterpret_cast<const lane_type<CharType>*>(text.data()), text.size(), s);
+    }
+#elif LIBSTREAM_SIMD_KERNEL
+    if not consteval {
+        using kernel = kernel_for<CharType>;
+        if (text.size() >= kernel::width) return find_first_vec<kernel, _negate>(
+            reinterpret_cast<const lane_type<CharType>*>(text.data()),
+            text.size(),
+            s
+        );
+    }
+#endif
+
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        auto c = std::make_unsigned_t<CharType>(text[i]);
+        if ((c < 256 and s.contains(std::uint8_t(c))) != _negate) return i;
+    }
+
+    return npos;
+}
+
+/// \brief Find the last character that is (or is not) in a byte set.
+///
+/// \see find_first()
+template <bool _negate, typename CharType>
+[[nodiscard]] constexpr auto find_last(std::basic_string_view<CharType> text, const byte_set& s) noexcept -> std::size_t {
+#if LIBSTREAM_SIMD_DISPATCH
+    if not consteval {
+        auto& t = dispatch();
+        if (auto f = t.ops<lane_type<CharType>>().find_last[_negate]; f and text.size() >= t.set_width)
+            return f(reinterpret_cast<const lane_type<CharType>*>(text.data()), text.size(), s);
+    }
+#elif LIBSTREAM_SIMD_KERNEL
+    if not consteval {
+        using kernel = kernel_for<CharType>;
+        if (text.size() >= kernel::width) return find_last_vec<kernel, _negate>(
+            reinterpret_cast<const lane_type<CharType>*>(text.data()),
+            text.size(),
+            s
+        );
+    }
+#endif
+
+    for (std::size_t i = text.size(); i-- > 0;) {
+        auto c = std::make_unsigned_t<CharType>(text[i]);
+        if ((c < 256 and s.contains(std::uint8_t(c))) != _negate) return i;
+    }
+
+    return npos;
+}
+
+/// \brief Call \p cb with the index of every character in a byte set.
+///
+/// The indices are passed in order; the search stops early if \p cb
+/// returns false.
+template <typename CharType, typename Callback>
+constexpr void find_each(std::basic_string_view<CharType> text, const byte_set& s, Callback cb) {
+    std::size_t i = 0;
+#if LIBSTREAM_SIMD_KERNEL
+    if not consteval {
+        using kernel = kernel_for<CharType>;
+        if (text.size() >= kernel::width) {
+            const kernel k{s};
+            auto p = reinterpret_cast<const lane_type<CharType>*>(text.data());
+            for_each_match_vec<kernel>(text.size(), [&](std::size_t j) { return k.match(p + j); }, cb);
+            return;
+        }
+    }
+#elif LIBSTREAM_SIMD_DISPATCH
+    // Without an inlined kernel, classify a few blocks per call instead.
+    if not consteval {
+        if (auto f = dispatch().ops<lane_type<CharType>>().classify) {
+            constexpr std::size_t batch = 4;
+            auto p = reinterpret_cast<const lane_type<CharType>*>(text.data());
+            std::uint64_t words[batch];
+            while (text.size() - i >= 64) {
+                auto n = (text.size() - i) / 64;
+                if (n > batch) n = batch;
+                f(p + i, n, s, words);
+                for (std::size_t w = 0; w < n; ++w, i += 64)
+                    for (auto bits = words[w]; bits; bits &= bits - 1)
+                        if (not cb(i + std::size_t(std::countr_zero(bits)))) return;
+            }
+        }
+    }
+#endif
+
+    for (; i < text.size(); ++i) {
+        auto c = std::make_unsigned_t<CharType>(text[i]);
+        if (c < 256 and s.contains(std::uint8_t(c)) and not cb(i)) return;
+    }
+}
+
+/// \brief Classify every character of a string against a byte set.
+///
+/// This sets bit `i % 64` of `out[i / 64]` iff `text[i]` is in \p s; bits
+/// past the end of the text in the last word are cleared. \p out must have
+/// room for `(text.size() + 63) / 64` words.
+template <typename CharType>
+constexpr void classify(std::basic_string_view<CharType> text, const byte_set& s, std::uint64_t* out) noexcept {
+    std::size_t i = 0;
+#if LIBSTREAM_SIMD_DISPATCH or LIBSTREAM_SIMD_KERNEL
+    if not consteval {
+        using unit = lane_type<CharType>;
+        auto p = reinterpret_cast<const unit*>(text.data());
+        auto words = text.size() / 64;
+#    if LIBSTREAM_SIMD_DISPATCH
+        if (auto f = dispatch().ops<unit>().classify) {
+            f(p, words, s, out);
+            i = words * 64;
+        }
+#    else
+        classify_vec<kernel_for<CharType>>(p, words, s, out);
+        i = words * 64;
+#    endif
+    }
+#endif
+
+    for (; i < text.size(); i += 64) {
+        std::uint64_t bits = 0;
+        for (std::size_t j = 0; j < 64 and i + j < text.size(); ++j) {
+            auto c = std::make_unsigned_t<CharType>(text[i + j]);
+            if (c < 256 and s.contains(std::uint8_t(c))) bits |= std::uint64_t(1) << j;
+        }
+        out[i / 64] = bits;
+    }
+}
+
+/// \brief Call \p cb with the index of every occurrence of \p c.
+///
+/// \see find_each()
+template <typename CharType, typename Callback>
+constexpr void find_each(std::basic_string_view<CharType> text, CharType c, Callback cb) {
+#if LIBSTREAM_SIMD_EQ_KERNEL
+    if not consteval {
+        using kernel = native_eq_kernel<lane_type<CharType>>;
+        if (text.size() >= kernel::width) {
+            const kernel k{lane_type<CharType>(c)};
+            auto p = reinterpret_cast<const lane_type<CharType>*>(text.data());
+            for_each_match_vec<kernel>(text.size(), [&](std::size_t i) { return k.match(p + i); }, cb);
+            return;
+        }
+    }
+#endif
+
+    for (std::size_t i = 0; i < text.size(); ++i)
+        if (text[i] == c and not cb(i))
+            return;
+}
+
+/// \brief Find the first occurrence of \p c.
+///
+/// For single-byte characters, this is \c char_traits::find(), which is
+/// usually \c memchr(); for wider ones, the standard library only has a
+/// scalar loop, so use the equality kernels instead.
+///
+/// \return The index of the character, or \c npos if there is none.
+template <typename CharType>
+[[nodiscard]] constexpr auto find_char(std::basic_string_view<CharType> text, CharType c) noexcept -> std::size_t {
+#if LIBSTREAM_SIMD_DISPATCH
+    if constexpr (sizeof(CharType) != 1) {
+        if not consteval {
+            using unit = lane_type<CharType>;
+            auto& t = dispatch();
+            if (auto f = t.ops<unit>().find_char; f and text.size() >= t.eq_width)
+                return f(reinterpret_cast<const unit*>(text.data()), text.size(), unit(c));
+        }
+    }
+#elif LIBSTREAM_SIMD_EQ_KERNEL
+    if constexpr (sizeof(CharType) != 1) {
+        if not consteval {
+            using unit = lane_type<CharType>;
+            if (text.size() >= native_eq_kernel<unit>::width)
+                return find_char_vec<native_eq_kernel<unit>>(reinterpret_cast<const unit*>(text.data()), text.size(), unit(c));
+        }
+    }
+#endif
+
+    return text.find(c);
+}
+
+/// \brief Find the last occurrence of \p c.
+///
+/// Neither \c char_traits nor the C library has a portable reverse search,
+/// so this uses the equality kernels for all character types.
+///
+/// \see find_char()
+template <typename CharType>
+[[nodiscard]] constexpr auto rfind_char(std::basic_string_view<CharType> text, CharType c) noexcept -> std::size_t {
+#if LIBSTREAM_SIMD_DISPATCH
+    if not consteval {
+        using unit = lane_type<CharType>;
+        auto& t = dispatch();
+        if (auto f = t.ops<unit>().rfind_char; f and text.size() >= t.eq_width)
+            return f(reinterpret_cast<const unit*>(text.data()), text.size(), unit(c));
+    }
+#elif LIBSTREAM_SIMD_EQ_KERNEL
+    if not consteval {
+        using unit = lane_type<CharType>;
+        if (text.size() >= native_eq_kernel<unit>::width)
+            return rfind_char_vec<native_eq_kernel<unit>>(reinterpret_cast<const unit*>(text.data()), text.size(), unit(c));
+    }
+#endif
+
+    return text.rfind(c);
+}
+} // namespace streams::detail
+
+#endif // STREAM_DETAIL_SIMD_HH
@@ -0,0 +1,313 @@
+#ifndef STREAM_LEXER_HH
+#define STREAM_LEXER_HH
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "stream.hh"
+
+namespace streams {
+/// \brief A string that can be used as a template argument.
+///
+/// This is used for the names of lexer rules and for literal tokens,
+/// e.g. \c rule<"ident",...> or \c literal<"eq","==">.
+template <std::size_t N>
+struct fixed_string {
+    char chars[N]{};
+
+    constexpr fixed_string(const char (&s)[N]) noexcept { std::copy_n(s, N, chars); }
+
+    /// \return The length of the string, excluding the terminator.
+    [[nodiscard]] static constexpr auto size() noexcept -> std::size_t { return N - 1; }
+
+    /// \return The string.
+    [[nodiscard]] constexpr auto view() const noexcept -> std::string_view { return {chars, N - 1}; }
+
+    template <std::size_t M>
+    [[nodiscard]] friend constexpr auto
+    operator==(const fixed_string& a, const fixed_string<M>& b) noexcept -> bool {
+        return a.view() == b.view();
+    }
+};
+
+/// \brief A lexer rule for a token made up of code units matching predicates.
+///
+/// The token starts with a code unit that satisfies \c First; if \c Rest
+/// is present, it is followed by as many code units satisfying \c Rest as
+/// possible, otherwise, the token is a single code unit. The predicates
+/// must be usable in constant expressions, e.g. a \c streams::pred or a
+/// captureless lambda; character class predicates are scanned with the
+/// vectorised kernels.
+///
+/// \code
+///     rule<"ident", pred::alpha | pred::is('_'), pred::alnum | pred::is('_')>
+/// \endcode
+template <fixed_string Name, auto First, auto... Rest>
+requires (sizeof...(Rest) <= 1)
+struct rule {
+    static constexpr std::string_view name = Name.view();
+    static constexpr bool skipped = false;
+
+    // Check if a token can start with `c`.
+    template <typename CharType>
+    [[nodiscard]] static constexpr auto _s_starts(CharType c) noexcept -> bool { return First(c); }
+
+    // Get the length of the token at the start of `text`, given that
+    // `_s_starts(text[0])` is true.
+    //
+    // Most tokens are short, so the first few code units are looked up in
+    // a table; only long tokens are handed off to `take_while()`.
+    template <typename CharType>
+    [[nodiscard]] static constexpr auto
+    _s_match(std::basic_string_view<CharType> text) noexcept -> std::size_t {
+        if constexpr (sizeof...(Rest) == 0) return 1;
+        else {
+            constexpr std::size_t short_size = 16;
+            auto end = std::min(text.size(), short_size);
+            for (std::size_t i = 1; i < end; ++i)
+                if (not _s_continues(text[i]))
+                    return i;
+
+            if (text.size() <= short_size) return text.size();
+            return short_size + basic_stream<CharType>{text.substr(short_size)}.take_while(Rest...).size();
+        }
+    }
+
+private:
+    template <typename CharType>
+    static constexpr auto _s_rest_table = [] {
+        std::array<bool, 256> table{};
+        for (char32_t c = 0; c < 256 and c <= detail::max_code_unit<CharType>; ++c)
+            table[c] = (Rest(CharType(c)) and ...);
+        return table;
+    }();
+
+    template <typename CharType>
+    static constexpr auto _s_continues(CharType c) noexcept -> bool {
+        auto u = detail::code_unit(c);
+        if (u < 256) return _s_rest_table<CharType>[u];
+        return (Rest(c) and ...);
+    }
+};
+
+/// \brief A lexer rule for a token that is a fixed string.
+///
+/// The string is compared code unit by code unit, so it should only
+/// contain ASCII characters if the lexer is not for \c char.
+template <fixed_string Name, fixed_string Text>
+requires (Text.size() != 0)
+struct literal {
+    static constexpr std::string_view name = Name.view();
+    static constexpr bool skipped = false;
+
+    template <typename CharType>
+    [[nodiscard]] static constexpr auto _s_starts(CharType c) noexcept -> bool {
+        return detail::code_unit(c) == detail::code_unit(Text.chars[0]);
+    }
+
+    template <typename CharType>
+    [[nodiscard]] static constexpr auto
+    _s_match(std::basic_string_view<CharType> text) noexcept -> std::size_t {
+        if (text.size() < Text.size()) return 0;
+        for (std::size_t i = 1; i < Text.size(); ++i)
+            if (detail::code_unit(text[i]) != detail::code_unit(Text.chars[i]))
+                return 0;
+        return Text.size();
+    }
+};
+
+/// \brief A lexer rule for text that is not a token, e.g. whitespace.
+///
+/// This matches the same text as \c rule<"",First,Rest...>, but the lexer
+/// drops it instead of returning it.
+template <auto First, auto... Rest>
+struct skip : rule<"", First, Rest...> {
+    static constexpr bool skipped = true;
+};
+
+/// \brief A lexer that is compiled from a list of rules.
+///
+/// The set of rules that a token can match is looked up in a table indexed
+/// by its first code unit, which is built at compile time, so the lexer only
+/// tries rules that can actually match. Of those, the one that matches the
+/// longest text wins; if several match the same length, the one that comes
+/// first in the list wins, so keywords should be listed before identifiers.
+///
+/// Tokens are slices of the input, so lexing does not allocate.
+///
+/// \code
+///     using lex = lexer<
+///         skip<pred::space, pred::space>,
+///         rule<"ident", pred::alpha, pred::alnum>,
+///         rule<"number", pred::digit, pred::digit>,
+///         literal<"eq", "==">,
+///         literal<"assign", "=">
+///     >;
+///
+///     stream s{"x = 42"};
+///     while (auto tok = lex::next(s)) {
+///         if (tok->is<"number">()) ...
+///     }
+/// \endcode
+template <typename CharType, typename... Rules>
+class basic_lexer {
+    static_assert(sizeof...(Rules) != 0, "A lexer needs at least one rule");
+    static_assert(sizeof...(Rules) <= 64, "A lexer can have at most 64 rules");
+
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using size_type = std::size_t;
+    using stream_type = basic_stream<char_type>;
+
+    /// The number of rules.
+    static constexpr size_type rule_count = sizeof...(Rules);
+
+    /// The names of the rules, in order.
+    static constexpr std::array<std::string_view, rule_count> names{Rules::name...};
+
+    /// The index of the rule called \c Name.
+    template <fixed_string Name>
+    requires (std::ranges::find(names, Name.view()) != names.end())
+    static constexpr size_type kind_of = size_type(std::ranges::find(names, Name.view()) - names.begin());
+
+    /// A token returned by the lexer.
+    struct token {
+        /// The index of the rule that matched this token.
+        size_type kind;
+
+        /// The text of the token.
+        text_type text;
+
+        /// \return The name of the rule that matched this token.
+        [[nodiscard]] constexpr auto
+        name() const noexcept -> std::string_view { return names[kind]; }
+
+        /// Check if this token was matched by the rule called \c Name.
+        template <fixed_string Name>
+        [[nodiscard]] constexpr auto
+        is() const noexcept -> bool { return kind == kind_of<Name>; }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const token&, const token&) noexcept -> bool = default;
+    };
+
+private:
+    using rule_mask = std::uint64_t;
+
+    // For every value of the first code unit of a token, the rules that
+    // the token can match; code units that don't fit in the table try
+    // all rules.
+    static constexpr std::array<rule_mask, 256> _s_dispatch = [] {
+        std::array<rule_mask, 256> table{};
+        for (char32_t c = 0; c < 256 and c <= detail::max_code_unit<char_type>; ++c) {
+            size_type i = 0;
+            ((table[c] |= rule_mask(Rules::_s_starts(char_type(c))) << i++), ...);
+        }
+        return table;
+    }();
+
+public:
+    /// \brief Get the next token from a stream.
+    ///
+    /// Text matched by \c skip rules before the token is dropped. If no
+    /// rule matches, the stream is left at the text that could not be
+    /// lexed; use \c empty() to tell that apart from the end of the text.
+    ///
+    /// \return The token, or an empty optional at the end of the stream
+    ///         or if no rule matches.
+    [[nodiscard]] static constexpr auto
+    next(stream_type& s) noexcept -> std::optional<token> {
+        for (;;) {
+            if (s.empty()) return std::nullopt;
+            auto [kind, len] = _s_longest_match(s.text());
+            if (len == 0) return std::nullopt;
+            auto text = s.take(len);
+            if (not _s_skipped[kind]) return token{kind, text};
+        }
+    }
+
+    /// \brief Lex a stream into a buffer of tokens.
+    ///
+    /// This stops when the buffer is full, at the end of the stream, or
+    /// at text that no rule matches, whichever comes first.
+    ///
+    /// \return The number of tokens written to \p out.
+    template <std::size_t Extent>
+    [[nodiscard]] static constexpr auto
+    tokenize(stream_type& s, std::span<token, Extent> out) noexcept -> size_type {
+        size_type n = 0;
+        while (n < out.size()) {
+            auto tok = next(s);
+            if (not tok) break;
+            out[n++] = *tok;
+        }
+        return n;
+    }
+
+private:
+    static constexpr std::array<bool, rule_count> _s_skipped{Rules::skipped...};
+
+    template <size_type... I>
+    static constexpr auto _s_try(
+        text_type text,
+        rule_mask mask,
+        bool check_first,
+        std::index_sequence<I...>
+    ) noexcept -> std::pair<size_type, size_type> {
+        size_type best_kind = 0, best_len = 0;
+        auto try_rule = [&]<typename Rule>(size_type kind) {
+            if (not (mask & (rule_mask(1) << kind))) return;
+            if (check_first and not Rule::_s_starts(text[0])) return;
+            auto len = Rule::_s_match(text);
+            if (len > best_len) best_kind = kind, best_len = len;
+        };
+
+        (try_rule.template operator()<Rules>(I), ...);
+        return {best_kind, best_len};
+    }
+
+    static constexpr auto _s_longest_match(text_type text) noexcept -> std::pair<size_type, size_type> {
+        auto c = detail::code_unit(text[0]);
+        auto seq = std::make_index_sequence<rule_count>{};
+        if (c >= 256) return _s_try(text, ~rule_mask(0), true, seq);
+
+        // Usually, only one rule can match, so call it directly.
+        auto mask = _s_dispatch[c];
+        if (std::has_single_bit(mask)) {
+            auto kind = size_type(std::countr_zero(mask));
+            return {kind, _s_matchers[kind](text)};
+        }
+
+        return _s_try(text, mask, false, seq);
+    }
+
+    static constexpr std::array<size_type (*)(text_type) noexcept, rule_count> _s_matchers{
+        &Rules::template _s_match<char_type>...
+    };
+};
+
+template <typename... Rules>
+using lexer = basic_lexer<char, Rules...>;
+
+template <typename... Rules>
+using wlexer = basic_lexer<wchar_t, Rules...>;
+
+template <typename... Rules>
+using u8lexer = basic_lexer<char8_t, Rules...>;
+
+template <typename... Rules>
+using u16lexer = basic_lexer<char16_t, Rules...>;
+
+template <typename... Rules>
+using u32lexer = basic_lexer<char32_t, Rules...>;
+} // namespace streams
+
+#endif // STREAM_LEXER_HH
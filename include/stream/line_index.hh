@@ -0,0 +1,139 @@
+#ifndef STREAM_LINE_INDEX_HH
+#define STREAM_LINE_INDEX_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "stream.hh"
+
+namespace streams {
+/// A position in a text, as shown in diagnostics.
+struct source_position {
+    /// The line number, starting at 1.
+    std::size_t line = 1;
+
+    /// The column number, starting at 1; this counts code units, not
+    /// characters or columns on the screen.
+    std::size_t column = 1;
+
+    [[nodiscard]] friend constexpr auto
+    operator==(const source_position&, const source_position&) noexcept -> bool = default;
+};
+
+/// \brief Maps offsets in a text to line and column numbers.
+///
+/// Streams only keep track of the text that is left, so finding out what
+/// line a stream is at would normally require counting the line breaks
+/// before it each time. An index instead remembers where every line that
+/// it has seen so far starts, and only scans the part of the text that it
+/// has not seen yet; looking up a position that has already been scanned
+/// past is a binary search.
+///
+/// The index is built lazily, as positions are looked up, so creating one
+/// is free, and a parser that reports an error only pays for scanning the
+/// text up to that error. An index is separate from the streams it is
+/// used with, so streams stay cheap to copy.
+///
+/// Lines are separated by \c \\n; a \c \\r before it is considered to be
+/// part of the line. Like streams, an index does not own its text.
+template <typename CharType>
+class basic_line_index {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using size_type = std::size_t;
+    using stream_type = basic_stream<char_type>;
+
+private:
+    text_type _m_text;
+    std::vector<size_type> _m_starts{0};
+    size_type _m_scanned = 0;
+
+public:
+    /// Construct an index for the empty string.
+    constexpr basic_line_index() = default;
+
+    /// Construct an index for \p text.
+    ///
+    /// This does not scan the text yet.
+    explicit constexpr basic_line_index(text_type text) : _m_text(text) {}
+
+    /// Get the text of a line.
+    ///
+    /// \param line The line number, starting at 1.
+    /// \return The text of the line, excluding the line break, or the
+    ///         empty string if there is no such line.
+    [[nodiscard]] constexpr auto
+    line(size_type line) -> text_type {
+        while (_m_starts.size() <= line and _m_scanned < _m_text.size()) _m_scan_line();
+        if (line == 0 or line > _m_starts.size()) return {};
+        auto start = _m_starts[line - 1];
+        auto end = line < _m_starts.size() ? _m_starts[line] - 1 : _m_text.size();
+        return _m_text.substr(start, end - start);
+    }
+
+    ///@{
+    /// \brief Get the line and column of a position in the text.
+    ///
+    /// The position may be given as an offset from the start of the text,
+    /// or as a string or stream that is part of the text, e.g. a token that
+    /// was just parsed; in that case, this returns the position of its start.
+    ///
+    /// Positions past the end of the text are treated as the end of the
+    /// text, so the end of a trailing line break is a valid position on
+    /// the (empty) last line.
+    [[nodiscard]] constexpr auto
+    locate(size_type offset) -> source_position {
+        offset = std::min(offset, _m_text.size());
+        while (_m_scanned < offset) _m_scan_line();
+        auto it = std::ranges::upper_bound(_m_starts, offset);
+        auto line = size_type(it - _m_starts.begin());
+        return {line, offset - _m_starts[line - 1] + 1};
+    }
+
+    /// \see locate(size_type)
+    [[nodiscard]] constexpr auto
+    locate(text_type part) -> source_position {
+        return locate(size_type(part.data() - _m_text.data()));
+    }
+
+    /// \see locate(size_type)
+    [[nodiscard]] constexpr auto
+    locate(const stream_type& s) -> source_position {
+        return locate(s.text());
+    }
+    ///@}
+
+    /// \return The number of lines scanned so far.
+    [[nodiscard]] constexpr auto
+    lines_scanned() const noexcept -> size_type { return _m_starts.size(); }
+
+    /// \return The text this index refers to.
+    [[nodiscard]] constexpr auto
+    text() const noexcept -> text_type { return _m_text; }
+
+private:
+    // Record the start of the next line; this uses `char_traits::find()`,
+    // i.e. `memchr()`, which is vectorised on most platforms.
+    constexpr void _m_scan_line() {
+        auto pos = _m_text.find(char_type('\n'), _m_scanned);
+        if (pos == text_type::npos) {
+            _m_scanned = _m_text.size();
+            return;
+        }
+
+        _m_scanned = pos + 1;
+        _m_starts.push_back(_m_scanned);
+    }
+};
+
+using line_index = basic_line_index<char>;
+using wline_index = basic_line_index<wchar_t>;
+using u8line_index = basic_line_index<char8_t>;
+using u16line_index = basic_line_index<char16_t>;
+using u32line_index = basic_line_index<char32_t>;
+} // namespace streams
+
+#endif // STREAM_LINE_INDEX_HH
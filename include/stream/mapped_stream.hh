@@ -0,0 +1,231 @@
+#ifndef STREAM_MAPPED_STREAM_HH
+#define STREAM_MAPPED_STREAM_HH
+
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <utility>
+
+#include "stream.hh"
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace streams {
+/// Hints for how a mapped file is going to be accessed.
+struct map_options {
+    /// The file will be read from start to end, so the kernel should
+    /// read ahead aggressively and can drop pages once they are behind
+    /// us. Parsers almost always do this, so it is enabled by default.
+    bool sequential = true;
+
+    /// Ask for the mapping to be backed by huge pages where possible.
+    /// This is only a hint, and the kernel may well ignore it for
+    /// file-backed mappings.
+    bool huge_pages = false;
+
+    /// Read the entire file into memory when mapping it rather than
+    /// faulting pages in as they are accessed.
+    bool populate = false;
+};
+
+/// \brief A stream over a memory-mapped file.
+///
+/// Unlike \c basic_stream, this owns the text it refers to: the file is
+/// mapped into memory when the stream is opened and unmapped when it is
+/// destroyed. This allows parsing a file of any size without copying it
+/// into memory first, and without having to read all of it up front.
+///
+/// Mapped streams expose the entire \c basic_stream interface, and they
+/// can be converted to a plain stream cheaply, e.g. to pass them to code
+/// that expects one; such streams must not outlive the mapped stream.
+///
+/// The contents of the file are interpreted as an array of \c CharType;
+/// if the file size is not a multiple of the character size, any extra
+/// bytes at the end are ignored. Modifying the file while it is mapped
+/// results in undefined behaviour.
+template <typename CharType>
+class basic_mapped_stream : public basic_stream<CharType> {
+    using base = basic_stream<CharType>;
+
+    void* _m_base = nullptr;
+    std::size_t _m_bytes = 0;
+
+public:
+    using typename base::char_type;
+    using typename base::size_type;
+    using typename base::text_type;
+
+    /// Construct an empty stream that does not map anything.
+    basic_mapped_stream() = default;
+
+    basic_mapped_stream(const basic_mapped_stream&) = delete;
+    auto operator=(const basic_mapped_stream&) -> basic_mapped_stream& = delete;
+
+    basic_mapped_stream(basic_mapped_stream&& other) noexcept
+        : base(std::exchange(other._m_stream(), {})),
+          _m_base(std::exchange(other._m_base, nullptr)),
+          _m_bytes(std::exchange(other._m_bytes, 0)) {}
+
+    auto operator=(basic_mapped_stream&& other) noexcept -> basic_mapped_stream& {
+        if (this == &other) return *this;
+        _m_unmap();
+        _m_stream() = std::exchange(other._m_stream(), {});
+        _m_base = std::exchange(other._m_base, nullptr);
+        _m_bytes = std::exchange(other._m_bytes, 0);
+        return *this;
+    }
+
+    ~basic_mapped_stream() noexcept { _m_unmap(); }
+
+    /// Map a file into memory.
+    ///
+    /// \param path The file to map.
+    /// \param options Hints for how the file will be accessed.
+    /// \return The stream, or an empty optional if the file could not be
+    ///         opened or mapped; \c errno (or \c GetLastError() on Windows)
+    ///         indicates the reason. Only regular files can be mapped; for
+    ///         anything else, e.g. a directory, pipe, or device, this fails
+    ///         with \c ENODEV (\c ERROR_INVALID_FUNCTION on Windows).
+    [[nodiscard]] static auto open(
+        const std::filesystem::path& path,
+        map_options options = {}
+    ) noexcept -> std::optional<basic_mapped_stream> {
+        basic_mapped_stream s;
+        if (not s._m_map(path, options)) return std::nullopt;
+        return s;
+    }
+
+    /// \return The entire contents of the mapped file, irrespective of
+    ///         how much of the stream has been consumed.
+    [[nodiscard]] auto mapped_text() const noexcept -> text_type {
+        return text_type{static_cast<const char_type*>(_m_base), _m_bytes / sizeof(char_type)};
+    }
+
+    /// Get a plain stream over the unconsumed text.
+    ///
+    /// This is the same as just converting this to a \c basic_stream.
+    [[nodiscard]] auto stream() const noexcept -> base { return *this; }
+
+private:
+    auto _m_stream() noexcept -> base& { return *this; }
+
+    auto _m_map(const std::filesystem::path& path, map_options options) noexcept -> bool {
+#ifdef _WIN32
+        auto file = ::CreateFileW(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            options.sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL,
+            nullptr
+        );
+
+        if (file == INVALID_HANDLE_VALUE) return false;
+        if (::GetFileType(file) != FILE_TYPE_DISK) {
+            ::CloseHandle(file);
+            ::SetLastError(ERROR_INVALID_FUNCTION);
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (not ::GetFileSizeEx(file, &size)) {
+            ::CloseHandle(file);
+            return false;
+        }
+
+        // Mapping an empty file is an error on Windows.
+        if (size.QuadPart == 0) {
+            ::CloseHandle(file);
+            return true;
+        }
+
+        // The view keeps the mapping alive, so we can close both handles.
+        auto mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        ::CloseHandle(file);
+        if (not mapping) return false;
+        _m_base = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        ::CloseHandle(mapping);
+        if (not _m_base) return false;
+        _m_bytes = std::size_t(size.QuadPart);
+#else
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        // Pipes and devices report a size of 0 (or one that has nothing
+        // to do with their contents), so don't mistake them for empty files.
+        if (not S_ISREG(st.st_mode)) {
+            ::close(fd);
+            errno = ENODEV;
+            return false;
+        }
+
+        // mmap() rejects zero-length mappings.
+        if (st.st_size == 0) {
+            ::close(fd);
+            return true;
+        }
+
+        auto flags = MAP_PRIVATE;
+#    ifdef MAP_POPULATE
+        if (options.populate) flags |= MAP_POPULATE;
+#    endif
+
+        auto addr = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, flags, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED) return false;
+        _m_base = addr;
+        _m_bytes = std::size_t(st.st_size);
+
+        // These are only hints, so ignore errors.
+        if (options.sequential) ::madvise(_m_base, _m_bytes, MADV_SEQUENTIAL);
+#    ifdef MADV_HUGEPAGE
+        if (options.huge_pages) ::madvise(_m_base, _m_bytes, MADV_HUGEPAGE);
+#    endif
+#endif
+
+        _m_stream() = base{mapped_text()};
+        return true;
+    }
+
+    void _m_unmap() noexcept {
+        if (not _m_base) return;
+#ifdef _WIN32
+        ::UnmapViewOfFile(_m_base);
+#else
+        ::munmap(_m_base, _m_bytes);
+#endif
+        _m_base = nullptr;
+        _m_bytes = 0;
+        _m_stream() = {};
+    }
+};
+
+using mapped_stream = basic_mapped_stream<char>;
+using wmapped_stream = basic_mapped_stream<wchar_t>;
+using u8mapped_stream = basic_mapped_stream<char8_t>;
+using u16mapped_stream = basic_mapped_stream<char16_t>;
+using u32mapped_stream = basic_mapped_stream<char32_t>;
+} // namespace streams
+
+#endif // STREAM_MAPPED_STREAM_HH
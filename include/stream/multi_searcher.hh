@@ -0,0 +1,319 @@
+#ifndef STREAM_MULTI_SEARCHER_HH
+#define STREAM_MULTI_SEARCHER_HH
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "stream.hh"
+
+namespace streams {
+/// \brief A precompiled search for several needles at once.
+///
+/// This finds whichever of a list of needles occurs first in a text, in a
+/// single pass over it, rather than searching for each needle in turn and
+/// taking the earliest match. If several needles start at the same position,
+/// the one that comes first in the list wins; e.g. with the needles \c "ab"
+/// and \c "abc", the former is found in \c "abcd".
+///
+/// \code
+///     multi_searcher ends{{"\r\n", "; ", "-->"}};
+///     auto [text, which] = s.take_until(ends);
+/// \endcode
+///
+/// The algorithm used depends on the needles:
+///
+///     - Up to \c max_teddy_size non-empty needles of single-byte characters
+///       are found at runtime with the vectorised Teddy algorithm, which
+///       looks for their first few bytes in a whole block of text at once
+///       and only then compares the needles themselves.
+///
+///     - Otherwise, and in constant expressions, the needles are compiled
+///       into an Aho-Corasick automaton, which takes linear time. Its table
+///       has one row per distinct prefix of the needles and one column per
+///       distinct character in them, so it can get large for thousands of
+///       long needles with many different characters.
+///
+/// Like searchers, multi-searchers do not own the needles they were
+/// constructed from, so those must outlive them.
+///
+/// \see basic_stream::take_until(const multi_searcher_type&)
+template <typename CharType>
+class basic_multi_searcher {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using size_type = std::size_t;
+
+    /// The largest number of needles that are searched for with Teddy.
+    static constexpr size_type max_teddy_size = 64;
+
+    /// The result of a search.
+    struct match {
+        /// The index of the match in the text, or \c npos if there is none.
+        size_type pos = text_type::npos;
+
+        /// The index of the needle that was found, in the order in which
+        /// the needles were passed to the constructor.
+        size_type needle = 0;
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const match&, const match&) noexcept -> bool = default;
+    };
+
+private:
+    using unsigned_type = std::make_unsigned_t<char_type>;
+    using state_type = std::uint32_t;
+
+    static constexpr state_type none = state_type(-1);
+
+    std::vector<text_type> _m_needles;
+
+    // The lowest index of an empty needle, if any; it matches everywhere.
+    state_type _m_empty = none;
+
+    // Every code unit that occurs in a needle has a column in the table
+    // of transitions; code units below 256 are looked up in `_m_low`, the
+    // rest in `_m_units`, which is sorted. Column 0 is for code units that
+    // are in no needle.
+    std::array<state_type, 256> _m_low{};
+    std::vector<unsigned_type> _m_units;
+    size_type _m_columns = 1;
+
+    // The transitions of the automaton, one row per state; state 0 is the
+    // root. For each state, we also store the length of the prefix it
+    // stands for and the longest needle that ends there, if any.
+    std::vector<state_type> _m_next;
+    std::vector<state_type> _m_depth;
+    std::vector<state_type> _m_out;
+
+    // The needles in each Teddy bucket, with `_m_bucket_start[b]` pointing
+    // to the first one in bucket `b`.
+    bool _m_teddy = false;
+    detail::teddy_masks _m_masks;
+    std::vector<state_type> _m_buckets;
+    std::array<state_type, detail::teddy_masks::max_buckets + 1> _m_bucket_start{};
+
+public:
+    /// Construct a searcher that never finds anything; this does not allocate.
+    constexpr basic_multi_searcher() = default;
+
+    /// Construct a searcher for \p needles.
+    explicit constexpr basic_multi_searcher(std::span<const text_type> needles)
+        : _m_needles(needles.begin(), needles.end()) {
+        if (_m_needles.empty()) return;
+        for (size_type i = 0; i < _m_needles.size(); ++i) {
+            if (_m_needles[i].empty()) {
+                _m_empty = state_type(i);
+                return;
+            }
+        }
+
+        _m_build_automaton();
+        if constexpr (sizeof(char_type) == 1)
+            if (_m_needles.size() <= max_teddy_size) _m_build_teddy();
+    }
+
+    /// \see basic_multi_searcher(std::span<const text_type>)
+    explicit constexpr basic_multi_searcher(std::initializer_list<text_type> needles)
+        : basic_multi_searcher(std::span<const text_type>{needles.begin(), needles.size()}) {}
+
+    /// Search a string for the needles.
+    ///
+    /// \return The position of the first match and the index of the needle
+    ///         that matched there; if no needle occurs in \p text, the
+    ///         position is \c npos.
+    [[nodiscard]] constexpr auto
+    find(text_type text) const noexcept -> match {
+        if (_m_empty != none) {
+            for (state_type i = 0; i < _m_empty; ++i)
+                if (text.starts_with(_m_needles[i])) return {0, i};
+            return {0, _m_empty};
+        }
+
+        if (_m_needles.empty()) return {};
+        if constexpr (sizeof(char_type) == 1) {
+            if not consteval {
+                if (_m_teddy) {
+                    if (auto f = _s_teddy_kernel()) return _m_find_teddy(text, f);
+                }
+            }
+        }
+
+        return _m_find_automaton(text);
+    }
+
+    /// \return The needles this searcher looks for.
+    [[nodiscard]] constexpr auto
+    needles() const noexcept -> std::span<const text_type> { return _m_needles; }
+
+    /// \return The number of needles.
+    [[nodiscard]] constexpr auto
+    size() const noexcept -> size_type { return _m_needles.size(); }
+
+private:
+    using teddy_fn = size_type (*)(const std::uint8_t*, size_type, const detail::teddy_masks&) noexcept;
+
+    constexpr void _m_build_automaton() {
+        for (auto n : _m_needles)
+            for (auto c : n)
+                _m_units.push_back(unsigned_type(c));
+
+        std::ranges::sort(_m_units);
+        _m_units.erase(std::ranges::unique(_m_units).begin(), _m_units.end());
+        _m_columns = _m_units.size() + 1;
+        for (size_type i = 0; i < _m_units.size() and _m_units[i] < 256; ++i)
+            _m_low[_m_units[i]] = state_type(i + 1);
+
+        // Build the trie of the needles first.
+        auto add_state = [&](state_type depth) {
+            _m_next.resize(_m_next.size() + _m_columns, none);
+            _m_depth.push_back(depth);
+            _m_out.push_back(none);
+            return state_type(_m_depth.size() - 1);
+        };
+
+        add_state(0);
+        for (size_type i = 0; i < _m_needles.size(); ++i) {
+            state_type s = 0;
+            for (auto c : _m_needles[i]) {
+                auto col = _m_column(c);
+                if (_m_next[s * _m_columns + col] == none) {
+                    auto t = add_state(_m_depth[s] + 1);
+                    _m_next[s * _m_columns + col] = t;
+                }
+
+                s = _m_next[s * _m_columns + col];
+            }
+
+            if (_m_out[s] == none) _m_out[s] = state_type(i);
+        }
+
+        // Then fill in the missing transitions breadth-first, from the
+        // states that the failure links point to; these are always shorter,
+        // so they have already been filled in.
+        std::vector<state_type> fail(_m_depth.size(), 0);
+        std::vector<state_type> queue;
+        for (size_type col = 0; col < _m_columns; ++col) {
+            auto& t = _m_next[col];
+            if (t == none) t = 0;
+            else queue.push_back(t);
+        }
+
+        for (size_type i = 0; i < queue.size(); ++i) {
+            auto s = queue[i];
+            auto f = fail[s];
+            if (_m_out[s] == none) _m_out[s] = _m_out[f];
+            for (size_type col = 0; col < _m_columns; ++col) {
+                auto& t = _m_next[s * _m_columns + col];
+                if (t == none) {
+                    t = _m_next[f * _m_columns + col];
+                } else {
+                    fail[t] = _m_next[f * _m_columns + col];
+                    queue.push_back(t);
+                }
+            }
+        }
+    }
+
+    // Needles with similar prefixes are put in the same bucket so that
+    // their fingerprints do not match more than they need to.
+    constexpr void _m_build_teddy() {
+        auto shortest = std::ranges::min(_m_needles, {}, [](text_type n) { return n.size(); }).size();
+        _m_masks.length = std::min(shortest, detail::teddy_masks::max_length);
+
+        _m_buckets.resize(_m_needles.size());
+        for (size_type i = 0; i < _m_buckets.size(); ++i) _m_buckets[i] = state_type(i);
+        std::ranges::sort(_m_buckets, {}, [&](state_type i) { return _m_needles[i].substr(0, _m_masks.length); });
+
+        auto per_bucket = (_m_buckets.size() + detail::teddy_masks::max_buckets - 1) / detail::teddy_masks::max_buckets;
+        for (size_type b = 0; b <= detail::teddy_masks::max_buckets; ++b)
+            _m_bucket_start[b] = state_type(std::min(b * per_bucket, _m_buckets.size()));
+
+        for (size_type b = 0; b < detail::teddy_masks::max_buckets; ++b) {
+            for (auto i = _m_bucket_start[b]; i < _m_bucket_start[b + 1]; ++i) {
+                std::uint8_t prefix[detail::teddy_masks::max_length]{};
+                for (size_type j = 0; j < _m_masks.length; ++j) prefix[j] = std::uint8_t(_m_needles[_m_buckets[i]][j]);
+                _m_masks.insert(b, prefix);
+            }
+        }
+
+        _m_teddy = true;
+    }
+
+    [[nodiscard]] constexpr auto _m_column(char_type c) const noexcept -> size_type {
+        auto u = unsigned_type(c);
+        if (u < 256) return _m_low[u];
+        auto it = std::ranges::lower_bound(_m_units, u);
+        return it != _m_units.end() and *it == u ? size_type(it - _m_units.begin()) + 1 : 0;
+    }
+
+    // Once a match has been found, keep going until no needle that is still
+    // in progress can start at or before it, since one that starts earlier,
+    // or at the same position but comes first in the list, takes precedence.
+    [[nodiscard]] constexpr auto _m_find_automaton(text_type text) const noexcept -> match {
+        match best;
+        state_type s = 0;
+        for (size_type i = 0; i < text.size(); ++i) {
+            s = _m_next[s * _m_columns + _m_column(text[i])];
+            if (best.pos != text_type::npos and i + 1 - _m_depth[s] > best.pos) break;
+            if (auto id = _m_out[s]; id != none) {
+                auto start = i + 1 - _m_needles[id].size();
+                if (best.pos == text_type::npos or start < best.pos or (start == best.pos and id < best.needle))
+                    best = {start, id};
+            }
+        }
+
+        return best;
+    }
+
+    [[nodiscard]] auto _m_find_teddy(text_type text, teddy_fn f) const noexcept -> match {
+        auto p = reinterpret_cast<const std::uint8_t*>(text.data());
+        for (size_type i = 0; i < text.size(); ++i) {
+            auto c = f(p + i, text.size() - i, _m_masks);
+            if (c == text_type::npos) break;
+            i += c;
+
+            // All needles are at least as long as the fingerprint, so this
+            // never reads past the end of the text.
+            auto best = none;
+            for (auto b = _m_masks.buckets(p + i); b; b &= b - 1) {
+                auto bucket = std::countr_zero(b);
+                for (auto j = _m_bucket_start[bucket]; j < _m_bucket_start[bucket + 1]; ++j) {
+                    auto id = _m_buckets[j];
+                    if (id < best and text.substr(i).starts_with(_m_needles[id])) best = id;
+                }
+            }
+
+            if (best != none) return {i, best};
+        }
+
+        return {};
+    }
+
+    [[nodiscard]] static auto _s_teddy_kernel() noexcept -> teddy_fn {
+#if LIBSTREAM_SIMD_DISPATCH
+        return detail::dispatch().find_teddy;
+#elif LIBSTREAM_SIMD_TEDDY
+        return &detail::find_teddy_vec<detail::native_teddy_kernel>;
+#else
+        return nullptr;
+#endif
+    }
+};
+
+using multi_searcher = basic_multi_searcher<char>;
+using wmulti_searcher = basic_multi_searcher<wchar_t>;
+using u8multi_searcher = basic_multi_searcher<char8_t>;
+using u16multi_searcher = basic_multi_searcher<char16_t>;
+using u32multi_searcher = basic_multi_searcher<char32_t>;
+} // namespace streams
+
+#endif // STREAM_MULTI_SEARCHER_HH
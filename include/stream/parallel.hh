@@ -0,0 +1,168 @@
+#ifndef STREAM_PARALLEL_HH
+#define STREAM_PARALLEL_HH
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "stream.hh"
+
+namespace streams {
+/// The default chunk size, in bytes, used by \c parallel_chunks() and
+/// \c parallel_lines(). This is small enough for a chunk to stay in
+/// a core's L2 cache while it is being processed.
+inline constexpr std::size_t default_parallel_chunk_bytes = 256 * 1'024;
+
+namespace detail {
+template <typename CharType>
+[[nodiscard]] constexpr auto default_chunk_size() noexcept -> std::size_t {
+    return std::max<std::size_t>(default_parallel_chunk_bytes / sizeof(CharType), 1);
+}
+
+// Run `cb(i)` for every `i` in [0, count) on up to `n_threads` threads,
+// including the calling thread. The first exception thrown by any of
+// the calls is rethrown once all threads are done.
+template <typename Callback>
+void parallel_for(std::size_t count, std::size_t n_threads, Callback& cb) {
+    if (n_threads == 0) n_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    n_threads = std::min(n_threads, count);
+    if (n_threads <= 1) {
+        for (std::size_t i = 0; i < count; ++i) cb(i);
+        return;
+    }
+
+    std::atomic<std::size_t> next = 0;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&] {
+        for (;;) {
+            auto i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) return;
+            try {
+                cb(i);
+            } catch (...) {
+                std::unique_lock lock{error_mutex};
+                if (not error) error = std::current_exception();
+                next.store(count, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    threads.reserve(n_threads - 1);
+    for (std::size_t i = 1; i < n_threads; ++i) threads.emplace_back(work);
+    work();
+    threads.clear();
+    if (error) std::rethrow_exception(error);
+}
+} // namespace detail
+
+/// \brief Process a stream in chunks on several threads.
+///
+/// The stream is split into chunks as if by \c basic_stream::chunks(), and
+/// \p cb is invoked once for each chunk, concurrently, on up to \p n_threads
+/// threads (including the calling thread); if \p n_threads is 0, the number
+/// of hardware threads is used instead. No text is copied: each chunk is a
+/// stream that refers to the same text as \p s.
+///
+/// If \p cb returns a value, the return values are collected and returned
+/// in the same order as the chunks they were produced from.
+///
+/// If \p cb throws, no more chunks are started, and the first exception
+/// thrown is rethrown once all threads are done.
+///
+/// \param s The stream to process.
+/// \param n_threads The maximum number of threads to use.
+/// \param cb A callable that takes a \c basic_stream.
+/// \param chunk_size The minimum chunk size, in characters.
+/// \param separator The record separator to split the text at.
+/// \return A vector of the results of \p cb, if it returns a value.
+template <typename CharType, typename Callback>
+requires std::invocable<Callback&, basic_stream<CharType>>
+auto parallel_chunks(
+    basic_stream<CharType> s,
+    std::size_t n_threads,
+    Callback cb,
+    std::size_t chunk_size = detail::default_chunk_size<CharType>(),
+    CharType separator = CharType('\n')
+) {
+    using result = std::invoke_result_t<Callback&, basic_stream<CharType>>;
+
+    // Finding the boundaries is cheap since we only ever search for
+    // one separator per chunk, so just do that up front.
+    std::vector<basic_stream<CharType>> chunks;
+    for (auto chunk : s.chunks(chunk_size, separator)) chunks.push_back(chunk);
+
+    if constexpr (std::is_void_v<result>) {
+        auto run = [&](std::size_t i) { std::invoke(cb, chunks[i]); };
+        detail::parallel_for(chunks.size(), n_threads, run);
+    } else {
+        std::vector<std::optional<result>> results(chunks.size());
+        auto run = [&](std::size_t i) { results[i].emplace(std::invoke(cb, chunks[i])); };
+        detail::parallel_for(chunks.size(), n_threads, run);
+
+        std::vector<result> out;
+        out.reserve(results.size());
+        for (auto& r : results) out.push_back(std::move(*r));
+        return out;
+    }
+}
+
+/// \brief Process the lines of a stream on several threads.
+///
+/// This splits the stream into chunks of whole lines, as \c parallel_chunks()
+/// does, and invokes \p cb once for every line, yielding the same lines as
+/// \c basic_stream::lines(). Lines within a chunk are processed in order, on
+/// the same thread; lines in different chunks are processed concurrently.
+///
+/// If \p cb returns a value, the return values are collected and returned
+/// in the same order as the lines they were produced from.
+///
+/// \see parallel_chunks()
+template <typename CharType, typename Callback>
+requires std::invocable<Callback&, basic_stream<CharType>>
+auto parallel_lines(
+    basic_stream<CharType> s,
+    std::size_t n_threads,
+    Callback cb,
+    std::size_t chunk_size = detail::default_chunk_size<CharType>()
+) {
+    using result = std::invoke_result_t<Callback&, basic_stream<CharType>>;
+    auto end = s.text().data() + s.size();
+
+    // Every chunk but the last ends with a line separator, which would
+    // produce a spurious empty line at the end of the chunk.
+    auto for_each_line = [&](basic_stream<CharType> chunk, auto&& f) {
+        auto last = chunk.data() + chunk.size() == end;
+        for (auto line : chunk.lines()) {
+            if (not last and line.empty() and line.data() == chunk.data() + chunk.size()) break;
+            f(line);
+        }
+    };
+
+    if constexpr (std::is_void_v<result>) {
+        parallel_chunks(s, n_threads, [&](basic_stream<CharType> chunk) {
+            for_each_line(chunk, [&](basic_stream<CharType> line) { std::invoke(cb, line); });
+        }, chunk_size);
+    } else {
+        auto per_chunk = parallel_chunks(s, n_threads, [&](basic_stream<CharType> chunk) {
+            std::vector<result> results;
+            for_each_line(chunk, [&](basic_stream<CharType> line) { results.push_back(std::invoke(cb, line)); });
+            return results;
+        }, chunk_size);
+
+        std::vector<result> out;
+        for (auto& results : per_chunk) std::ranges::move(results, std::back_inserter(out));
+        return out;
+    }
+}
+} // namespace streams
+
+#endif // STREAM_PARALLEL_HH
@@ -0,0 +1,334 @@
+#ifndef STREAM_PIPELINE_HH
+#define STREAM_PIPELINE_HH
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "detail/file.hh"
+#include "stream.hh"
+
+namespace streams {
+/// Settings for a \c basic_stream_pipeline.
+struct pipeline_options {
+    /// The number of threads that process chunks; if 0, the number of
+    /// hardware threads is used instead.
+    std::size_t workers = 0;
+
+    /// The size of each buffer, in bytes. This is also the size of the
+    /// reads the pipeline issues, so it should be large enough for the
+    /// device to reach its full bandwidth.
+    std::size_t buffer_bytes = 1'024 * 1'024;
+
+    /// The number of buffers; if 0, two per worker and two for the reader
+    /// are used. At least two are always allocated.
+    std::size_t buffers = 0;
+
+    /// The number of files after the one being read that the kernel is
+    /// asked to start reading in the background.
+    std::size_t readahead_files = 4;
+};
+
+/// \brief Read and process many files at once.
+///
+/// This reads a list of files on a dedicated thread, one buffer at a time,
+/// and hands the buffers to a pool of worker threads as streams, so that
+/// reading and parsing overlap; the reader also asks the kernel to read ahead
+/// of it, both in the current file and in the next few, so that the device
+/// always has work queued.
+///
+/// \code
+///     stream_pipeline pipeline{{.workers = 8}};
+///     auto failures = pipeline.run(paths, [&](auto chunk) {
+///         for (auto line : chunk.stream.lines()) parse(line);
+///     });
+/// \endcode
+///
+/// Each file is split into chunks like \c basic_stream::chunks() does: every
+/// chunk but the last of each file ends with a separator, so records are never
+/// split between chunks unless a single record does not fit in a buffer. The
+/// chunks of a file are processed concurrently, in no particular order, and
+/// the text of a chunk is only valid until the callback returns, at which point
+/// its buffer is recycled; nothing is allocated per chunk.
+///
+/// The buffers are allocated when the pipeline is constructed and reused by
+/// every call to \c run(), so a pipeline should be kept around for several
+/// batches of files; it must not be used by more than one thread at a time.
+///
+/// The contents of each file are interpreted as an array of \c CharType; if
+/// the size of a file is not a multiple of the character size, any extra bytes
+/// at the end are ignored.
+template <typename CharType>
+class basic_stream_pipeline {
+public:
+    using char_type = CharType;
+    using size_type = std::size_t;
+    using text_type = std::basic_string_view<char_type>;
+    using stream_type = basic_stream<char_type>;
+
+    /// A part of a file that is passed to the callback.
+    struct chunk {
+        /// The text of the chunk.
+        stream_type stream;
+
+        /// The index of the file in the list passed to \c run().
+        size_type file = 0;
+
+        /// The position of the chunk in the file, in characters.
+        std::uint64_t offset = 0;
+    };
+
+    /// A file that could not be read.
+    struct failure {
+        /// The index of the file in the list passed to \c run().
+        size_type file = 0;
+
+        /// The reason the file could not be opened or read.
+        std::error_code error;
+    };
+
+private:
+    // A chunk that has been read and is waiting for a worker.
+    struct _job {
+        size_type buffer;
+        chunk c;
+    };
+
+    pipeline_options _m_options;
+    std::vector<std::unique_ptr<char_type[]>> _m_buffers;
+    size_type _m_capacity = 0;
+
+public:
+    /// Create a pipeline and allocate its buffers.
+    ///
+    /// \throw std::bad_alloc if the buffers cannot be allocated.
+    explicit basic_stream_pipeline(pipeline_options options = {}) : _m_options(options) {
+        if (_m_options.workers == 0) _m_options.workers = std::max(std::thread::hardware_concurrency(), 1u);
+        if (_m_options.buffers == 0) _m_options.buffers = 2 * _m_options.workers + 2;
+        _m_options.buffers = std::max<size_type>(_m_options.buffers, 2);
+        _m_capacity = std::max<size_type>(_m_options.buffer_bytes / sizeof(char_type), 1);
+        _m_options.buffer_bytes = _m_capacity * sizeof(char_type);
+
+        _m_buffers.reserve(_m_options.buffers);
+        for (size_type i = 0; i < _m_options.buffers; ++i)
+            _m_buffers.push_back(std::make_unique_for_overwrite<char_type[]>(_m_capacity));
+    }
+
+    /// \return The settings of this pipeline, with defaults filled in.
+    [[nodiscard]] auto options() const noexcept -> const pipeline_options& { return _m_options; }
+
+    /// \brief Process a list of files.
+    ///
+    /// This reads every file in \p files and invokes \p cb for each chunk
+    /// of it on one of the worker threads; the calling thread does the
+    /// reading, and this returns once every chunk has been processed.
+    ///
+    /// If \p cb throws, no more chunks are started, and the first exception
+    /// thrown is rethrown once all threads are done.
+    ///
+    /// \param files The files to read.
+    /// \param cb A callable that takes a \c chunk.
+    /// \param separator The record separator to split the files at.
+    /// \return The files that could not be opened or read, in order; the
+    ///         chunks of a file that were read before an error occurred
+    ///         have still been processed.
+    template <typename Callback>
+    requires std::invocable<Callback&, chunk>
+    auto run(
+        std::span<const std::filesystem::path> files,
+        Callback cb,
+        char_type separator = char_type('\n')
+    ) -> std::vector<failure> {
+        std::mutex mutex;
+        std::condition_variable buffer_freed;
+        std::condition_variable job_ready;
+        std::vector<size_type> free;
+        std::deque<_job> jobs;
+        bool done = false;
+        std::atomic<bool> stop = false;
+        std::exception_ptr error;
+
+        free.reserve(_m_buffers.size());
+        for (size_type i = 0; i < _m_buffers.size(); ++i) free.push_back(i);
+
+        auto release = [&](size_type b) {
+            {
+                std::unique_lock lock{mutex};
+                free.push_back(b);
+            }
+            buffer_freed.notify_one();
+        };
+
+        auto fail = [&] {
+            std::unique_lock lock{mutex};
+            if (not error) error = std::current_exception();
+            stop.store(true, std::memory_order_relaxed);
+        };
+
+        // Workers keep releasing buffers after an error without processing
+        // them, so the reader never waits for a buffer forever.
+        auto work = [&] {
+            for (;;) {
+                _job j;
+                {
+                    std::unique_lock lock{mutex};
+                    job_ready.wait(lock, [&] { return not jobs.empty() or done; });
+                    if (jobs.empty()) return;
+                    j = jobs.front();
+                    jobs.pop_front();
+                }
+
+                if (not stop.load(std::memory_order_relaxed)) {
+                    try {
+                        std::invoke(cb, j.c);
+                    } catch (...) {
+                        fail();
+                    }
+                }
+
+                release(j.buffer);
+            }
+        };
+
+        std::vector<std::jthread> threads;
+        threads.reserve(_m_options.workers);
+        for (size_type i = 0; i < _m_options.workers; ++i) threads.emplace_back(work);
+
+        std::vector<failure> failures;
+        try {
+            _m_read(files, separator, failures, stop, [&] {
+                std::unique_lock lock{mutex};
+                buffer_freed.wait(lock, [&] { return not free.empty(); });
+                auto b = free.back();
+                free.pop_back();
+                return b;
+            }, release, [&](size_type b, chunk c) {
+                {
+                    std::unique_lock lock{mutex};
+                    jobs.push_back({b, c});
+                }
+                job_ready.notify_one();
+            });
+        } catch (...) {
+            fail();
+        }
+
+        {
+            std::unique_lock lock{mutex};
+            done = true;
+        }
+
+        job_ready.notify_all();
+        threads.clear();
+        if (error) std::rethrow_exception(error);
+        return failures;
+    }
+
+private:
+    [[nodiscard]] auto _m_bytes(size_type b) const noexcept -> char* {
+        return reinterpret_cast<char*>(_m_buffers[b].get());
+    }
+
+    // Read each file into as many buffers as it takes. Whatever follows the
+    // last separator in a full buffer is moved to the start of the next one,
+    // which is why the reader may need to hold two buffers at once.
+    template <typename Acquire, typename Release, typename Submit>
+    void _m_read(
+        std::span<const std::filesystem::path> files,
+        char_type separator,
+        std::vector<failure>& failures,
+        const std::atomic<bool>& stop,
+        Acquire acquire,
+        Release release,
+        Submit submit
+    ) {
+        struct opened {
+            detail::input_file file;
+            std::error_code ec;
+        };
+
+        auto bytes = _m_options.buffer_bytes;
+        std::deque<opened> ahead;
+        size_type next_open = 0;
+        for (size_type i = 0; i < files.size(); ++i) {
+            while (next_open < files.size() and next_open <= i + _m_options.readahead_files) {
+                opened o;
+                o.file = detail::input_file::open(files[next_open], o.ec);
+                if (not o.ec) o.file.prefetch(0, bytes);
+                ahead.push_back(std::move(o));
+                ++next_open;
+            }
+
+            auto [file, ec] = std::move(ahead.front());
+            ahead.pop_front();
+            if (stop.load(std::memory_order_relaxed)) return;
+            if (ec) {
+                failures.push_back({i, ec});
+                continue;
+            }
+
+            auto b = acquire();
+            size_type have = 0;
+            std::uint64_t start = 0;
+            std::uint64_t pos = 0;
+            for (;;) {
+                auto n = file.read(_m_bytes(b) + have, bytes - have, pos, ec);
+                have += n;
+                pos += n;
+                if (stop.load(std::memory_order_relaxed)) {
+                    release(b);
+                    return;
+                }
+
+                if (ec) {
+                    release(b);
+                    failures.push_back({i, ec});
+                    break;
+                }
+
+                auto chars = have / sizeof(char_type);
+                auto text = text_type{_m_buffers[b].get(), chars};
+                if (have < bytes) {
+                    if (chars) submit(b, chunk{stream_type{text}, i, start / sizeof(char_type)});
+                    else release(b);
+                    break;
+                }
+
+                file.prefetch(pos, bytes);
+                auto cut = text.rfind(separator);
+                cut = cut == text_type::npos ? chars : cut + 1;
+
+                auto next = acquire();
+                auto tail = have - cut * sizeof(char_type);
+                std::memcpy(_m_bytes(next), _m_bytes(b) + cut * sizeof(char_type), tail);
+                submit(b, chunk{stream_type{text.substr(0, cut)}, i, start / sizeof(char_type)});
+                start += cut * sizeof(char_type);
+                b = next;
+                have = tail;
+            }
+        }
+    }
+};
+
+using stream_pipeline = basic_stream_pipeline<char>;
+using wstream_pipeline = basic_stream_pipeline<wchar_t>;
+using u8stream_pipeline = basic_stream_pipeline<char8_t>;
+using u16stream_pipeline = basic_stream_pipeline<char16_t>;
+using u32stream_pipeline = basic_stream_pipeline<char32_t>;
+} // namespace streams
+
+#endif // STREAM_PIPELINE_HH
@@ -0,0 +1,174 @@
+#ifndef STREAM_STATS_HH
+#define STREAM_STATS_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+#ifndef LIBSTREAM_STATS
+#    define LIBSTREAM_STATS 0
+#endif
+
+// Hooks for profiler zones around instrumented operations, e.g. for ITT:
+//
+//     #define LIBSTREAM_STATS_ZONE_BEGIN(name) __itt_task_begin(domain, __itt_null, __itt_null, __itt_string_handle_create(name))
+//     #define LIBSTREAM_STATS_ZONE_END(name) __itt_task_end(domain)
+//
+// `name` is the name of the operation family, as a null-terminated string.
+// Zones never nest, so a thread-local variable is enough to hold any state
+// a profiler needs between the two, e.g. a Tracy zone context.
+#ifndef LIBSTREAM_STATS_ZONE_BEGIN
+#    define LIBSTREAM_STATS_ZONE_BEGIN(name)
+#endif
+
+#ifndef LIBSTREAM_STATS_ZONE_END
+#    define LIBSTREAM_STATS_ZONE_END(name)
+#endif
+
+/// \brief Counters for the scanning operations of \c basic_stream.
+///
+/// If \c LIBSTREAM_STATS is defined to 1, every call to an operation in one
+/// of the families below adds to counters for its family. The counters are
+/// thread-local, so this does not need any synchronisation, but the stats
+/// for each thread have to be collected on that thread.
+///
+/// Comparing the number of bytes examined by a family to the number of bytes
+/// it consumed shows how much text is scanned repeatedly, e.g. by calling
+/// \c take_until_or_empty() on partial input over and over again.
+///
+/// Only the outermost operation is counted if they call each other, e.g.
+/// \c trim() counts as one call, not three. Operations evaluated at compile
+/// time are never counted. All counters stay at zero if \c LIBSTREAM_STATS
+/// is not enabled.
+namespace streams::stats {
+/// A family of operations that share counters.
+enum struct family : std::uint8_t {
+    take_until,     ///< \c take_until(), \c take_back_until(), and their variants.
+    take_while,     ///< \c take_while(), \c take_back_while(), and their variants.
+    trim,           ///< \c trim(), \c trim_front(), and \c trim_back().
+    take_delimited, ///< \c take_delimited() and \c take_delimited_any().
+};
+
+/// The number of operation families.
+inline constexpr std::size_t family_count = 4;
+
+/// The counters for a family of operations.
+struct counters {
+    /// The number of calls.
+    std::uint64_t calls = 0;
+
+    /// The number of bytes looked at, up to and including the character
+    /// at which a search stopped; a search that finds nothing examines all
+    /// of the text.
+    std::uint64_t examined = 0;
+
+    /// The number of bytes removed from the stream.
+    std::uint64_t consumed = 0;
+
+    [[nodiscard]] friend constexpr auto
+    operator==(const counters&, const counters&) noexcept -> bool = default;
+};
+
+/// \return The name of a family, e.g. \c "take_until".
+[[nodiscard]] constexpr auto name(family f) noexcept -> std::string_view {
+    constexpr std::array<std::string_view, family_count> names{"take_until", "take_while", "trim", "take_delimited"};
+    return names[std::size_t(f)];
+}
+} // namespace streams::stats
+
+namespace streams::detail {
+struct stats_state {
+    std::array<stats::counters, stats::family_count> counters{};
+
+    // The number of bytes examined by the operation in progress, if any;
+    // this is only tracked while `active` is set.
+    std::uint64_t examined = 0;
+    bool active = false;
+};
+
+inline constinit thread_local stats_state stats_local{};
+
+// Record that the operation in progress looked at `n` bytes.
+constexpr void stats_examine(std::size_t n) noexcept {
+    if not consteval {
+        if (stats_local.active) stats_local.examined += n;
+    }
+}
+
+// Counts an operation on a stream from its construction to its destruction,
+// unless there is one in progress already.
+template <typename CharType>
+class stats_scope {
+    const std::basic_string_view<CharType>& _m_text;
+    std::size_t _m_size;
+    stats::family _m_family;
+    bool _m_outer = false;
+
+public:
+    constexpr stats_scope(stats::family f, const std::basic_string_view<CharType>& text) noexcept
+        : _m_text(text), _m_size(text.size()), _m_family(f) {
+        if not consteval {
+            if (stats_local.active) return;
+            stats_local.active = true;
+            stats_local.examined = 0;
+            _m_outer = true;
+            LIBSTREAM_STATS_ZONE_BEGIN(stats::name(f).data());
+        }
+    }
+
+    stats_scope(const stats_scope&) = delete;
+    auto operator=(const stats_scope&) -> stats_scope& = delete;
+
+    constexpr ~stats_scope() {
+        if not consteval {
+            if (not _m_outer) return;
+            auto consumed = std::uint64_t(_m_size - _m_text.size()) * sizeof(CharType);
+            auto& c = stats_local.counters[std::size_t(_m_family)];
+            ++c.calls;
+            c.examined += std::max(stats_local.examined, consumed);
+            c.consumed += consumed;
+            stats_local.active = false;
+            LIBSTREAM_STATS_ZONE_END(stats::name(_m_family).data());
+        }
+    }
+};
+} // namespace streams::detail
+
+namespace streams::stats {
+/// \return The counters for a family on the current thread.
+[[nodiscard]] inline auto get(family f) noexcept -> counters {
+    return detail::stats_local.counters[std::size_t(f)];
+}
+
+/// Reset all counters on the current thread to zero.
+inline void reset() noexcept {
+    detail::stats_local.counters = {};
+}
+
+/// \brief Print the counters for the current thread.
+///
+/// This prints one line per family, with the number of calls, the bytes
+/// examined and consumed, and the ratio of the two; a ratio well above 1
+/// means that text is being scanned more than once.
+inline void dump(std::FILE* out = stderr) noexcept {
+    std::fprintf(out, "%-16s %12s %16s %16s %8s\n", "family", "calls", "examined", "consumed", "ratio");
+    for (std::size_t i = 0; i < family_count; ++i) {
+        auto f = family(i);
+        auto c = get(f);
+        std::fprintf(
+            out,
+            "%-16s %12llu %16llu %16llu %8.2f\n",
+            name(f).data(),
+            static_cast<unsigned long long>(c.calls),
+            static_cast<unsigned long long>(c.examined),
+            static_cast<unsigned long long>(c.consumed),
+            c.consumed ? double(c.examined) / double(c.consumed) : 0.0
+        );
+    }
+}
+} // namespace streams::stats
+
+#endif // STREAM_STATS_HH
@@ -1,14 +1,28 @@
 #ifndef STREAM_STREAM_HH
 #define STREAM_STREAM_HH
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <format>
+#include <limits>
 #include <optional>
 #include <ranges>
 #include <source_location>
+#include <span>
 #include <string_view>
 #include <utility>
 
+#include "detail/simd.hh"
+#include "stats.hh"
+
 namespace streams {
 
 #ifndef LIBSTREAM_ASSERTIONS
@@ -18,12 +32,22 @@ namespace streams {
 #if defined(_GLIBCXX_DEBUG) || defined(_LIBCPP_DEBUG) || LIBSTREAM_ASSERTIONS
 #    undef LIBSTREAM_ASSERTIONS
 #    define LIBSTREAM_ASSERTIONS   1
-#    define LIBSTREAM_ASSERT(cond) (cond ? (void) 0 : _m_assert_fail(#cond))
+#    define LIBSTREAM_ASSERT(cond, ...) ((cond) ? (void) 0 : ::streams::detail::assert_fail(#cond __VA_OPT__(, __VA_ARGS__)))
 #else
 #    define LIBSTREAM_ASSERTIONS  0
 #    define LIBSTREAM_ASSERT(...) void()
 #endif
 
+// Count calls to an operation in a `stats::family`, and the characters it
+// looks at; see stats.hh.
+#if LIBSTREAM_STATS
+#    define LIBSTREAM_STATS_SCOPE(op) ::streams::detail::stats_scope<char_type> _m_stats{::streams::stats::family::op, _m_text}
+#    define LIBSTREAM_STATS_EXAMINE(n) ::streams::detail::stats_examine((n) * sizeof(char_type))
+#else
+#    define LIBSTREAM_STATS_SCOPE(op) void()
+#    define LIBSTREAM_STATS_EXAMINE(n) void()
+#endif
+
 #define LIBSTREAM_STRING_LITERAL(lit) [] {                  \
     if constexpr (std::is_same_v<char_type, char>)          \
         return lit;                                         \
@@ -39,6 +63,877 @@ namespace streams {
         static_assert(false, "Unsupported character type"); \
 }()
 
+template <typename CharType>
+class basic_stream;
+
+template <typename CharType>
+class basic_lines_view;
+
+template <typename CharType>
+class basic_rlines_view;
+
+template <typename CharType>
+class basic_chunks_view;
+
+template <typename CharType>
+class basic_kv_view;
+
+template <typename CharType>
+class basic_symbol_table;
+
+template <typename CharType>
+class basic_multi_searcher;
+
+/// The id of a string in a \c basic_symbol_table.
+using symbol_id = std::uint32_t;
+
+namespace detail {
+#if LIBSTREAM_ASSERTIONS
+[[noreturn]] inline void assert_fail(
+    std::string_view cond,
+    std::string_view msg = "",
+    std::source_location where = std::source_location::current()
+) noexcept {
+    std::puts(std::format(
+        "{}:{}:{}",
+        where.file_name(),
+        where.line(),
+        where.column()
+    ).data());
+    if (msg.empty()) std::puts(std::format("libstream: Assertion failed: {}", cond).data());
+    else std::puts(std::format("libstream: Assertion failed: {}: {}", cond, msg).data());
+    std::abort();
+}
+#endif
+
+// Called when a character set that needed more ranges than it can hold is
+// used. This is deliberately not constexpr, so that doing so in a constant
+// expression does not compile.
+[[noreturn]] inline void char_set_overflow() noexcept {
+    std::fputs("libstream: A character set needs more than char_set::max_ranges ranges\n", stderr);
+    std::abort();
+}
+
+// Ranges of characters outside the range of a single byte; see `char_set`.
+//
+// To make complements exact, the table stores either the ranges that are in
+// the set or those that are not, whichever takes fewer; ties go to the former,
+// so equal sets always have the same representation. If neither fits, the
+// table is marked as overflowed instead, and holds nothing.
+template <typename CharType, std::size_t max_ranges>
+class range_table {
+    static constexpr CharType min = 256;
+    static constexpr CharType max = std::numeric_limits<CharType>::max();
+
+    struct range {
+        CharType first, last;
+    };
+
+    // A sorted list of disjoint ranges that is large enough for the result
+    // of any operation on two tables, before it is stored in one.
+    struct list {
+        range ranges[2 * max_ranges + 2]{};
+        std::size_t size = 0;
+
+        // Append a range that does not start before the last one, merging
+        // them if they overlap or touch.
+        constexpr void push(CharType first, CharType last) noexcept {
+            if (size != 0 and (ranges[size - 1].last == max or CharType(ranges[size - 1].last + 1) >= first))
+                ranges[size - 1].last = std::max(ranges[size - 1].last, last);
+            else ranges[size++] = {first, last};
+        }
+    };
+
+    range _m_ranges[max_ranges]{};
+    std::size_t _m_size = 0;
+    bool _m_inverted = false;
+    bool _m_overflow = false;
+
+public:
+    [[nodiscard]] constexpr auto
+    contains(CharType c) const noexcept -> bool {
+        for (std::size_t i = 0; i < _m_size and _m_ranges[i].first <= c; ++i)
+            if (c <= _m_ranges[i].last) return not _m_inverted;
+        return _m_inverted;
+    }
+
+    [[nodiscard]] constexpr auto
+    empty() const noexcept -> bool { return _m_size == 0 and not _m_inverted and not _m_overflow; }
+
+    // Check if the table holds exactly the characters that do not fit
+    // in a byte.
+    [[nodiscard]] constexpr auto
+    is_all_wide() const noexcept -> bool { return _m_size == 0 and _m_inverted; }
+
+    [[nodiscard]] constexpr auto
+    overflowed() const noexcept -> bool { return _m_overflow; }
+
+    // Insert the closed range [first, last], where `first >= 256`.
+    constexpr void insert(CharType first, CharType last) noexcept {
+        if (_m_overflow) return;
+        list r;
+        r.push(first, last);
+        _m_assign(_s_unite(_m_expand(), r));
+    }
+
+    constexpr void complement() noexcept {
+        if (not _m_overflow) _m_assign(_s_complement(_m_expand()));
+    }
+
+    constexpr void unite(const range_table& other) noexcept {
+        if (_m_overflow or other._m_overflow) return _m_set_overflow();
+        _m_assign(_s_unite(_m_expand(), other._m_expand()));
+    }
+
+    constexpr void intersect(const range_table& other) noexcept {
+        if (_m_overflow or other._m_overflow) return _m_set_overflow();
+        auto a = _m_expand();
+        auto b = other._m_expand();
+        list r;
+        for (std::size_t i = 0, j = 0; i < a.size and j < b.size;) {
+            auto first = std::max(a.ranges[i].first, b.ranges[j].first);
+            auto last = std::min(a.ranges[i].last, b.ranges[j].last);
+            if (first <= last) r.push(first, last);
+            if (a.ranges[i].last < b.ranges[j].last) ++i;
+            else ++j;
+        }
+        _m_assign(r);
+    }
+
+    [[nodiscard]] friend constexpr auto
+    operator==(const range_table& a, const range_table& b) noexcept -> bool {
+        if (a._m_size != b._m_size or a._m_inverted != b._m_inverted or a._m_overflow != b._m_overflow) return false;
+        for (std::size_t i = 0; i < a._m_size; ++i)
+            if (a._m_ranges[i].first != b._m_ranges[i].first or a._m_ranges[i].last != b._m_ranges[i].last)
+                return false;
+        return true;
+    }
+
+private:
+    // The ranges that are in the set.
+    [[nodiscard]] constexpr auto _m_expand() const noexcept -> list {
+        list l;
+        for (std::size_t i = 0; i < _m_size; ++i) l.push(_m_ranges[i].first, _m_ranges[i].last);
+        return _m_inverted ? _s_complement(l) : l;
+    }
+
+    // Store a list, or its complement if that is shorter.
+    constexpr void _m_assign(const list& l) noexcept {
+        auto k = l.size;
+        auto c = k + 1 - (k != 0 and l.ranges[0].first == min) - (k != 0 and l.ranges[k - 1].last == max);
+        if (k <= c and k <= max_ranges) return _m_store(l, false);
+        if (c <= max_ranges) return _m_store(_s_complement(l), true);
+        _m_set_overflow();
+    }
+
+    constexpr void _m_store(const list& l, bool inverted) noexcept {
+        for (std::size_t i = 0; i < l.size; ++i) _m_ranges[i] = l.ranges[i];
+        _m_size = l.size;
+        _m_inverted = inverted;
+        _m_overflow = false;
+    }
+
+    constexpr void _m_set_overflow() noexcept {
+        _m_size = 0;
+        _m_inverted = false;
+        _m_overflow = true;
+    }
+
+    [[nodiscard]] static constexpr auto _s_complement(const list& l) noexcept -> list {
+        list r;
+        CharType next = min;
+        for (std::size_t i = 0; i < l.size; ++i) {
+            if (l.ranges[i].first > next) r.push(next, CharType(l.ranges[i].first - 1));
+            if (l.ranges[i].last == max) return r;
+            next = CharType(l.ranges[i].last + 1);
+        }
+
+        r.push(next, max);
+        return r;
+    }
+
+    [[nodiscard]] static constexpr auto _s_unite(const list& a, const list& b) noexcept -> list {
+        list r;
+        for (std::size_t i = 0, j = 0; i < a.size or j < b.size;) {
+            auto take_a = j == b.size or (i < a.size and a.ranges[i].first < b.ranges[j].first);
+            auto& next = take_a ? a.ranges[i++] : b.ranges[j++];
+            r.push(next.first, next.last);
+        }
+        return r;
+    }
+};
+
+template <typename CharType>
+class range_table<CharType, 0> {
+public:
+    [[nodiscard]] constexpr auto contains(CharType) const noexcept -> bool { return false; }
+    [[nodiscard]] constexpr auto empty() const noexcept -> bool { return true; }
+    [[nodiscard]] constexpr auto is_all_wide() const noexcept -> bool { return false; }
+    [[nodiscard]] constexpr auto overflowed() const noexcept -> bool { return false; }
+    constexpr void insert(CharType, CharType) noexcept {}
+    constexpr void complement() noexcept {}
+    constexpr void unite(const range_table&) noexcept {}
+    constexpr void intersect(const range_table&) noexcept {}
+    [[nodiscard]] friend constexpr auto operator==(const range_table&, const range_table&) noexcept -> bool = default;
+};
+} // namespace detail
+
+/// \brief A precompiled set of characters.
+///
+/// This can be passed to \c take_until(), \c take_while(), \c trim(), and
+/// friends instead of a string of characters. A set is only built once, and
+/// testing whether a character is in it costs a single load and bit test, as
+/// opposed to a scan over the string; if all of its characters fit in a byte,
+/// it also lets the stream use vectorised kernels, whatever the character
+/// type.
+///
+/// Characters that fit in a single byte are stored in a 256-bit bitmap; for
+/// wider character types, all other characters are stored as a sorted table
+/// of up to \c max_ranges disjoint ranges, either of the characters in the set
+/// or of those that are not, so the complement of a set always fits if the set
+/// does. A set that would need more ranges than that, e.g. one built from more
+/// than \c max_ranges scattered wide characters, is marked as overflowed
+/// instead of losing some of them: \c overflowed() returns true, and using it
+/// to test or search for characters does not compile in a constant expression
+/// and aborts at runtime.
+template <typename CharType>
+class char_set {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using size_type = std::size_t;
+
+    /// The maximum number of disjoint ranges of characters that do
+    /// not fit in a single byte (or that are not in the set) that a
+    /// set can store.
+    static constexpr size_type max_ranges = sizeof(char_type) == 1 ? 0 : 16;
+
+private:
+    using unsigned_type = std::make_unsigned_t<char_type>;
+
+    detail::byte_set _m_bytes;
+    [[no_unique_address]] detail::range_table<unsigned_type, max_ranges> _m_ranges;
+
+public:
+    /// Construct an empty set.
+    constexpr char_set() = default;
+
+    /// Construct a set containing the given characters.
+    explicit constexpr char_set(text_type chars) noexcept {
+        for (auto c : chars) _m_insert(unsigned_type(c), unsigned_type(c));
+    }
+
+    /// \return A set containing all characters between \p first
+    ///         and \p last, inclusive.
+    [[nodiscard]] static constexpr auto
+    range(char_type first, char_type last) noexcept -> char_set {
+        char_set s;
+        if (unsigned_type(first) <= unsigned_type(last))
+            s._m_insert(unsigned_type(first), unsigned_type(last));
+        return s;
+    }
+
+    /// Check if this set contains a character.
+    [[nodiscard]] constexpr auto
+    contains(char_type c) const noexcept -> bool {
+        _m_check();
+        auto u = unsigned_type(c);
+        if (u < 256) return _m_bytes.contains(std::uint8_t(u));
+        return _m_ranges.contains(u);
+    }
+
+    /// Check if this set is empty.
+    [[nodiscard]] constexpr auto
+    empty() const noexcept -> bool {
+        _m_check();
+        return _m_ranges.empty() and _m_bytes == detail::byte_set{};
+    }
+
+    /// Check if this set needed more than \c max_ranges ranges, in which
+    /// case it must not be used.
+    [[nodiscard]] constexpr auto
+    overflowed() const noexcept -> bool { return _m_ranges.overflowed(); }
+
+    ///@{
+    /// \brief Search a string for characters in this set.
+    ///
+    /// The \c _not overloads look for a character that is not in the set
+    /// instead.
+    ///
+    /// \return The index of the first/last such character, or \c npos
+    ///         if there is none.
+    [[nodiscard]] constexpr auto
+    find_first(text_type text) const noexcept -> size_type { return _m_find_first<false>(text); }
+
+    /// \see find_first(text_type) const
+    [[nodiscard]] constexpr auto
+    find_first_not(text_type text) const noexcept -> size_type { return _m_find_first<true>(text); }
+
+    /// \see find_first(text_type) const
+    [[nodiscard]] constexpr auto
+    find_last(text_type text) const noexcept -> size_type { return _m_find_last<false>(text); }
+
+    /// \see find_first(text_type) const
+    [[nodiscard]] constexpr auto
+    find_last_not(text_type text) const noexcept -> size_type { return _m_find_last<true>(text); }
+    ///@}
+
+    /// \brief Classify a string against this set, 64 characters at a time.
+    ///
+    /// This sets bit \c i%64 of \c out[i/64] iff \c text[i] is in the set,
+    /// for as many characters as \p out has room for; bits in the last word
+    /// that are past the end of the text are cleared. The masks can then be
+    /// scanned with \c std::countr_zero() and friends, e.g. to find all
+    /// separators and quotes in a block at once.
+    ///
+    /// If all characters in the set fit in a byte, this uses the vectorised
+    /// kernels.
+    ///
+    /// \return The number of characters classified.
+    constexpr auto classify(text_type text, std::span<std::uint64_t> out) const noexcept -> size_type {
+        _m_check();
+        text = text.substr(0, std::min(text.size(), out.size() * 64));
+        if (_m_ranges.empty()) {
+            detail::classify(text, _m_bytes, out.data());
+        } else if (_m_ranges.is_all_wide()) {
+            detail::classify(text, _m_inverted_bytes(), out.data());
+            for (size_type w = 0; w * 64 < text.size(); ++w) {
+                out[w] = ~out[w];
+                if (auto rest = text.size() - w * 64; rest < 64) out[w] &= (std::uint64_t(1) << rest) - 1;
+            }
+        } else {
+            for (size_type w = 0; w * 64 < text.size(); ++w) out[w] = 0;
+            for (size_type i = 0; i < text.size(); ++i)
+                if (contains(text[i])) out[i / 64] |= std::uint64_t(1) << (i % 64);
+        }
+
+        return text.size();
+    }
+
+    /// \brief Call \p cb with the index of every character in \p text that
+    /// is in this set, in order, until it returns false.
+    ///
+    /// If all characters in the set fit in a byte, the text is classified a
+    /// block at a time using the vectorised kernels.
+    template <typename Callback>
+    constexpr void find_each(text_type text, Callback cb) const {
+        _m_check();
+        if (_m_ranges.empty()) return detail::find_each(text, _m_bytes, std::move(cb));
+        for (size_type i = 0; i < text.size(); ++i)
+            if (contains(text[i]) and not cb(i))
+                return;
+    }
+
+    /// \return The union of two sets.
+    [[nodiscard]] friend constexpr auto
+    operator|(char_set a, const char_set& b) noexcept -> char_set {
+        for (int i = 0; i < 16; ++i) {
+            a._m_bytes.lo[i] |= b._m_bytes.lo[i];
+            a._m_bytes.hi[i] |= b._m_bytes.hi[i];
+        }
+
+        a._m_ranges.unite(b._m_ranges);
+        return a;
+    }
+
+    /// \return The intersection of two sets.
+    [[nodiscard]] friend constexpr auto
+    operator&(char_set a, const char_set& b) noexcept -> char_set {
+        for (int i = 0; i < 16; ++i) {
+            a._m_bytes.lo[i] &= b._m_bytes.lo[i];
+            a._m_bytes.hi[i] &= b._m_bytes.hi[i];
+        }
+
+        a._m_ranges.intersect(b._m_ranges);
+        return a;
+    }
+
+    /// \return A set containing every character not in this set.
+    [[nodiscard]] constexpr auto
+    operator~() const noexcept -> char_set {
+        char_set s = *this;
+        s._m_bytes = _m_inverted_bytes();
+        s._m_ranges.complement();
+        return s;
+    }
+
+    /// Same as \c contains().
+    [[nodiscard]] constexpr auto
+    operator()(char_type c) const noexcept -> bool { return contains(c); }
+
+    [[nodiscard]] friend constexpr auto
+    operator==(const char_set&, const char_set&) noexcept -> bool = default;
+
+private:
+    // Only the byte set needs to be searched if there are no ranges. A set
+    // that contains every character that does not fit in a byte, e.g. the
+    // negation of an ASCII class, is searched as the negation of its byte
+    // set's complement instead.
+    template <bool _negate>
+    [[nodiscard]] constexpr auto
+    _m_find_first(text_type text) const noexcept -> size_type {
+        _m_check();
+        if (_m_ranges.empty()) return detail::find_first<_negate>(text, _m_bytes);
+        if (_m_ranges.is_all_wide()) return detail::find_first<not _negate>(text, _m_inverted_bytes());
+        for (size_type i = 0; i < text.size(); ++i)
+            if (contains(text[i]) != _negate) return i;
+        return text_type::npos;
+    }
+
+    template <bool _negate>
+    [[nodiscard]] constexpr auto
+    _m_find_last(text_type text) const noexcept -> size_type {
+        _m_check();
+        if (_m_ranges.empty()) return detail::find_last<_negate>(text, _m_bytes);
+        if (_m_ranges.is_all_wide()) return detail::find_last<not _negate>(text, _m_inverted_bytes());
+        for (size_type i = text.size(); i-- > 0;)
+            if (contains(text[i]) != _negate) return i;
+        return text_type::npos;
+    }
+
+    constexpr void _m_check() const noexcept {
+        if (_m_ranges.overflowed()) detail::char_set_overflow();
+    }
+
+    [[nodiscard]] constexpr auto _m_inverted_bytes() const noexcept -> detail::byte_set {
+        detail::byte_set b;
+        for (int i = 0; i < 16; ++i) {
+            b.lo[i] = std::uint8_t(~_m_bytes.lo[i]);
+            b.hi[i] = std::uint8_t(~_m_bytes.hi[i]);
+        }
+        return b;
+    }
+
+    constexpr void _m_insert(unsigned_type first, unsigned_type last) noexcept {
+        // For each low nibble, the matching high nibbles form a contiguous
+        // run of bits, so we can set them all at once.
+        if (first < 256) {
+            auto hi = unsigned(std::min<unsigned_type>(last, 255));
+            for (unsigned i = 0; i < 16; ++i) {
+                auto lo = unsigned(first) > i ? (unsigned(first) - i + 15) / 16 : 0;
+                if (hi < i or lo > (hi - i) / 16) continue;
+                auto bits = ((2u << ((hi - i) / 16)) - 1) & ~((1u << lo) - 1);
+                _m_bytes.lo[i] |= std::uint8_t(bits);
+                _m_bytes.hi[i] |= std::uint8_t(bits >> 8);
+            }
+        }
+
+        if constexpr (max_ranges != 0) {
+            if (last >= 256) _m_ranges.insert(std::max<unsigned_type>(first, 256), last);
+        }
+    }
+};
+
+namespace detail {
+// Get the value of a character as an unsigned code unit.
+template <typename CharType>
+[[nodiscard]] constexpr auto code_unit(CharType c) noexcept -> char32_t {
+    return char32_t(std::make_unsigned_t<CharType>(c));
+}
+
+template <typename CharType>
+inline constexpr char32_t max_code_unit = char32_t(std::numeric_limits<std::make_unsigned_t<CharType>>::max());
+} // namespace detail
+
+/// \brief Character class predicates.
+///
+/// These can be passed to \c take_while(), \c take_until(), and friends like
+/// any other predicate, but unlike arbitrary lambdas, the stream can convert
+/// them to a \c char_set and use the vectorised kernels to scan the text. They
+/// work with any character type and only ever match ASCII characters, unless
+/// constructed with \c range(), \c is(), or \c any_of() from wider characters.
+/// A predicate with more wide ranges than a \c char_set can hold is simply
+/// tested one character at a time instead.
+///
+/// Predicates can be combined with \c !, \c |, and \c &, e.g.
+///
+/// \code
+///     s.take_while(pred::alnum | pred::is('_'));
+///     s.take_until(!pred::space);
+/// \endcode
+namespace pred {
+/// Check if a type is a character class predicate.
+template <typename Pred>
+concept char_class = requires { requires std::remove_cvref_t<Pred>::is_char_class; };
+
+/// Matches all characters between \c first and \c last, inclusive.
+struct char_range {
+    static constexpr bool is_char_class = true;
+    char32_t first;
+    char32_t last;
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    operator()(CharType c) const noexcept -> bool {
+        return char32_t(detail::code_unit(c) - first) <= char32_t(last - first);
+    }
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    to_char_set() const noexcept -> char_set<CharType> {
+        if (first > detail::max_code_unit<CharType>) return {};
+        return char_set<CharType>::range(
+            CharType(first),
+            CharType(std::min(last, detail::max_code_unit<CharType>))
+        );
+    }
+};
+
+/// Matches any of a fixed list of characters.
+template <std::size_t N>
+struct char_list {
+    static constexpr bool is_char_class = true;
+    std::array<char32_t, N> chars;
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    operator()(CharType c) const noexcept -> bool {
+        return std::ranges::find(chars, detail::code_unit(c)) != chars.end();
+    }
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    to_char_set() const noexcept -> char_set<CharType> {
+        char_set<CharType> s;
+        for (auto c : chars)
+            if (c <= detail::max_code_unit<CharType>)
+                s = s | char_set<CharType>::range(CharType(c), CharType(c));
+        return s;
+    }
+};
+
+/// Matches every character that \c pred does not match.
+template <char_class Pred>
+struct negation {
+    static constexpr bool is_char_class = true;
+    Pred pred;
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    operator()(CharType c) const noexcept -> bool { return not pred(c); }
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    to_char_set() const noexcept -> char_set<CharType> {
+        return ~pred.template to_char_set<CharType>();
+    }
+};
+
+/// Matches every character that either \c lhs or \c rhs matches.
+template <char_class Lhs, char_class Rhs>
+struct disjunction {
+    static constexpr bool is_char_class = true;
+    Lhs lhs;
+    Rhs rhs;
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    operator()(CharType c) const noexcept -> bool { return lhs(c) or rhs(c); }
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    to_char_set() const noexcept -> char_set<CharType> {
+        return lhs.template to_char_set<CharType>() | rhs.template to_char_set<CharType>();
+    }
+};
+
+/// Matches every character that both \c lhs and \c rhs match.
+template <char_class Lhs, char_class Rhs>
+struct conjunction {
+    static constexpr bool is_char_class = true;
+    Lhs lhs;
+    Rhs rhs;
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    operator()(CharType c) const noexcept -> bool { return lhs(c) and rhs(c); }
+
+    template <typename CharType>
+    [[nodiscard]] constexpr auto
+    to_char_set() const noexcept -> char_set<CharType> {
+        return lhs.template to_char_set<CharType>() & rhs.template to_char_set<CharType>();
+    }
+};
+
+/// \return A predicate matching all characters between \p first
+///         and \p last, inclusive.
+template <typename CharType>
+[[nodiscard]] constexpr auto range(CharType first, CharType last) noexcept -> char_range {
+    return {detail::code_unit(first), detail::code_unit(last)};
+}
+
+/// \return A predicate matching only \p c.
+template <typename CharType>
+[[nodiscard]] constexpr auto is(CharType c) noexcept -> char_range {
+    return range(c, c);
+}
+
+/// \return A predicate matching any of the characters in a string literal.
+template <typename CharType, std::size_t N>
+[[nodiscard]] constexpr auto any_of(const CharType (&chars)[N]) noexcept -> char_list<N - 1> {
+    char_list<N - 1> list{};
+    for (std::size_t i = 0; i < N - 1; ++i) list.chars[i] = detail::code_unit(chars[i]);
+    return list;
+}
+
+template <char_class Pred>
+[[nodiscard]] constexpr auto operator!(Pred p) noexcept -> negation<Pred> { return {p}; }
+
+template <char_class Lhs, char_class Rhs>
+[[nodiscard]] constexpr auto operator|(Lhs lhs, Rhs rhs) noexcept -> disjunction<Lhs, Rhs> { return {lhs, rhs}; }
+
+template <char_class Lhs, char_class Rhs>
+[[nodiscard]] constexpr auto operator&(Lhs lhs, Rhs rhs) noexcept -> conjunction<Lhs, Rhs> { return {lhs, rhs}; }
+
+/// ASCII character classes; these match the same characters as the
+/// corresponding functions from \c <cctype> in the C locale.
+inline constexpr auto digit = range('0', '9');
+inline constexpr auto lower = range('a', 'z');
+inline constexpr auto upper = range('A', 'Z');
+inline constexpr auto alpha = lower | upper;
+inline constexpr auto alnum = alpha | digit;
+inline constexpr auto xdigit = digit | range('a', 'f') | range('A', 'F');
+inline constexpr auto blank = any_of(" \t");
+inline constexpr auto space = any_of(" \t\n\v\f\r");
+inline constexpr auto cntrl = range('\0', '\x1f') | is('\x7f');
+inline constexpr auto print = range(' ', '~');
+inline constexpr auto graph = range('!', '~');
+inline constexpr auto punct = range('!', '/') | range(':', '@') | range('[', '`') | range('{', '~');
+inline constexpr auto ascii = range('\0', '\x7f');
+} // namespace pred
+
+/// \brief A precompiled substring search.
+///
+/// This can be passed to \c take_until() and friends instead of a string
+/// to search for. All the work that does not depend on the text being
+/// searched is done once, when the searcher is constructed, so this is
+/// worth it if the same needle is searched for many times, e.g. a MIME
+/// boundary or the end of an HTTP header.
+///
+/// The algorithm used depends on the length of the needle:
+///
+///     - Single characters are found with \c char_traits::find(), i.e.
+///       usually \c memchr().
+///
+///     - Needles of up to \c max_short_size characters are found by looking
+///       for their first and last character at the right distance, using the
+///       vectorised kernels for single-byte character types, and with the
+///       Boyer-Moore-Horspool algorithm otherwise.
+///
+///     - Longer needles are found using the Two-Way algorithm, which takes
+///       linear time in the worst case.
+///
+/// Like streams, searchers do not own the needle they were constructed
+/// from, so it must outlive the searcher.
+template <typename CharType>
+class searcher {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using size_type = std::size_t;
+
+    /// The length of the longest needle that is not searched for using
+    /// the Two-Way algorithm.
+    static constexpr size_type max_short_size = 64;
+
+private:
+    using unsigned_type = std::make_unsigned_t<char_type>;
+    using traits_type = std::char_traits<char_type>;
+    using index_type = std::make_signed_t<size_type>;
+
+    enum class _engine : std::uint8_t {
+        empty,
+        single,
+        short_needle,
+        two_way,
+    };
+
+    text_type _m_needle;
+    _engine _m_engine = _engine::empty;
+
+    // Boyer-Moore-Horspool shift table; for wide characters, this is
+    // indexed by the low byte, which still yields safe shifts.
+    std::uint8_t _m_shift[256]{};
+
+    // Critical factorisation and period of the needle for Two-Way.
+    index_type _m_ell = 0;
+    size_type _m_period = 0;
+    bool _m_periodic = false;
+
+public:
+    /// Construct a searcher for the empty string.
+    constexpr searcher() = default;
+
+    /// Construct a searcher for \p needle.
+    explicit constexpr searcher(text_type needle) noexcept : _m_needle(needle) {
+        auto m = needle.size();
+        if (m == 0) return;
+        if (m == 1) {
+            _m_engine = _engine::single;
+            return;
+        }
+
+        if (m <= max_short_size) {
+            _m_engine = _engine::short_needle;
+            for (auto& s : _m_shift) s = std::uint8_t(m);
+            for (size_type i = 0; i + 1 < m; ++i) _m_shift[unsigned_type(needle[i]) & 0xFF] = std::uint8_t(m - 1 - i);
+            return;
+        }
+
+        _m_engine = _engine::two_way;
+        size_type p, q;
+        auto i = _s_max_suffix<false>(needle, p);
+        auto j = _s_max_suffix<true>(needle, q);
+        if (i > j) {
+            _m_ell = i;
+            _m_period = p;
+        } else {
+            _m_ell = j;
+            _m_period = q;
+        }
+
+        _m_periodic = traits_type::compare(needle.data(), needle.data() + _m_period, size_type(_m_ell + 1)) == 0;
+        if (not _m_periodic) _m_period = std::max(size_type(_m_ell + 1), m - size_type(_m_ell) - 1) + 1;
+    }
+
+    /// Search a string for the needle.
+    ///
+    /// \return The index of the first occurrence of the needle in \p text,
+    ///         or \c npos if there is none.
+    [[nodiscard]] constexpr auto
+    find(text_type text) const noexcept -> size_type {
+        switch (_m_engine) {
+            case _engine::empty: return 0;
+            case _engine::single: return text.find(_m_needle.front());
+            case _engine::short_needle: return _m_find_short(text);
+            case _engine::two_way: return _m_find_two_way(text);
+        }
+
+        return text_type::npos;
+    }
+
+    /// \return The needle this searcher looks for.
+    [[nodiscard]] constexpr auto
+    needle() const noexcept -> text_type { return _m_needle; }
+
+    /// \return The length of the needle.
+    [[nodiscard]] constexpr auto
+    size() const noexcept -> size_type { return _m_needle.size(); }
+
+private:
+    [[nodiscard]] constexpr auto
+    _m_find_short(text_type text) const noexcept -> size_type {
+        auto m = _m_needle.size();
+#if LIBSTREAM_SIMD_DISPATCH
+        if constexpr (sizeof(char_type) == 1) {
+            if not consteval {
+                if (auto f = detail::dispatch().find_substr) return f(
+                    reinterpret_cast<const std::uint8_t*>(text.data()),
+                    text.size(),
+                    reinterpret_cast<const std::uint8_t*>(_m_needle.data()),
+                    m
+                );
+            }
+        }
+#elif LIBSTREAM_SIMD_PAIR_KERNEL
+        if constexpr (sizeof(char_type) == 1) {
+            if not consteval {
+                return detail::find_substr_vec<detail::native_pair_kernel>(
+                    reinterpret_cast<const std::uint8_t*>(text.data()),
+                    text.size(),
+                    reinterpret_cast<const std::uint8_t*>(_m_needle.data()),
+                    m
+                );
+            }
+        }
+#endif
+
+        auto last = _m_needle.back();
+        for (size_type i = 0; i + m <= text.size(); i += _m_shift[unsigned_type(text[i + m - 1]) & 0xFF])
+            if (text[i + m - 1] == last and traits_type::compare(text.data() + i, _m_needle.data(), m - 1) == 0)
+                return i;
+
+        return text_type::npos;
+    }
+
+    // See Crochemore & Perrin, "Two-way string-matching", J. ACM 38(3), 1991.
+    [[nodiscard]] constexpr auto
+    _m_find_two_way(text_type text) const noexcept -> size_type {
+        auto x = _m_needle.data();
+        auto y = text.data();
+        auto m = index_type(_m_needle.size());
+        auto n = index_type(text.size());
+        auto period = index_type(_m_period);
+
+        if (_m_periodic) {
+            index_type memory = -1;
+            for (index_type j = 0; j <= n - m;) {
+                auto i = std::max(_m_ell, memory) + 1;
+                while (i < m and x[i] == y[i + j]) ++i;
+                if (i < m) {
+                    j += i - _m_ell;
+                    memory = -1;
+                    continue;
+                }
+
+                i = _m_ell;
+                while (i > memory and x[i] == y[i + j]) --i;
+                if (i <= memory) return size_type(j);
+                j += period;
+                memory = m - period - 1;
+            }
+        } else {
+            for (index_type j = 0; j <= n - m;) {
+                auto i = _m_ell + 1;
+                while (i < m and x[i] == y[i + j]) ++i;
+                if (i < m) {
+                    j += i - _m_ell;
+                    continue;
+                }
+
+                i = _m_ell;
+                while (i >= 0 and x[i] == y[i + j]) --i;
+                if (i < 0) return size_type(j);
+                j += period;
+            }
+        }
+
+        return text_type::npos;
+    }
+
+    // Compute the maximal suffix of `x` with respect to the ordering of
+    // the characters, or its reverse, and the period of that suffix.
+    template <bool _reverse>
+    [[nodiscard]] static constexpr auto
+    _s_max_suffix(text_type x, size_type& period) noexcept -> index_type {
+        auto m = index_type(x.size());
+        index_type ms = -1, j = 0, k = 1, p = 1;
+        while (j + k < m) {
+            auto a = unsigned_type(x[j + k]);
+            auto b = unsigned_type(x[ms + k]);
+            if (_reverse ? a > b : a < b) {
+                j += k;
+                k = 1;
+                p = j - ms;
+            } else if (a == b) {
+                if (k != p) {
+                    ++k;
+                } else {
+                    j += p;
+                    k = 1;
+                }
+            } else {
+                ms = j;
+                j = ms + 1;
+                k = p = 1;
+            }
+        }
+
+        period = size_type(p);
+        return ms;
+    }
+};
+
 /// \brief A stream of characters.
 ///
 /// This is a non-owning wrapper around a blob of text intended for simple
@@ -51,18 +946,47 @@ public:
     using text_type = std::basic_string_view<char_type>;
     using size_type = std::size_t;
     using string_type = std::basic_string<char_type>;
+    using char_set_type = char_set<char_type>;
+    using searcher_type = searcher<char_type>;
+    using symbol_table_type = basic_symbol_table<char_type>;
+    using multi_searcher_type = basic_multi_searcher<char_type>;
+
+    /// The result of \c take_until() with a \c multi_searcher_type.
+    struct multi_match {
+        /// The characters that were skipped over.
+        text_type text;
+
+        /// The index of the needle that was found, if any; the needle
+        /// itself is still at the start of the stream.
+        std::optional<size_type> needle;
+    };
+
+    /// A key and its value, as returned by \c take_kv().
+    struct kv_pair {
+        text_type key;
+        text_type value;
+    };
+
+    /// A saved state of a stream, as returned by \c checkpoint().
+    ///
+    /// This is just the text the stream referred to, so it is as cheap
+    /// to save and restore as the stream itself.
+    class checkpoint_type {
+        friend basic_stream;
+        text_type _m_text;
+
+        constexpr explicit checkpoint_type(text_type text) noexcept : _m_text(text) {}
+
+    public:
+        constexpr checkpoint_type() = default;
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const checkpoint_type&, const checkpoint_type&) noexcept -> bool = default;
+    };
 
 private:
     text_type _m_text;
 
-    static consteval auto _s_default_line_separator() -> text_type {
-#ifndef _WIN32
-        return LIBSTREAM_STRING_LITERAL("\n");
-#else
-        return LIBSTREAM_STRING_LITERAL("\r\n");
-#endif
-    }
-
 public:
     /// Construct an empty stream.
     constexpr basic_stream() = default;
@@ -96,6 +1020,56 @@ public:
         else return reinterpret_cast<const char*>(_m_text.data());
     }
 
+    /// Save the state of the stream, to go back to it later.
+    ///
+    /// This is for backtracking parsers that would otherwise copy the
+    /// stream and compare pointers to find out how much was consumed.
+    ///
+    /// \see rewind(), consumed_since(), try_parse()
+    [[nodiscard]] constexpr auto
+    checkpoint() const noexcept -> checkpoint_type { return checkpoint_type{_m_text}; }
+
+    /// Split the stream into chunks at separator boundaries.
+    ///
+    /// Returns a range that yields consecutive, non-overlapping parts of
+    /// the stream. Each chunk contains at least \p chunk_size characters
+    /// and ends just after an occurrence of \p separator, except for the
+    /// last chunk, which contains whatever is left. Concatenating all
+    /// chunks yields the original text. The stream is not modified.
+    ///
+    /// This is intended for splitting a large text into blocks of whole
+    /// records that can be processed independently.
+    ///
+    /// \see basic_chunks_view, parallel_lines()
+    [[nodiscard]] constexpr auto
+    chunks(size_type chunk_size, char_type separator = char_type('\n'))
+    const noexcept -> basic_chunks_view<char_type> {
+        return basic_chunks_view<char_type>{_m_text, chunk_size, separator};
+    }
+
+    /// \brief Classify the characters of the stream against a set.
+    ///
+    /// This is a building block for custom tokenisers: bit \c i%64 of
+    /// \c out[i/64] is set iff the \c i-th character of the stream is in
+    /// \p chars. The stream is not modified.
+    ///
+    /// \code
+    ///     std::array<std::uint64_t, 4> masks;
+    ///     auto n = s.classify(stream::char_set_type{",\"\n"}, masks);
+    ///     for (std::size_t w = 0; w * 64 < n; ++w)
+    ///         for (auto m = masks[w]; m; m &= m - 1)
+    ///             handle(w * 64 + std::countr_zero(m));
+    /// \endcode
+    ///
+    /// \return The number of characters classified, i.e. the size of the
+    ///         stream or \c 64*out.size(), whichever is smaller.
+    ///
+    /// \see char_set::classify()
+    constexpr auto
+    classify(const char_set_type& chars, std::span<std::uint64_t> out) const noexcept -> size_type {
+        return chars.classify(_m_text, out);
+    }
+
     /// Skip a character.
     ///
     /// If the first character of the stream is the given character,
@@ -110,35 +1084,211 @@ public:
         return true;
     }
 
+    /// \return The number of characters consumed from either end of the
+    ///         stream since \p cp was saved.
+    [[nodiscard]] constexpr auto
+    consumed_since(checkpoint_type cp) const noexcept -> size_type {
+        LIBSTREAM_ASSERT(cp._m_text.size() >= size(), "Checkpoint is not from this stream");
+        return cp._m_text.size() - size();
+    }
+
     /// \return The data pointer.
     [[nodiscard]] constexpr auto
     data() const noexcept -> const char_type* {
         return _m_text.data();
     }
 
-    /// Discard N characters from the stream.
-    ///
-    /// If the stream contains fewer than N characters, this clears
-    /// the entire stream.
-    ///
-    /// To skip a certain character if it is present, use \c consume().
-    ///
-    /// \see consume(char_type)
-    ///
-    /// \param n The number of characters to drop.
-    /// \return This.
-    template <std::integral size = size_type>
-    requires (not std::same_as<std::remove_cvref_t<size>, char_type>)
+    /// Discard N characters from the stream.
+    ///
+    /// If the stream contains fewer than N characters, this clears
+    /// the entire stream.
+    ///
+    /// To skip a certain character if it is present, use \c consume().
+    ///
+    /// \see consume(char_type)
+    ///
+    /// \param n The number of characters to drop.
+    /// \return This.
+    template <std::integral size = size_type>
+    requires (not std::same_as<std::remove_cvref_t<size>, char_type>)
+    constexpr auto
+    drop(size n = 1) noexcept -> basic_stream& {
+        if constexpr (not std::unsigned_integral<size>) LIBSTREAM_ASSERT(
+            n >= 0,
+            "Cannot drop a negative number of characters"
+        );
+
+        (void) take(static_cast<size_type>(n));
+        return *this;
+    }
+
+    /// Discard the last N characters of the stream.
+    ///
+    /// If the stream contains fewer than N characters, this clears
+    /// the entire stream.
+    ///
+    /// \param n The number of characters to drop.
+    /// \return This.
+    template <std::integral size = size_type>
+    requires (not std::same_as<std::remove_cvref_t<size>, char_type>)
+    constexpr auto
+    drop_back(size n = 1) noexcept -> basic_stream& {
+        if constexpr (not std::unsigned_integral<size>) LIBSTREAM_ASSERT(
+            n >= 0,
+            "Cannot drop a negative number of characters"
+        );
+
+        (void) take_back(static_cast<size_type>(n));
+        return *this;
+    }
+
+    ///@{
+    /// \brief Drop characters from the end of the stream conditionally.
+    ///
+    /// Same as \c take_back_until() and friends, but discards the
+    /// characters instead and returns the stream.
+    ///
+    /// \see take_back_until(char_type)
+    ///
+    /// \param c A character, \c string_view, or unary predicate.
+    /// \return This
+    constexpr auto
+    drop_back_until(char_type c) noexcept -> basic_stream& {
+        (void) take_back_until(c);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_until(text_type s) noexcept -> basic_stream& {
+        (void) take_back_until(s);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_until(const char_set_type& chars) noexcept -> basic_stream& {
+        (void) take_back_until(chars);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
+    constexpr auto
+    drop_back_until(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> basic_stream& {
+        (void) take_back_until(std::move(c));
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_until_any(text_type chars) noexcept -> basic_stream& {
+        (void) take_back_until_any(chars);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_until_any_or_empty(text_type chars) noexcept -> basic_stream& {
+        (void) take_back_until_any_or_empty(chars);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_until_or_empty(char_type c) noexcept -> basic_stream& {
+        (void) take_back_until_or_empty(c);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_until_or_empty(text_type s) noexcept -> basic_stream& {
+        (void) take_back_until_or_empty(s);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_until_or_empty(const char_set_type& chars) noexcept -> basic_stream& {
+        (void) take_back_until_or_empty(chars);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
+    constexpr auto
+    drop_back_until_or_empty(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> basic_stream& {
+        (void) take_back_until_or_empty(std::move(c));
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_while(char_type c) noexcept -> basic_stream& {
+        (void) take_back_while(c);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_while(const char_set_type& chars) noexcept -> basic_stream& {
+        (void) take_back_while(chars);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
+    constexpr auto
+    drop_back_while(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> basic_stream& {
+        (void) take_back_while(std::move(c));
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_while_any(text_type chars) noexcept -> basic_stream& {
+        (void) take_back_while_any(chars);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_while_any_or_empty(text_type chars) noexcept -> basic_stream& {
+        (void) take_back_while_any_or_empty(chars);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
+    constexpr auto
+    drop_back_while_or_empty(char_type c) noexcept -> basic_stream& {
+        (void) take_back_while_or_empty(c);
+        return *this;
+    }
+
+    /// \see take_back_until(char_type)
     constexpr auto
-    drop(size n = 1) noexcept -> basic_stream& {
-        if constexpr (not std::unsigned_integral<size>) LIBSTREAM_ASSERT(
-            n >= 0,
-            "Cannot drop a negative number of characters"
-        );
+    drop_back_while_or_empty(const char_set_type& chars) noexcept -> basic_stream& {
+        (void) take_back_while_or_empty(chars);
+        return *this;
+    }
 
-        (void) take(static_cast<size_type>(n));
+    /// \see take_back_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
+    constexpr auto
+    drop_back_while_or_empty(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> basic_stream& {
+        (void) take_back_while_or_empty(std::move(c));
         return *this;
     }
+    ///@}
 
     ///@{
     /// \brief Drop characters from the stream conditionally.
@@ -163,6 +1313,27 @@ public:
         return *this;
     }
 
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_until(const char_set_type& chars) noexcept -> basic_stream& {
+        (void) take_until(chars);
+        return *this;
+    }
+
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_until(const searcher_type& s) noexcept -> basic_stream& {
+        (void) take_until(s);
+        return *this;
+    }
+
+    /// \see take_until(const multi_searcher_type&)
+    constexpr auto
+    drop_until(const multi_searcher_type& s) noexcept -> basic_stream& {
+        (void) take_until(s);
+        return *this;
+    }
+
     /// \see take_until(char_type) const
     template <typename UnaryPredicate>
     requires requires (UnaryPredicate c) { c(char_type{}); }
@@ -201,6 +1372,27 @@ public:
         return *this;
     }
 
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_until_or_empty(const char_set_type& chars) noexcept -> basic_stream& {
+        (void) take_until_or_empty(chars);
+        return *this;
+    }
+
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_until_or_empty(const searcher_type& s) noexcept -> basic_stream& {
+        (void) take_until_or_empty(s);
+        return *this;
+    }
+
+    /// \see take_until(const multi_searcher_type&)
+    constexpr auto
+    drop_until_or_empty(const multi_searcher_type& s) noexcept -> basic_stream& {
+        (void) take_until_or_empty(s);
+        return *this;
+    }
+
     /// \see take_until(char_type)
     template <typename UnaryPredicate>
     requires requires (UnaryPredicate c) { c(char_type{}); }
@@ -218,157 +1410,498 @@ public:
         return *this;
     }
 
-    /// \see take_until(char_type)
-    template <typename UnaryPredicate>
-    requires requires (UnaryPredicate c) { c(char_type{}); }
-    constexpr auto
-    drop_while(UnaryPredicate c)
-    noexcept(noexcept(c(char_type{}))) -> basic_stream& {
-        (void) take_while(std::move(c));
-        return *this;
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_while(const char_set_type& chars) noexcept -> basic_stream& {
+        (void) take_while(chars);
+        return *this;
+    }
+
+    /// \see take_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
+    constexpr auto
+    drop_while(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> basic_stream& {
+        (void) take_while(std::move(c));
+        return *this;
+    }
+
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_while_any(text_type chars) noexcept -> basic_stream& {
+        (void) take_while_any(chars);
+        return *this;
+    }
+
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_while_any_or_empty(text_type chars) noexcept -> basic_stream& {
+        (void) take_while_any_or_empty(chars);
+        return *this;
+    }
+
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_while_or_empty(char_type c) noexcept -> basic_stream& {
+        (void) take_while_or_empty(c);
+        return *this;
+    }
+
+    /// \see take_until(char_type)
+    constexpr auto
+    drop_while_or_empty(const char_set_type& chars) noexcept -> basic_stream& {
+        (void) take_while_or_empty(chars);
+        return *this;
+    }
+
+    /// \see take_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
+    constexpr auto
+    drop_while_or_empty(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> basic_stream& {
+        (void) take_while_or_empty(std::move(c));
+        return *this;
+    }
+    ///@}
+
+    /// Check if this stream is empty.
+    [[nodiscard]] constexpr auto
+    empty() const noexcept -> bool {
+        return _m_text.empty();
+    }
+
+    ///@{
+    /// \return True if the stream ends with the given character(s).
+    [[nodiscard]] constexpr auto
+    ends_with(char_type suffix) const noexcept -> bool {
+        return not _m_text.empty() and _m_text.back() == suffix;
+    }
+
+    /// \see ends_with(char_type) const
+    [[nodiscard]] constexpr auto
+    ends_with(text_type suffix) const noexcept -> bool {
+        return _m_text.ends_with(suffix);
+    }
+    ///@}
+
+    /// \return True if the stream ends with any of the given characters.
+    [[nodiscard]] constexpr auto
+    ends_with_any(std::initializer_list<char_type> suffix) const -> bool {
+        return not _m_text.empty() and
+               std::ranges::find(suffix, _m_text.back()) != suffix.end();
+    }
+
+    /// Extract a series of characters from a stream.
+    template <std::same_as<CharType> ...Chars>
+    [[nodiscard]] constexpr auto
+    extract(Chars& ...chars) noexcept -> bool {
+        if (not has(sizeof...(Chars))) return false;
+        auto extracted = take(sizeof...(Chars));
+        auto it = extracted.begin();
+        ((chars = *it++), ...);
+        return true;
+    }
+
+    /// \return The first character of the stream, or an empty optional
+    ///         if the stream is empty.
+    [[nodiscard]] constexpr auto
+    front() const noexcept -> char_opt {
+        if (empty()) return std::nullopt;
+        return _m_text.front();
+    }
+
+    /// \return Whether this stream contains at least N characters.
+    [[nodiscard]] constexpr auto
+    has(size_type n) const noexcept -> bool {
+        return size() >= n;
+    }
+
+    ///@{
+    /// Iterate over all key-value pairs in the stream.
+    ///
+    /// Returns a range that yields each pair that \c take_kv() would
+    /// return if called repeatedly; fields that do not contain \p sep
+    /// are skipped. The stream is not modified.
+    ///
+    /// \code
+    ///     for (auto [name, value] : headers.kv_pairs(':', "\r\n")) ...
+    /// \endcode
+    ///
+    /// \see basic_kv_view
+    [[nodiscard]] constexpr auto
+    kv_pairs(char_type sep, text_type terminators) const noexcept -> basic_kv_view<char_type> {
+        return basic_kv_view<char_type>{_m_text, sep, char_set_type{terminators}};
+    }
+
+    [[nodiscard]] constexpr auto
+    kv_pairs(char_type sep, const char_set_type& terminators) const noexcept -> basic_kv_view<char_type> {
+        return basic_kv_view<char_type>{_m_text, sep, terminators};
+    }
+    ///@}
+
+    ///@{
+    /// Iterate over all lines in the stream.
+    ///
+    /// Returns a range that yields each line in the stream; the line
+    /// separators are not included. The stream is not modified.
+    ///
+    /// By default, lines are separated by either \c \\n or \c \\r\\n;
+    /// a different separator can be passed explicitly, in which case
+    /// only that separator is recognised.
+    ///
+    /// \see basic_lines_view
+    [[nodiscard]] constexpr auto
+    lines() const noexcept -> basic_lines_view<char_type> {
+        return basic_lines_view<char_type>{_m_text};
+    }
+
+    [[nodiscard]] constexpr auto
+    lines(text_type line_separator) const noexcept -> basic_lines_view<char_type> {
+        return basic_lines_view<char_type>{_m_text, line_separator};
+    }
+    ///@}
+
+    /// Restore the state of the stream saved by \c checkpoint().
+    ///
+    /// \return This.
+    constexpr auto
+    rewind(checkpoint_type cp) noexcept -> basic_stream& {
+        _m_text = cp._m_text;
+        return *this;
+    }
+
+    ///@{
+    /// Iterate over all lines in the stream, from last to first.
+    ///
+    /// This yields the same lines as \c lines(), but in reverse order,
+    /// and only scans as much of the text as is needed to find them.
+    ///
+    /// \see basic_rlines_view
+    [[nodiscard]] constexpr auto
+    rlines() const noexcept -> basic_rlines_view<char_type> {
+        return basic_rlines_view<char_type>{_m_text};
+    }
+
+    [[nodiscard]] constexpr auto
+    rlines(text_type line_separator) const noexcept -> basic_rlines_view<char_type> {
+        return basic_rlines_view<char_type>{_m_text, line_separator};
+    }
+    ///@}
+
+    /// \return The size (= number of characters) of this stream.
+    [[nodiscard]] constexpr auto
+    size() const noexcept -> size_type {
+        return _m_text.size();
+    }
+
+    /// \return The number of bytes in this stream.
+    [[nodiscard]] constexpr auto
+    size_bytes() const noexcept -> size_type {
+        return size() * sizeof(char_type);
+    }
+
+    ///@{
+    /// \brief Split the stream into fields.
+    ///
+    /// This takes fields separated by \p sep (or by any character in
+    /// \p seps) from the stream and stores them in \p out, until either
+    /// \p out is full or the stream is empty. The separator after each
+    /// field is removed as well, so the stream is left at the start of
+    /// the next field.
+    ///
+    /// This is equivalent to calling \c take_until() and \c drop() in a
+    /// loop; in particular, a trailing separator does not produce an empty
+    /// field at the end. However, all separators are located in a single
+    /// vectorised pass rather than one search per field.
+    ///
+    /// \return The number of fields stored in \p out.
+    [[nodiscard]] constexpr auto
+    split_into(std::span<text_type> out, char_type sep) noexcept -> size_type {
+        return _m_split_into(out, [&](auto& cb) { detail::find_each(_m_text, sep, cb); });
+    }
+
+    /// \see split_into(std::span<text_type>, char_type)
+    [[nodiscard]] constexpr auto
+    split_into(std::span<text_type> out, const char_set_type& seps) noexcept -> size_type {
+        return _m_split_into(out, [&](auto& cb) { seps.find_each(_m_text, cb); });
+    }
+    ///@}
+
+    ///@{
+    /// \return True if the stream starts with the given character(s).
+    [[nodiscard]] constexpr auto
+    starts_with(char_type prefix) const noexcept -> bool {
+        return not _m_text.empty() and _m_text.front() == prefix;
+    }
+
+    /// \see starts_with(char_type) const
+    [[nodiscard]] constexpr auto
+    starts_with(text_type prefix) const noexcept -> bool {
+        return _m_text.starts_with(prefix);
+    }
+    ///@}
+
+    /// \return True if the stream starts with any of the given characters.
+    [[nodiscard]] constexpr auto
+    starts_with_any(text_type prefix) const -> bool {
+        return not _m_text.empty() and
+               std::ranges::find(prefix, _m_text.front()) != prefix.end();
+    }
+
+    /// Get N characters from the stream.
+    ///
+    /// If the stream contains fewer than N characters, this returns only
+    /// the characters that are available. The stream is advanced by N
+    /// characters.
+    ///
+    /// \param n The number of characters to get.
+    /// \return The characters.
+    [[nodiscard]] constexpr auto
+    take(size_type n = 1) noexcept -> text_type {
+        if (n > size()) n = size();
+        return _m_advance(n);
+    }
+
+    /// Get the last N characters of the stream.
+    ///
+    /// If the stream contains fewer than N characters, this returns only
+    /// the characters that are available. The characters are removed from
+    /// the end of the stream.
+    ///
+    /// \param n The number of characters to get.
+    /// \return The characters.
+    [[nodiscard]] constexpr auto
+    take_back(size_type n = 1) noexcept -> text_type {
+        if (n > size()) n = size();
+        return _m_advance_back(n);
     }
 
+    ///@{
+    /// \brief Get characters from the end of the stream conditionally.
+    ///
+    /// These mirror \c take_until() and friends, but scan backwards from
+    /// the end of the stream, so only the part of the text that is returned
+    /// is ever looked at. \c take_back_until() returns the characters after
+    /// the last match, and \c take_back_while() returns the longest suffix
+    /// of matching characters; the stream is shortened by as many characters
+    /// as are returned, so a matching character itself stays in the stream.
+    ///
+    /// \code
+    ///     stream s{"/var/log/app.log"};
+    ///     auto ext = s.take_back_until('.');     // "log"
+    ///     auto dir = s.drop_back().drop_back_until('/').text(); // "/var/log/"
+    /// \endcode
+    ///
+    /// If the condition is not \c true for any of the characters in the stream,
+    /// the entire text is returned. The \c _or_empty overloads, return an empty
+    /// string instead, and the stream is not modified at all.
+    ///
+    /// Single characters, character sets, and predicates from \c streams::pred
+    /// are searched with the vectorised kernels.
+    ///
     /// \see take_until(char_type)
-    constexpr auto
-    drop_while_any(text_type chars) noexcept -> basic_stream& {
-        (void) take_while_any(chars);
-        return *this;
+    ///
+    /// \param c A character, \c string_view, or unary predicate.
+    /// \return The matched characters.
+    [[nodiscard]] constexpr auto
+    take_back_until(char_type c) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_back_to<false>(detail::rfind_char(_m_text, c));
     }
 
-    /// \see take_until(char_type)
-    constexpr auto
-    drop_while_any_or_empty(text_type chars) noexcept -> basic_stream& {
-        (void) take_while_any_or_empty(chars);
-        return *this;
+    /// \see take_back_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_back_until(text_type s) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        auto pos = _m_text.rfind(s);
+        LIBSTREAM_STATS_EXAMINE(pos == text_type::npos ? size() : size() - pos);
+        if (pos == text_type::npos) return _m_advance_back(size());
+        return _m_advance_back(size() - pos - s.size());
     }
 
-    /// \see take_until(char_type)
-    constexpr auto
-    drop_while_or_empty(char_type c) noexcept -> basic_stream& {
-        (void) take_while_or_empty(c);
-        return *this;
+    /// \see take_back_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_back_until(const char_set_type& chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_back_to<false>(chars.find_last(_m_text));
     }
 
-    /// \see take_until(char_type)
+    /// \see take_back_until(char_type)
     template <typename UnaryPredicate>
     requires requires (UnaryPredicate c) { c(char_type{}); }
-    constexpr auto
-    drop_while_or_empty(UnaryPredicate c)
-    noexcept(noexcept(c(char_type{}))) -> basic_stream& {
-        (void) take_while_or_empty(std::move(c));
-        return *this;
+    [[nodiscard]] constexpr auto
+    take_back_until(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_back_to<false>(_m_rfind_if<false>(c));
     }
-    ///@}
 
-    /// Check if this stream is empty.
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    empty() const noexcept -> bool {
-        return _m_text.empty();
+    take_back_until_any(text_type chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_back_to<false>(_m_rfind_any<false>(chars));
     }
 
-    ///@{
-    /// \return True if the stream ends with the given character(s).
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    ends_with(char_type suffix) const noexcept -> bool {
-        return not _m_text.empty() and _m_text.back() == suffix;
+    take_back_until_any_or_empty(text_type chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_back_to<true>(_m_rfind_any<false>(chars));
     }
 
-    /// \see ends_with(char_type) const
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    ends_with(text_type suffix) const noexcept -> bool {
-        return _m_text.ends_with(suffix);
+    take_back_until_or_empty(char_type c) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_back_to<true>(detail::rfind_char(_m_text, c));
     }
-    ///@}
 
-    /// \return True if the stream ends with any of the given characters.
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    ends_with_any(std::initializer_list<char_type> suffix) const -> bool {
-        return not _m_text.empty() and
-               std::ranges::find(suffix, _m_text.back()) != suffix.end();
+    take_back_until_or_empty(text_type s) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        auto pos = _m_text.rfind(s);
+        LIBSTREAM_STATS_EXAMINE(pos == text_type::npos ? size() : size() - pos);
+        if (pos == text_type::npos) return {};
+        return _m_advance_back(size() - pos - s.size());
     }
 
-    /// Extract a series of characters from a stream.
-    template <std::same_as<CharType> ...Chars>
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    extract(Chars& ...chars) noexcept -> bool {
-        if (not has(sizeof...(Chars))) return false;
-        auto extracted = take(sizeof...(Chars));
-        auto it = extracted.begin();
-        ((chars = *it++), ...);
-        return true;
+    take_back_until_or_empty(const char_set_type& chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_back_to<true>(chars.find_last(_m_text));
     }
 
-    /// \return The first character of the stream, or an empty optional
-    ///         if the stream is empty.
+    /// \see take_back_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
     [[nodiscard]] constexpr auto
-    front() const noexcept -> char_opt {
-        if (empty()) return std::nullopt;
-        return _m_text.front();
+    take_back_until_or_empty(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_back_to<true>(_m_rfind_if<false>(c));
     }
 
-    /// \return Whether this stream contains at least N characters.
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    has(size_type n) const noexcept -> bool {
-        return size() >= n;
+    take_back_while(char_type c) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_take_back_while<false>(c);
     }
 
-    /// Iterate over all lines in the stream.
-    ///
-    /// Returns a range that yields each line in the stream; the line
-    /// separators are not included. The stream is not modified.
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    lines(text_type line_separator = _s_default_line_separator())
-    const noexcept {
-        return _m_text
-            | std::views::split(line_separator)
-            | std::views::transform([](auto r) { return basic_stream(text_type(r)); });
+    take_back_while(const char_set_type& chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_advance_back_to<false>(chars.find_last_not(_m_text));
     }
 
-    /// \return The size (= number of characters) of this stream.
+    /// \see take_back_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
     [[nodiscard]] constexpr auto
-    size() const noexcept -> size_type {
-        return _m_text.size();
+    take_back_while(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_advance_back_to<false>(_m_rfind_if<true>(c));
     }
 
-    /// \return The number of bytes in this stream.
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    size_bytes() const noexcept -> size_type {
-        return size() * sizeof(char_type);
+    take_back_while_any(text_type chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_advance_back_to<false>(_m_rfind_any<true>(chars));
     }
 
-    ///@{
-    /// \return True if the stream starts with the given character(s).
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    starts_with(char_type prefix) const noexcept -> bool {
-        return not _m_text.empty() and _m_text.front() == prefix;
+    take_back_while_any_or_empty(text_type chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_advance_back_to<true>(_m_rfind_any<true>(chars));
     }
 
-    /// \see starts_with(char_type) const
+    /// \see take_back_until(char_type)
     [[nodiscard]] constexpr auto
-    starts_with(text_type prefix) const noexcept -> bool {
-        return _m_text.starts_with(prefix);
+    take_back_while_or_empty(char_type c) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_take_back_while<true>(c);
+    }
+
+    /// \see take_back_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_back_while_or_empty(const char_set_type& chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_advance_back_to<true>(chars.find_last_not(_m_text));
+    }
+
+    /// \see take_back_until(char_type)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
+    [[nodiscard]] constexpr auto
+    take_back_while_or_empty(UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_advance_back_to<true>(_m_rfind_if<true>(c));
     }
     ///@}
 
-    /// \return True if the stream starts with any of the given characters.
+    /// Get a UTF-8 encoded code point from the stream.
+    ///
+    /// This is only available for single-byte character types.
+    ///
+    /// \return The decoded code point, or an empty optional if the stream
+    ///         is empty or does not start with a valid UTF-8 sequence; in
+    ///         that case, the stream is not advanced.
     [[nodiscard]] constexpr auto
-    starts_with_any(text_type prefix) const -> bool {
-        return not _m_text.empty() and
-               std::ranges::find(prefix, _m_text.front()) != prefix.end();
+    take_codepoint() noexcept -> std::optional<char32_t>
+    requires (sizeof(char_type) == 1)
+    {
+        char32_t c;
+        auto len = _m_decode_utf8(0, c);
+        if (len == 0) return std::nullopt;
+        _m_advance(len);
+        return c;
     }
 
-    /// Get N characters from the stream.
+    /// Get up to \p n UTF-8 encoded code points from the stream.
     ///
-    /// If the stream contains fewer than N characters, this returns only
-    /// the characters that are available. The stream is advanced by N
-    /// characters.
+    /// This stops early at the end of the stream or at the first invalid
+    /// UTF-8 sequence, which is left in the stream. Runs of ASCII text
+    /// are skipped in bulk. This is only available for single-byte
+    /// character types.
     ///
-    /// \param n The number of characters to get.
-    /// \return The characters.
+    /// \return The code units that make up the code points.
     [[nodiscard]] constexpr auto
-    take(size_type n = 1) noexcept -> text_type {
-        if (n > size()) n = size();
-        return _m_advance(n);
+    take_codepoints(size_type n) noexcept -> text_type
+    requires (sizeof(char_type) == 1)
+    {
+        size_type i = 0;
+        while (n != 0 and i < size()) {
+            if not consteval {
+                if (std::make_unsigned_t<char_type>(_m_text[i]) < 0x80) {
+                    auto ascii = detail::ascii_prefix(
+                        reinterpret_cast<const std::uint8_t*>(_m_text.data() + i),
+                        std::min(n, size() - i)
+                    );
+
+                    i += ascii;
+                    n -= ascii;
+                    continue;
+                }
+            }
+
+            char32_t c;
+            auto len = _m_decode_utf8(i, c);
+            if (len == 0) break;
+            i += len;
+            --n;
+        }
+
+        return _m_advance(i);
     }
 
     /// @{
@@ -394,45 +1927,282 @@ public:
     /// \return True if a delimited sequence was found.
     [[nodiscard]] constexpr auto
     take_delimited(text_type& string, text_type delimiter) noexcept -> bool {
+        LIBSTREAM_STATS_SCOPE(take_delimited);
         if (not starts_with(delimiter)) return false;
-        drop(delimiter.size());
         if (auto pos = _m_text.find(delimiter, delimiter.size()); pos != text_type::npos) {
-            string = _m_text.substr(0, pos);
+            string = _m_text.substr(delimiter.size(), pos - delimiter.size());
             _m_text.remove_prefix(pos + delimiter.size());
             return true;
         }
+
+        LIBSTREAM_STATS_EXAMINE(size());
         return false;
     }
 
     /// \see take_delimited(text_type&, text_type)
     [[nodiscard]] constexpr auto
     take_delimited(char_type c, text_type& string) noexcept -> bool {
+        LIBSTREAM_STATS_SCOPE(take_delimited);
         return take_delimited(string, text_type{&c, 1});
     }
 
     /// \see take_delimited(text_type&, text_type)
     [[nodiscard]] constexpr auto
     take_delimited_any(text_type& string, text_type delimiters) noexcept -> bool {
+        LIBSTREAM_STATS_SCOPE(take_delimited);
         if (not starts_with_any(delimiters)) return false;
-        char_type delim = take().front();
-        if (auto pos = _m_text.find(delim); pos != text_type::npos) {
-            string = _m_text.substr(0, pos);
+        if (auto pos = _m_text.find(_m_text.front(), 1); pos != text_type::npos) {
+            string = _m_text.substr(1, pos - 1);
             _m_text.remove_prefix(pos + 1);
             return true;
         }
+
+        LIBSTREAM_STATS_EXAMINE(size());
         return false;
     }
 
     /// @}
 
+    ///@{
+    /// \brief Parse a number from the start of the stream.
+    ///
+    /// These accept the same syntax as \c std::from_chars(): an optional
+    /// minus sign (only for \c take_int() and \c take_float()), followed by
+    /// one or more digits in the given base; there is no support for leading
+    /// whitespace, a leading plus sign, or prefixes such as \c 0x.
+    ///
+    /// If the stream starts with a number that is representable in \p T,
+    /// the number is removed from the stream and returned. Otherwise, the
+    /// stream is not advanced at all, and an empty optional is returned.
+    ///
+    /// Parsing never allocates and is independent of the current locale.
+    /// Integers are parsed directly for all character types (eight digits
+    /// at a time if possible); floating-point numbers are handed off to
+    /// \c std::from_chars(), after copying them into a small buffer on the
+    /// stack for character types other than \c char.
+    ///
+    /// \param fmt The syntax of the number, for \c take_float().
+    /// \param base The base to parse the number in, between 2 and 36, for
+    ///        \c take_int() and \c take_uint().
+    /// \return The number, if there is one.
+    template <std::floating_point T = double>
+    [[nodiscard]] auto
+    take_float(std::chars_format fmt = std::chars_format::general) noexcept -> std::optional<T> {
+        T value{};
+        if constexpr (std::same_as<char_type, char>) {
+            auto [ptr, ec] = std::from_chars(_m_text.data(), _m_text.data() + size(), value, fmt);
+            if (ec != std::errc{}) return std::nullopt;
+            _m_text.remove_prefix(size_type(ptr - _m_text.data()));
+        } else {
+            // Copy everything that could be part of a number into a buffer;
+            // from_chars() tells us where the number actually ends. Some
+            // implementations fall back to strtod(), so keep it terminated.
+            char buffer[129];
+            size_type n = 0;
+            while (n < size() and n < sizeof buffer - 1 and _s_is_number_char(_m_text[n]))
+                buffer[n] = char(_m_text[n]), ++n;
+            buffer[n] = '\0';
+
+            // If the buffer filled up, the number may have been cut short.
+            size_type len;
+            if (n < sizeof buffer - 1) {
+                auto [ptr, ec] = std::from_chars(buffer, buffer + n, value, fmt);
+                if (ec != std::errc{}) return std::nullopt;
+                len = size_type(ptr - buffer);
+            } else {
+                auto res = _m_parse_long_float<T>(fmt);
+                if (not res) return std::nullopt;
+                value = res->first;
+                len = res->second;
+            }
+
+            _m_text.remove_prefix(len);
+        }
+
+        return value;
+    }
+
+    /// \see take_float()
+    template <std::signed_integral T = int>
+    [[nodiscard]] constexpr auto
+    take_int(int base = 10) noexcept -> std::optional<T> {
+        using unsigned_type = std::make_unsigned_t<T>;
+        auto negative = starts_with(char_type('-'));
+        auto limit = unsigned_type(std::numeric_limits<T>::max()) + negative;
+        auto res = _m_parse_uint<unsigned_type>(negative, base, limit);
+        if (not res) return std::nullopt;
+        _m_text.remove_prefix(res->second);
+        if (not negative or res->first == 0) return T(res->first);
+        return T(-T(res->first - 1) - 1);
+    }
+
+    /// \see take_float()
+    template <std::unsigned_integral T = unsigned>
+    [[nodiscard]] constexpr auto
+    take_uint(int base = 10) noexcept -> std::optional<T> {
+        auto res = _m_parse_uint<T>(0, base, std::numeric_limits<T>::max());
+        if (not res) return std::nullopt;
+        _m_text.remove_prefix(res->second);
+        return res->first;
+    }
+    ///@}
+
+    ///@{
+    /// \brief Get a quoted string from the stream.
+    ///
+    /// If the stream starts with \p quote, this looks for the closing
+    /// quote, skipping any that are escaped, and removes everything up
+    /// to and including it from the stream. A quote is escaped if it
+    /// follows \p escape, e.g. \c "\\"" in JSON; if \p escape is the same
+    /// as \p quote, a doubled quote is an escaped quote instead, as in
+    /// CSV. Quotes and escapes are located a block at a time using the
+    /// vectorised kernels.
+    ///
+    /// The first overload returns the contents of the string as they are,
+    /// without the quotes.
+    ///
+    /// The second overload removes the escape characters; the character
+    /// after an escape is kept as is, so e.g. \c \\n becomes \c n.
+    /// If the string contains no escapes, this returns a view of the
+    /// stream, same as the first overload; only otherwise is the string
+    /// written to \p buffer.
+    ///
+    /// If the stream does not start with a quote, if there is no closing
+    /// quote, or if \p buffer is too small, the stream is not advanced.
+    ///
+    /// \return The string, or an empty optional if there was none.
+    [[nodiscard]] constexpr auto
+    take_quoted(
+        char_type quote = char_type('"'),
+        char_type escape = char_type('\\')
+    ) noexcept -> std::optional<text_type> {
+        bool escaped;
+        auto end = _m_find_closing_quote(quote, escape, escaped);
+        if (end == text_type::npos) return std::nullopt;
+        auto contents = _m_text.substr(1, end - 1);
+        _m_text.remove_prefix(end + 1);
+        return contents;
+    }
+
+    /// \see take_quoted(char_type, char_type)
+    [[nodiscard]] constexpr auto
+    take_quoted(
+        std::span<char_type> buffer,
+        char_type quote = char_type('"'),
+        char_type escape = char_type('\\')
+    ) noexcept -> std::optional<text_type> {
+        bool escaped;
+        auto end = _m_find_closing_quote(quote, escape, escaped);
+        if (end == text_type::npos) return std::nullopt;
+        auto contents = _m_text.substr(1, end - 1);
+        if (escaped) {
+            // Copy the runs between escapes; an escape is never the last
+            // character here since it would have escaped the closing quote.
+            size_type n = 0;
+            for (size_type i = 0; i < contents.size();) {
+                auto esc = std::min(contents.find(escape, i), contents.size());
+                auto run = esc - i + (esc != contents.size());
+                if (buffer.size() - n < run) return std::nullopt;
+                std::ranges::copy(contents.substr(i, esc - i), buffer.begin() + std::ptrdiff_t(n));
+                n += esc - i;
+                if (esc != contents.size()) buffer[n++] = contents[esc + 1];
+                i = esc + 2;
+            }
+
+            contents = text_type{buffer.data(), n};
+        }
+
+        _m_text.remove_prefix(end + 1);
+        return contents;
+    }
+    ///@}
+
+    ///@{
+    /// \brief Get a key-value pair from the stream.
+    ///
+    /// This parses a field of the form \c key \p sep \c value that ends
+    /// at any of the \p terminators or at the end of the stream, e.g. an
+    /// HTTP header with \c ':' and \c "\r\n", or a logfmt pair with \c '='
+    /// and \c " ". Whitespace and terminators before the field are skipped,
+    /// so empty fields are ignored. The key and value are trimmed of the
+    /// characters in \c whitespace(); only the first separator in a field
+    /// counts, so the value may contain further separators.
+    ///
+    /// The field is found with a single scan for the separator or any of
+    /// the terminators, which continues from the separator to the end of the
+    /// value; this uses the vectorised kernels if all of these characters
+    /// fit in a byte. Trimming only looks at the ends of the key and value.
+    ///
+    /// \p sep must not be one of the terminators.
+    ///
+    /// \return The key and value; the stream is advanced past the terminator
+    ///         of the field. If there are no more fields, or if the next one
+    ///         does not contain the separator, an empty optional, and the
+    ///         stream is not advanced.
+    [[nodiscard]] constexpr auto
+    take_kv(char_type sep, text_type terminators) noexcept -> std::optional<kv_pair> {
+        return take_kv(sep, char_set_type{terminators});
+    }
+
+    /// \see take_kv(char_type, text_type)
+    [[nodiscard]] constexpr auto
+    take_kv(char_type sep, const char_set_type& terminators) noexcept -> std::optional<kv_pair> {
+        auto start = std::min((terminators | whitespace_set()).find_first_not(_m_text), size());
+        auto field = _m_text.substr(start);
+        auto pos = (terminators | char_set_type{text_type{&sep, 1}}).find_first(field);
+        if (pos == text_type::npos or terminators.contains(field[pos])) return std::nullopt;
+
+        auto rest = field.substr(pos + 1);
+        auto end = std::min(terminators.find_first(rest), rest.size());
+        kv_pair kv{_s_trim(field.substr(0, pos)), _s_trim(rest.substr(0, end))};
+        _m_advance(start + pos + 1 + std::min(end + 1, rest.size()));
+        return kv;
+    }
+    ///@}
+
+    ///@{
+    /// \brief Look up a symbol at the start of the stream.
+    ///
+    /// This takes as many characters matching \p c as possible, as if
+    /// by \c take_while(), and looks them up in \p table. By default,
+    /// this takes identifier characters, i.e. ASCII letters, digits, and
+    /// underscores. To add symbols to the table as they are found, use
+    /// \c table.intern(s.take_while(c)) instead.
+    ///
+    /// This requires including \c <stream/symbol_table.hh>.
+    ///
+    /// \return The id of the symbol, or an empty optional if no characters
+    ///         match or if they are not in the table; in that case, the
+    ///         stream is not advanced.
+    [[nodiscard]] constexpr auto
+    take_symbol(const symbol_table_type& table) noexcept -> std::optional<symbol_id> {
+        return take_symbol(table, pred::alnum | pred::is(char_type('_')));
+    }
+
+    /// \see take_symbol(const symbol_table_type&)
+    template <typename UnaryPredicate>
+    requires requires (UnaryPredicate c) { c(char_type{}); }
+    [[nodiscard]] constexpr auto
+    take_symbol(const symbol_table_type& table, UnaryPredicate c)
+    noexcept(noexcept(c(char_type{}))) -> std::optional<symbol_id> {
+        auto len = std::min(_m_find_if<true>(c), size());
+        if (len == 0) return std::nullopt;
+        auto id = table.find(_m_text.substr(0, len));
+        if (id) _m_advance(len);
+        return id;
+    }
+    ///@}
+
     ///@{
     /// \brief Get characters from the stream conditionally.
     ///
     /// These take either
     ///
     ///     1. a single character,
-    ///     2. a string view, or
-    ///     3. a unary predicate.
+    ///     2. a string view,
+    ///     3. a character set, or
+    ///     4. a unary predicate, or
+    ///     5. a searcher (only for the \c _until overloads).
     ///
     /// The stream is advanced until (in the case of the \c _until overloads)
     /// or while (in the case of the \c _while overloads) we find a character
@@ -440,7 +2210,9 @@ public:
     ///     1. equal to the given character, or
     ///     2. equal to the given string (or any of the characters in the
     ///        string for the \c _any overloads), or
-    ///     3. for which the given predicate returns \c true.
+    ///     3. contained in the given set, or
+    ///     4. for which the given predicate returns \c true, or
+    ///     5. that starts an occurrence of the searcher's needle.
     ///
     /// If a matching character is found, all characters skipped over this way are
     /// returned as text.
@@ -449,17 +2221,36 @@ public:
     /// the entire text is returned. The \c _or_empty overloads, return an empty
     /// string instead, and the stream is not advanced at all.
     ///
+    /// Predicates from \c streams::pred are scanned as fast as a \c char_set;
+    /// any other predicate is called for one character at a time.
+    ///
     /// \param c A character, \c string_view, or unary predicate.
     /// \return The matched characters.
     [[nodiscard]] constexpr auto
     take_until(char_type c) noexcept -> text_type {
-        return _m_advance(std::min(_m_text.find(c), size()));
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<false>(detail::find_char(_m_text, c));
     }
 
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_until(text_type s) noexcept -> text_type {
-        return _m_advance(std::min(_m_text.find(s), size()));
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<false>(_m_text.find(s));
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_until(const char_set_type& chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<false>(chars.find_first(_m_text));
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_until(const searcher_type& s) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<false>(s.find(_m_text));
     }
 
     /// \see take_until(char_type) const
@@ -468,38 +2259,78 @@ public:
     [[nodiscard]] constexpr auto
     take_until(UnaryPredicate c)
     noexcept(noexcept(c(char_type{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
         return _m_take_until_cond<false>(std::move(c));
     }
 
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_until_any(text_type chars) noexcept -> text_type {
-        return _m_advance(std::min(_m_text.find_first_of(chars), size()));
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<false>(_m_find_any<false>(chars));
     }
 
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_until_any_or_empty(text_type chars) noexcept -> text_type {
-        auto pos = _m_text.find_first_of(chars);
-        if (pos == text_type::npos) return {};
-        return _m_advance(pos);
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<true>(_m_find_any<false>(chars));
     }
 
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_until_or_empty(char_type c) noexcept -> text_type {
-        auto pos = _m_text.find(c);
-        if (pos == text_type::npos) return {};
-        return _m_advance(pos);
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<true>(detail::find_char(_m_text, c));
     }
 
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_until_or_empty(text_type s) noexcept -> text_type {
-        auto pos = _m_text.find(s);
-        if (pos == text_type::npos) return {};
-        return _m_advance(pos);
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<true>(_m_text.find(s));
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_until_or_empty(const char_set_type& chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<true>(chars.find_first(_m_text));
+    }
+
+    /// \see take_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_until_or_empty(const searcher_type& s) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_advance_to<true>(s.find(_m_text));
+    }
+
+    ///@{
+    /// \brief Get characters until the first of several needles.
+    ///
+    /// This is like \c take_until() with a \c searcher, except that it
+    /// stops at whichever of the needles of \p s occurs first, and also
+    /// returns which needle that was.
+    ///
+    /// This requires including \c <stream/multi_searcher.hh>.
+    ///
+    /// \return The matched characters, and the index of the needle that
+    ///         was found; if none was found, the index is empty, and, as
+    ///         for the other \c _or_empty overloads, the text is empty
+    ///         and the stream is not advanced.
+    [[nodiscard]] constexpr auto
+    take_until(const multi_searcher_type& s) noexcept -> multi_match {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_take_until_multi<false>(s);
+    }
+
+    /// \see take_until(const multi_searcher_type&)
+    [[nodiscard]] constexpr auto
+    take_until_or_empty(const multi_searcher_type& s) noexcept -> multi_match {
+        LIBSTREAM_STATS_SCOPE(take_until);
+        return _m_take_until_multi<true>(s);
     }
+    ///@}
 
     /// \see take_until(char_type)
     template <typename UnaryPredicate>
@@ -507,48 +2338,113 @@ public:
     [[nodiscard]] constexpr auto
     take_until_or_empty(UnaryPredicate c)
     noexcept(noexcept(c(char_type{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_until);
         return _m_take_until_cond<true>(std::move(c));
     }
 
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_while(char_type c) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
         return _m_take_while<false>(c);
     }
 
+    /// \see take_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_while(const char_set_type& chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_advance_to<false>(chars.find_first_not(_m_text));
+    }
+
     /// \see take_until(char_type)
     template <typename UnaryPredicate>
     requires requires (UnaryPredicate c) { c(char_type{}); }
     [[nodiscard]] constexpr auto
     take_while(UnaryPredicate c)
     noexcept(noexcept(c(char_type{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
         return _m_take_while_cond<false>(std::move(c));
     }
 
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_while_any(text_type chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
         return _m_take_while_any<false>(chars);
     }
 
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_while_any_or_empty(text_type chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
         return _m_take_while_any<true>(chars);
     }
 
+    /// Get UTF-8 encoded code points while a predicate is true.
+    ///
+    /// This is like \c take_while(), except that the predicate is called
+    /// with decoded code points; it stops before the first code point for
+    /// which the predicate is false, and before any invalid UTF-8. If the
+    /// predicate is from \c streams::pred, runs of ASCII characters are
+    /// scanned with the vectorised kernels. This is only available for
+    /// single-byte character types.
+    ///
+    /// \param c A unary predicate that takes a \c char32_t.
+    /// \return The matched code units.
+    template <typename UnaryPredicate>
+    requires (sizeof(char_type) == 1) and requires (UnaryPredicate c) { c(char32_t{}); }
+    [[nodiscard]] constexpr auto
+    take_while_cp(UnaryPredicate c)
+    noexcept(noexcept(c(char32_t{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        size_type i = 0;
+        while (i < size()) {
+            auto u = std::make_unsigned_t<char_type>(_m_text[i]);
+            if (u < 0x80) {
+                if constexpr (pred::char_class<UnaryPredicate>) {
+                    auto ascii = c & pred::ascii;
+                    auto pos = basic_stream{_m_text.substr(i)}._m_find_if<true>(ascii);
+                    if (pos == text_type::npos) return _m_advance(size());
+                    i += pos;
+                    if (std::make_unsigned_t<char_type>(_m_text[i]) < 0x80) break;
+                    continue;
+                } else {
+                    if (not c(char32_t(u))) break;
+                    ++i;
+                    continue;
+                }
+            }
+
+            char32_t cp;
+            auto len = _m_decode_utf8(i, cp);
+            if (len == 0 or not c(cp)) break;
+            i += len;
+        }
+
+        return _m_advance(i);
+    }
+
     /// \see take_until(char_type)
     [[nodiscard]] constexpr auto
     take_while_or_empty(char_type c) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
         return _m_take_while<true>(c);
     }
 
+    /// \see take_until(char_type)
+    [[nodiscard]] constexpr auto
+    take_while_or_empty(const char_set_type& chars) noexcept -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
+        return _m_advance_to<true>(chars.find_first_not(_m_text));
+    }
+
     /// \see take_until(char_type)
     template <typename UnaryPredicate>
     requires requires (UnaryPredicate c) { c(char_type{}); }
     [[nodiscard]] constexpr auto
     take_while_or_empty(UnaryPredicate c)
     noexcept(noexcept(c(char_type{}))) -> text_type {
+        LIBSTREAM_STATS_SCOPE(take_while);
         return _m_take_while_cond<true>(std::move(c));
     }
     ///@}
@@ -563,39 +2459,135 @@ public:
     /// Characters are deleted so long as the last/first character
     /// matches any of the given characters.
     ///
-    /// \param cs The characters to remove.
+    /// \param chars The characters to remove; defaults to whitespace.
     /// \return A reference to this stream.
     constexpr auto
-    trim(text_type chars = whitespace()) noexcept -> basic_stream& {
-        return trim_front(chars).trim_back(chars);
+    trim(const char_set_type& chars = whitespace_set()) noexcept -> basic_stream& {
+        LIBSTREAM_STATS_SCOPE(trim);
+        return trim_front(chars).trim_back(chars);
+    }
+
+    /// \see trim(const char_set_type&)
+    constexpr auto
+    trim(text_type chars) noexcept -> basic_stream& {
+        LIBSTREAM_STATS_SCOPE(trim);
+        return trim_front(chars).trim_back(chars);
+    }
+
+    /// \see trim(const char_set_type&)
+    constexpr auto
+    trim_front(const char_set_type& chars = whitespace_set()) noexcept -> basic_stream& {
+        LIBSTREAM_STATS_SCOPE(trim);
+        return _m_trim_front_to(chars.find_first_not(_m_text));
+    }
+
+    /// \see trim(const char_set_type&)
+    constexpr auto
+    trim_front(text_type chars) noexcept -> basic_stream& {
+        LIBSTREAM_STATS_SCOPE(trim);
+        return _m_trim_front_to(_m_find_any<true>(chars));
     }
 
-    /// \see trim(text_type)
+    /// \see trim(const char_set_type&)
     constexpr auto
-    trim_front(text_type chars = whitespace()) noexcept -> basic_stream& {
-        auto pos = _m_text.find_first_not_of(chars);
-        if (pos == text_type::npos) _m_text = {};
-        else _m_text.remove_prefix(pos);
-        return *this;
+    trim_back(const char_set_type& chars = whitespace_set()) noexcept -> basic_stream& {
+        LIBSTREAM_STATS_SCOPE(trim);
+        return _m_trim_back_to(chars.find_last_not(_m_text));
     }
 
-    /// \see trim(text_type)
+    /// \see trim(const char_set_type&)
     constexpr auto
-    trim_back(text_type chars = whitespace()) noexcept -> basic_stream& {
-        auto pos = _m_text.find_last_not_of(chars);
-        if (pos == text_type::npos) _m_text = {};
-        else _m_text.remove_suffix(size() - pos - 1);
-        return *this;
+    trim_back(text_type chars) noexcept -> basic_stream& {
+        LIBSTREAM_STATS_SCOPE(trim);
+        return _m_trim_back_to(_m_rfind_any<true>(chars));
     }
 
     ///@}
 
+    /// \brief Run a parser, and undo whatever it consumed if it fails.
+    ///
+    /// \p parser is invoked with this stream, and its result is returned;
+    /// if that converts to \c false, e.g. an empty optional, or if it throws,
+    /// the stream is restored to the state it was in before.
+    ///
+    /// \code
+    ///     auto header = s.try_parse([](stream& s) -> std::optional<header> {
+    ///         auto name = s.take_until(':');
+    ///         if (not s.consume(':')) return std::nullopt;
+    ///         return header{name, s.trim().text()};
+    ///     });
+    /// \endcode
+    ///
+    /// \param parser A callable that takes a \c basic_stream&.
+    /// \return The result of \p parser.
+    template <typename Parser>
+    requires requires (Parser p, basic_stream& s) { static_cast<bool>(p(s)); }
+    constexpr auto
+    try_parse(Parser parser)
+    noexcept(noexcept(parser(*this))) {
+        // A guard rather than a catch block, so this works without
+        // exceptions too.
+        struct guard {
+            basic_stream& s;
+            text_type saved;
+            bool keep = false;
+            constexpr ~guard() { if (not keep) s._m_text = saved; }
+        } g{*this, _m_text};
+
+        auto r = parser(*this);
+        g.keep = static_cast<bool>(r);
+        return r;
+    }
+
+    /// Check if the stream contains valid UTF-8.
+    ///
+    /// This rejects overlong encodings, surrogates, code points above
+    /// U+10FFFF, and truncated sequences. The check is vectorised where
+    /// possible and skips ASCII text in bulk. This is only available for
+    /// single-byte character types.
+    [[nodiscard]] constexpr auto
+    validate_utf8() const noexcept -> bool
+    requires (sizeof(char_type) == 1)
+    {
+#if LIBSTREAM_SIMD_DISPATCH
+        if not consteval {
+            if (auto f = detail::dispatch().validate_utf8) return f(reinterpret_cast<const std::uint8_t*>(_m_text.data()), size());
+        }
+#elif LIBSTREAM_SIMD_UTF8
+        if not consteval {
+            return detail::validate_utf8_vec<detail::native_utf8_ops>(
+                reinterpret_cast<const std::uint8_t*>(_m_text.data()),
+                size()
+            );
+        }
+#endif
+
+        for (size_type i = 0; i < size();) {
+            if not consteval {
+                i += detail::ascii_prefix(reinterpret_cast<const std::uint8_t*>(_m_text.data() + i), size() - i);
+                if (i == size()) break;
+            }
+
+            char32_t c;
+            auto len = _m_decode_utf8(i, c);
+            if (len == 0) return false;
+            i += len;
+        }
+
+        return true;
+    }
+
     /// \return A string view containing ASCII whitespace characters
     /// as appropriate for the character type of this stream.
     [[nodiscard]] static consteval auto whitespace() -> text_type {
         return LIBSTREAM_STRING_LITERAL(" \t\n\r\v\f");
     }
 
+    /// \return The same characters as \c whitespace(), as a set.
+    [[nodiscard]] static consteval auto whitespace_set() -> char_set_type {
+        return char_set_type{whitespace()};
+    }
+
     /// Get a character from the stream.
     ///
     /// \param index The index of the character to get.
@@ -639,22 +2631,6 @@ public:
     /// @}
 
 private:
-#if LIBSTREAM_ASSERTIONS
-    auto _m_assert_fail(
-        std::string_view msg,
-        std::source_location where = std::source_location::current()
-    ) const noexcept {
-        std::puts(std::format(
-            "{}:{}:{}",
-            where.file_name(),
-            where.line(),
-            where.column()
-        ).data());
-        std::puts(std::format("libstream: Assertion failed: {}", msg).data());
-        std::abort();
-    }
-#endif
-
     // Return characters until position `n` (exclusive)
     // and remove them from the stream.
     constexpr auto _m_advance(size_type n) noexcept -> text_type {
@@ -664,22 +2640,454 @@ private:
         return txt;
     }
 
+    template <bool _or_empty>
+    constexpr auto _m_take_until_multi(const multi_searcher_type& s) noexcept -> multi_match {
+        auto m = s.find(_m_text);
+        auto text = _m_advance_to<_or_empty>(m.pos);
+        if (m.pos == text_type::npos) return {text, std::nullopt};
+        return {text, m.needle};
+    }
+
+    // Return characters up to `pos`, or everything (in the case of
+    // `_or_empty`, nothing) if `pos` is npos.
+    template <bool _or_empty>
+    constexpr auto _m_advance_to(size_type pos) noexcept -> text_type {
+        LIBSTREAM_STATS_EXAMINE(pos == text_type::npos ? size() : pos + 1);
+        if (pos == text_type::npos) {
+            if constexpr (_or_empty) return {};
+            else return _m_advance(size());
+        }
+
+        return _m_advance(pos);
+    }
+
+    // Remove whitespace from either end of `text`. If it is all whitespace, the
+    // result is empty but still points into `text`.
+    [[nodiscard]] static constexpr auto _s_trim(text_type text) noexcept -> text_type {
+        constexpr auto ws = whitespace_set();
+        auto first = ws.find_first_not(text);
+        if (first == text_type::npos) return text.substr(text.size());
+        return text.substr(first, ws.find_last_not(text) + 1 - first);
+    }
+
+    // Return the last `n` characters and remove them from the stream.
+    constexpr auto _m_advance_back(size_type n) noexcept -> text_type {
+        LIBSTREAM_ASSERT(n <= size());
+        auto txt = _m_text.substr(size() - n);
+        _m_text.remove_suffix(n);
+        return txt;
+    }
+
+    // Return the characters after `pos`, or everything (in the case of
+    // `_or_empty`, nothing) if `pos` is npos.
+    template <bool _or_empty>
+    constexpr auto _m_advance_back_to(size_type pos) noexcept -> text_type {
+        LIBSTREAM_STATS_EXAMINE(pos == text_type::npos ? size() : size() - pos);
+        if (pos == text_type::npos) {
+            if constexpr (_or_empty) return {};
+            else return _m_advance_back(size());
+        }
+
+        return _m_advance_back(size() - pos - 1);
+    }
+
+    // Find the closing quote of a quoted string at the start of the stream,
+    // and check whether the string contains any escapes.
+    //
+    // Most quoted strings are short, so the first few characters are
+    // checked one at a time before building a set for the kernels.
+    constexpr auto _m_find_closing_quote(char_type quote, char_type escape, bool& escaped) const noexcept -> size_type {
+        escaped = false;
+        if (not starts_with(quote)) return text_type::npos;
+        auto end = text_type::npos;
+        size_type skip = 1;
+        auto visit = [&](size_type i) {
+            if (i < skip) return true;
+            if (_m_text[i] == escape and (escape != quote or (i + 1 < size() and _m_text[i + 1] == quote))) {
+                escaped = true;
+                skip = i + 2;
+                return true;
+            }
+
+            end = i;
+            return false;
+        };
+
+        constexpr size_type short_size = 32;
+        auto prefix = std::min(size(), short_size);
+        for (size_type i = 1; i < prefix; ++i)
+            if ((_m_text[i] == quote or _m_text[i] == escape) and not visit(i))
+                return end;
+
+        if (prefix == size()) return end;
+        const char_type chars[2]{quote, escape};
+        const char_set_type special{text_type{chars, quote == escape ? size_type(1) : size_type(2)}};
+        special.find_each(_m_text.substr(prefix), [&](size_type i) { return visit(prefix + i); });
+        return end;
+    }
+
+    // Store fields ending at the separators reported by `find_each()` in `out`.
+    template <typename FindEach>
+    constexpr auto _m_split_into(std::span<text_type> out, FindEach find_each) noexcept -> size_type {
+        if (out.empty()) return 0;
+        size_type n = 0, start = 0;
+        auto field = [&](size_type sep) {
+            out[n++] = _m_text.substr(start, sep - start);
+            start = sep + 1;
+            return n != out.size();
+        };
+
+        find_each(field);
+        if (n != out.size() and start < size()) field(size());
+        _m_text.remove_prefix(std::min(start, size()));
+        return n;
+    }
+
+    // Decode the UTF-8 sequence at `i`. Returns its length, or 0 if there
+    // is no valid sequence there.
+    constexpr auto _m_decode_utf8(size_type i, char32_t& c) const noexcept -> size_type {
+        if (i >= size()) return 0;
+        auto b = std::uint8_t(_m_text[i]);
+        if (b < 0x80) {
+            c = b;
+            return 1;
+        }
+
+        size_type len;
+        char32_t min;
+        if ((b & 0xE0) == 0xC0) len = 2, min = 0x80, c = b & 0x1F;
+        else if ((b & 0xF0) == 0xE0) len = 3, min = 0x800, c = b & 0x0F;
+        else if ((b & 0xF8) == 0xF0) len = 4, min = 0x1'0000, c = b & 0x07;
+        else return 0;
+
+        if (size() - i < len) return 0;
+        for (size_type k = 1; k < len; ++k) {
+            auto cont = std::uint8_t(_m_text[i + k]);
+            if ((cont & 0xC0) != 0x80) return 0;
+            c = (c << 6) | (cont & 0x3F);
+        }
+
+        if (c < min or c > 0x10'FFFF or (c >= 0xD800 and c <= 0xDFFF)) return 0;
+        return len;
+    }
+
+    // Find the first character that is (or, if `_negate` is set,
+    // is not) any of `chars`. If all of them fit in a byte, we can
+    // use a byte set; otherwise, defer to the standard library. For
+    // wide characters, we try a short scalar scan first, for the same
+    // reason as in `_m_find_if()`.
+    template <bool _negate>
+    [[nodiscard]] constexpr auto
+    _m_find_any(text_type chars) const noexcept -> size_type {
+        if (not _negate and chars.size() == 1) return detail::find_char(_m_text, chars.front());
+        auto scan = [&](text_type text) {
+            if constexpr (_negate) return text.find_first_not_of(chars);
+            else return text.find_first_of(chars);
+        };
+
+        size_type prefix = 0;
+#if LIBSTREAM_SIMD_KERNEL or LIBSTREAM_SIMD_DISPATCH
+        if constexpr (sizeof(char_type) > 1) {
+            constexpr size_type width = detail::set_kernel_width<char_type>;
+            prefix = 2 * width;
+            if (size() <= prefix + width) return scan(_m_text);
+            if (auto pos = scan(_m_text.substr(0, prefix)); pos != text_type::npos) return pos;
+        }
+#endif
+
+        auto rest = _m_text.substr(prefix);
+        auto set = _s_make_byte_set(chars);
+        auto pos = set ? detail::find_first<_negate>(rest, *set) : scan(rest);
+        return pos == text_type::npos ? pos : prefix + pos;
+    }
+
+    // Same as `_m_find_any()`, but from the end of the stream.
+    template <bool _negate>
+    [[nodiscard]] constexpr auto
+    _m_rfind_any(text_type chars) const noexcept -> size_type {
+        if (not _negate and chars.size() == 1) return detail::rfind_char(_m_text, chars.front());
+        auto scan = [&](text_type text) {
+            if constexpr (_negate) return text.find_last_not_of(chars);
+            else return text.find_last_of(chars);
+        };
+
+        size_type suffix = 0;
+#if LIBSTREAM_SIMD_KERNEL or LIBSTREAM_SIMD_DISPATCH
+        if constexpr (sizeof(char_type) > 1) {
+            constexpr size_type width = detail::set_kernel_width<char_type>;
+            suffix = 2 * width;
+            if (size() <= suffix + width) return scan(_m_text);
+            auto tail = _m_text.substr(size() - suffix);
+            if (auto pos = scan(tail); pos != text_type::npos) return size() - suffix + pos;
+        }
+#endif
+
+        auto rest = _m_text.substr(0, size() - suffix);
+        auto set = _s_make_byte_set(chars);
+        return set ? detail::find_last<_negate>(rest, *set) : scan(rest);
+    }
+
+    constexpr auto _m_trim_front_to(size_type pos) noexcept -> basic_stream& {
+        LIBSTREAM_STATS_EXAMINE(pos == text_type::npos ? size() : pos + 1);
+        if (pos == text_type::npos) _m_text = {};
+        else _m_text.remove_prefix(pos);
+        return *this;
+    }
+
+    constexpr auto _m_trim_back_to(size_type pos) noexcept -> basic_stream& {
+        LIBSTREAM_STATS_EXAMINE(pos == text_type::npos ? size() : size() - pos);
+        if (pos == text_type::npos) _m_text = {};
+        else _m_text.remove_suffix(size() - pos - 1);
+        return *this;
+    }
+
+    // Build a byte set from `chars`, unless some of them do not fit in one.
+    static constexpr auto _s_make_byte_set(text_type chars) noexcept -> std::optional<detail::byte_set> {
+        if constexpr (sizeof(char_type) == 1) return detail::make_byte_set(chars);
+        else {
+            detail::byte_set set;
+            for (auto c : chars) {
+                if (std::make_unsigned_t<char_type>(c) >= 256) return std::nullopt;
+                set.insert(std::uint8_t(c));
+            }
+            return set;
+        }
+    }
+
+    // Find the first character that satisfies (or, if `_negate` is set,
+    // does not satisfy) a predicate. Character class predicates can be
+    // turned into a byte set, but building one costs about as much as
+    // testing a few dozen characters, so we only do that once a short
+    // scalar scan has failed; most tokens are shorter than that. Any
+    // other predicate, or one with too many wide ranges to fit in a set,
+    // is tested one character at a time.
+    template <bool _negate, typename UnaryPredicate>
+    [[nodiscard]] constexpr auto
+    _m_find_if(UnaryPredicate& c) const
+    noexcept(noexcept(c(char_type{}))) -> size_type {
+        auto data = _m_text.data();
+        auto scan = [&](size_type from, size_type to) {
+            for (auto i = from; i < to; ++i)
+                if (bool(c(data[i])) != _negate) return i;
+            return text_type::npos;
+        };
+
+#if LIBSTREAM_SIMD_KERNEL or LIBSTREAM_SIMD_DISPATCH
+        if constexpr (pred::char_class<UnaryPredicate>) {
+            constexpr size_type width = detail::set_kernel_width<char_type>;
+            constexpr size_type prefix = 2 * width;
+            if (size() > prefix + width) {
+                if (auto pos = scan(0, prefix); pos != text_type::npos) return pos;
+                auto set = c.template to_char_set<char_type>();
+                if (set.overflowed()) return scan(prefix, size());
+                auto rest = _m_text.substr(prefix);
+                auto pos = _negate ? set.find_first_not(rest) : set.find_first(rest);
+                return pos == text_type::npos ? pos : prefix + pos;
+            }
+        }
+#endif
+
+        return scan(0, size());
+    }
+
+    // Same as `_m_find_if()`, but from the end of the stream.
+    template <bool _negate, typename UnaryPredicate>
+    [[nodiscard]] constexpr auto
+    _m_rfind_if(UnaryPredicate& c) const
+    noexcept(noexcept(c(char_type{}))) -> size_type {
+        auto data = _m_text.data();
+        auto scan = [&](size_type from, size_type to) {
+            for (auto i = to; i-- > from;)
+                if (bool(c(data[i])) != _negate) return i;
+            return text_type::npos;
+        };
+
+#if LIBSTREAM_SIMD_KERNEL or LIBSTREAM_SIMD_DISPATCH
+        if constexpr (pred::char_class<UnaryPredicate>) {
+            constexpr size_type width = detail::set_kernel_width<char_type>;
+            constexpr size_type suffix = 2 * width;
+            if (size() > suffix + width) {
+                if (auto pos = scan(size() - suffix, size()); pos != text_type::npos) return pos;
+                auto set = c.template to_char_set<char_type>();
+                if (set.overflowed()) return scan(0, size() - suffix);
+                auto rest = _m_text.substr(0, size() - suffix);
+                return _negate ? set.find_last_not(rest) : set.find_last(rest);
+            }
+        }
+#endif
+
+        return scan(0, size());
+    }
+
     template <bool _or_empty, typename UnaryPredicate>
     requires requires (UnaryPredicate c) { c(char_type{}); }
     [[nodiscard]] constexpr auto
     _m_take_until_cond(UnaryPredicate c)
     noexcept(noexcept(c(char_type{}))) -> text_type {
-        std::size_t i = 1;
-        for (; i <= size(); ++i)
-            if (c(_m_text[i - 1]))
-                break;
+        return _m_advance_to<_or_empty>(_m_find_if<false>(c));
+    }
 
-        if (i > size()) {
-            if constexpr (_or_empty) return {};
-            else return _m_advance(size());
+    // Parse an unsigned number in `base`, starting at `offset`, that is at most
+    // `limit`. Returns the value and the offset just past it.
+    template <std::unsigned_integral U>
+    [[nodiscard]] constexpr auto
+    _m_parse_uint(size_type offset, int base, U limit) const noexcept -> std::optional<std::pair<U, size_type>> {
+        if (base < 2 or base > 36) return std::nullopt;
+        auto i = offset;
+        U value = 0;
+
+        // Parse 8 digits at a time if we can; this only works on little-endian
+        // systems, and the limit check below requires U to be large enough to
+        // hold 10^8.
+        if constexpr (sizeof(char_type) == 1 and sizeof(U) >= 4 and std::endian::native == std::endian::little) {
+            if not consteval {
+                if (base == 10) {
+                    while (i + 8 <= size()) {
+                        std::uint64_t chunk;
+                        std::memcpy(&chunk, _m_text.data() + i, 8);
+                        if (not _s_is_eight_digits(chunk)) break;
+                        auto v = U(_s_parse_eight_digits(chunk));
+                        if (value > (limit - v) / 100'000'000) return std::nullopt;
+                        value = value * 100'000'000 + v;
+                        i += 8;
+                    }
+                }
+            }
+        }
+
+        for (; i < size(); ++i) {
+            auto d = _s_digit_value(_m_text[i]);
+            if (d >= unsigned(base)) break;
+            if (value > (limit - d) / U(base)) return std::nullopt;
+            value = value * U(base) + d;
+        }
+
+        if (i == offset) return std::nullopt;
+        return std::pair{value, i};
+    }
+
+    // Parse a floating-point number that does not fit in the buffer used by
+    // `take_float()`, and return it and its length. Rather than copying all of
+    // it, we rewrite it as `0.<digits>e<exponent>`: whether a number rounds up
+    // or down only depends on how it compares against the values exactly
+    // halfway between two adjacent `T`s, none of which has more significant
+    // digits than `max_digits`, so any digits after those can be replaced by
+    // a single 1 if any of them are nonzero, and dropped if not.
+    template <std::floating_point T>
+    [[nodiscard]] auto
+    _m_parse_long_float(std::chars_format fmt) const noexcept -> std::optional<std::pair<T, size_type>> {
+        using limits = std::numeric_limits<T>;
+        constexpr auto max_digits = size_type(limits::digits - limits::min_exponent + 2);
+        auto hex = fmt == std::chars_format::hex;
+        auto base = hex ? 16u : 10u;
+        auto at = [&](size_type i) { return i < size() ? _m_text[i] : char_type{}; };
+        auto is = [&](size_type i, char c) { return at(i) == char_type(c) or at(i) == char_type(c - 'a' + 'A'); };
+
+        char out[max_digits + 32];
+        size_type n = 0;
+        size_type i = 0;
+        auto negative = at(0) == char_type('-');
+        if (negative) out[n++] = '-', ++i;
+        out[n++] = '0';
+        out[n++] = '.';
+
+        // The value is `0.<digits> * base^exp`.
+        std::int64_t exp = 0;
+        size_type kept = 0;
+        bool any_digits = false;
+        bool dropped_nonzero = false;
+        auto digit = [&](bool integral) {
+            auto c = char(at(i++));
+            any_digits = true;
+            if (kept == 0 and c == '0') exp -= not integral;
+            else if (kept < max_digits) out[n++] = c, ++kept, exp += integral;
+            else dropped_nonzero |= c != '0', exp += integral;
+        };
+
+        while (_s_digit_value(at(i)) < base) digit(true);
+        if (at(i) == char_type('.'))
+            for (++i; _s_digit_value(at(i)) < base;) digit(false);
+
+        // There are no digits in infinities and NaNs, which are short, unless
+        // a NaN has a long payload, which from_chars() would ignore anyway.
+        if (not any_digits) {
+            i = negative;
+            if (is(i, 'n') and is(i + 1, 'a') and is(i + 2, 'n') and at(i + 3) == char_type('(')) {
+                for (i += 4; _s_digit_value(at(i)) < 36 or at(i) == char_type('_');) ++i;
+                if (at(i) == char_type(')')) return std::pair{negative ? -limits::quiet_NaN() : limits::quiet_NaN(), i + 1};
+            }
+
+            char word[16];
+            n = 0;
+            while (n < sizeof word - 1 and _s_is_number_char(at(n))) word[n] = char(at(n)), ++n;
+            word[n] = '\0';
+            T value{};
+            auto [ptr, ec] = std::from_chars(word, word + n, value, fmt);
+            if (ec != std::errc{}) return std::nullopt;
+            return std::pair{value, size_type(ptr - word)};
+        }
+
+        // The exponent is optional, except in scientific notation, and not
+        // allowed in fixed notation. Beyond a certain size, it only matters
+        // whether the result overflows or underflows, and it still will.
+        std::int64_t e = 0;
+        bool has_exponent = false;
+        if (fmt != std::chars_format::fixed and is(i, hex ? 'p' : 'e')) {
+            auto j = i + 1;
+            auto negative_exponent = at(j) == char_type('-');
+            if (negative_exponent or at(j) == char_type('+')) ++j;
+            if (_s_digit_value(at(j)) < 10) {
+                for (; _s_digit_value(at(j)) < 10; ++j) e = std::min<std::int64_t>(e * 10 + _s_digit_value(at(j)), 1'000'000'000);
+                if (negative_exponent) e = -e;
+                has_exponent = true;
+                i = j;
+            }
         }
 
-        return _m_advance(i - 1);
+        if (fmt == std::chars_format::scientific and not has_exponent) return std::nullopt;
+        if (kept == 0) out[n++] = '0';
+        if (dropped_nonzero) out[n++] = '1';
+        out[n++] = hex ? 'p' : 'e';
+        n = size_type(std::to_chars(out + n, out + sizeof out - 1, hex ? 4 * exp + e : exp + e).ptr - out);
+        out[n] = '\0';
+
+        T value{};
+        auto [ptr, ec] = std::from_chars(out, out + n, value, hex ? fmt : std::chars_format::scientific);
+        if (ec != std::errc{}) return std::nullopt;
+        return std::pair{value, i};
+    }
+
+    // Get the value of a digit in any base up to 36, or 36 if the
+    // character is not a digit.
+    static constexpr auto _s_digit_value(char_type c) noexcept -> unsigned {
+        auto u = std::make_unsigned_t<char_type>(c);
+        if (u >= '0' and u <= '9') return unsigned(u - '0');
+        if (u >= 'a' and u <= 'z') return unsigned(u - 'a' + 10);
+        if (u >= 'A' and u <= 'Z') return unsigned(u - 'A' + 10);
+        return 36;
+    }
+
+    // Check if a character can be part of a floating-point number.
+    static constexpr auto _s_is_number_char(char_type c) noexcept -> bool {
+        return _s_digit_value(c) < 36 or text_type{LIBSTREAM_STRING_LITERAL("+-.()_")}.contains(c);
+    }
+
+    // Check if 8 characters loaded as a little-endian integer are all digits.
+    static constexpr auto _s_is_eight_digits(std::uint64_t chunk) noexcept -> bool {
+        return ((chunk & 0xF0F0'F0F0'F0F0'F0F0) | (((chunk + 0x0606'0606'0606'0606) & 0xF0F0'F0F0'F0F0'F0F0) >> 4)) == 0x3333'3333'3333'3333;
+    }
+
+    // Convert 8 digits to an integer with a few multiplications; the first
+    // step combines adjacent digits into 2-digit numbers, the second step
+    // combines those into 4-digit numbers and then into the final result.
+    static constexpr auto _s_parse_eight_digits(std::uint64_t chunk) noexcept -> std::uint32_t {
+        constexpr std::uint64_t mask = 0x0000'00FF'0000'00FF;
+        constexpr std::uint64_t mul1 = 100 + (1'000'000ull << 32);
+        constexpr std::uint64_t mul2 = 1 + (10'000ull << 32);
+        chunk -= 0x3030'3030'3030'3030;
+        chunk = (chunk * 10) + (chunk >> 8);
+        chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+        return std::uint32_t(chunk);
     }
 
     template <bool _or_empty>
@@ -690,12 +3098,17 @@ private:
         );
     }
 
+    template <bool _or_empty>
+    [[nodiscard]] constexpr auto
+    _m_take_back_while(char_type c) noexcept -> text_type {
+        auto eq = [c](char_type ch) { return ch == c; };
+        return _m_advance_back_to<_or_empty>(_m_rfind_if<true>(eq));
+    }
+
     template <bool _or_empty>
     [[nodiscard]] constexpr auto
     _m_take_while_any(text_type chars) noexcept -> text_type {
-        return _m_take_while_cond<_or_empty>([chars](char_type ch) {
-            return chars.find(ch) != text_type::npos;
-        });
+        return _m_advance_to<_or_empty>(_m_find_any<true>(chars));
     }
 
     template <bool _or_empty, typename UnaryPredicate>
@@ -703,18 +3116,451 @@ private:
     [[nodiscard]] constexpr auto
     _m_take_while_cond(UnaryPredicate c)
     noexcept(noexcept(c(char_type{}))) -> text_type {
-        std::size_t i = 1;
-        for (; i <= size(); ++i)
-            if (not c(_m_text[i - 1]))
-                break;
+        return _m_advance_to<_or_empty>(_m_find_if<true>(c));
+    }
+};
 
-        if (i > size()) {
-            if constexpr (_or_empty) return {};
-            else return _m_advance(size());
+/// \brief A range over the lines in a stream.
+///
+/// This has the same semantics as splitting the text with \c std::views::split,
+/// except that the default separator matches both \c \\n and \c \\r\\n. In
+/// particular, a trailing line separator yields a trailing empty line, and an
+/// empty text yields no lines at all.
+///
+/// Lines are found using \c memchr() or the vectorised kernels for wider
+/// character types, and the iterators only store the remaining text, so
+/// iterating is about as cheap as a loop over \c take_until(). Like
+/// streams, views and their iterators do not own the text they refer to.
+template <typename CharType>
+class basic_lines_view : public std::ranges::view_interface<basic_lines_view<CharType>> {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using stream_type = basic_stream<char_type>;
+
+    class iterator {
+        friend basic_lines_view;
+
+        text_type _m_line{};
+        text_type _m_rest{};
+        text_type _m_separator{};
+        bool _m_universal = true;
+        bool _m_has_rest = false;
+        bool _m_at_end = true;
+
+        constexpr iterator(text_type text, text_type separator, bool universal) noexcept
+            : _m_rest(text), _m_separator(separator), _m_universal(universal), _m_has_rest(true) {
+            if (text.empty()) return;
+            _m_at_end = false;
+            _m_next();
         }
 
-        return _m_advance(i - 1);
-    }
+    public:
+        using value_type = stream_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::forward_iterator_tag;
+
+        constexpr iterator() = default;
+
+        [[nodiscard]] constexpr auto
+        operator*() const noexcept -> stream_type { return stream_type{_m_line}; }
+
+        constexpr auto operator++() noexcept -> iterator& {
+            if (not _m_has_rest) _m_at_end = true;
+            else _m_next();
+            return *this;
+        }
+
+        constexpr auto operator++(int) noexcept -> iterator {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& a, const iterator& b) noexcept -> bool {
+            if (a._m_at_end or b._m_at_end) return a._m_at_end == b._m_at_end;
+            return a._m_line.data() == b._m_line.data();
+        }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& a, std::default_sentinel_t) noexcept -> bool {
+            return a._m_at_end;
+        }
+
+    private:
+        // Split the next line off the rest of the text.
+        constexpr void _m_next() noexcept {
+            using traits = typename text_type::traits_type;
+
+            // If the separator is empty, every character is a line.
+            if (not _m_universal and _m_separator.empty()) {
+                _m_line = _m_rest.substr(0, 1);
+                _m_rest.remove_prefix(_m_line.size());
+                _m_has_rest = not _m_rest.empty();
+                return;
+            }
+
+            auto pos = _m_universal or _m_separator.size() == 1
+                         ? _m_find(_m_universal ? char_type('\n') : _m_separator.front())
+                         : _m_rest.find(_m_separator);
+
+            if (pos == text_type::npos) {
+                _m_line = _m_rest;
+                _m_rest = {};
+                _m_has_rest = false;
+                return;
+            }
+
+            auto len = _m_universal ? 1 : _m_separator.size();
+            auto end = pos;
+            if (_m_universal and pos != 0 and traits::eq(_m_rest[pos - 1], char_type('\r'))) --end;
+            _m_line = _m_rest.substr(0, end);
+            _m_rest.remove_prefix(pos + len);
+        }
+
+        [[nodiscard]] constexpr auto
+        _m_find(char_type c) const noexcept -> std::size_t {
+            return detail::find_char(_m_rest, c);
+        }
+    };
+
+private:
+    text_type _m_text{};
+    text_type _m_separator{};
+    bool _m_universal = true;
+
+public:
+    /// Construct an empty view.
+    constexpr basic_lines_view() = default;
+
+    /// Iterate over lines separated by \c \\n or \c \\r\\n.
+    explicit constexpr basic_lines_view(text_type text) noexcept
+        : _m_text(text) {}
+
+    /// Iterate over lines separated by \p separator.
+    constexpr basic_lines_view(text_type text, text_type separator) noexcept
+        : _m_text(text), _m_separator(separator), _m_universal(false) {}
+
+    [[nodiscard]] constexpr auto
+    begin() const noexcept -> iterator { return iterator{_m_text, _m_separator, _m_universal}; }
+
+    [[nodiscard]] constexpr auto
+    end() const noexcept -> std::default_sentinel_t { return std::default_sentinel; }
+};
+
+/// \brief A range over the lines in a stream, from last to first.
+///
+/// This yields the same lines as \c basic_lines_view, in reverse order, so
+/// a trailing line separator still yields an empty line first. Separators
+/// are found by scanning backwards from the end of the text, so reading the
+/// last few lines of a large text does not touch the rest of it.
+///
+/// \code
+///     // Print the last 10 lines of a log.
+///     for (auto line : s.rlines() | std::views::drop(1) | std::views::take(10)) ...
+/// \endcode
+///
+/// \see basic_stream::rlines()
+template <typename CharType>
+class basic_rlines_view : public std::ranges::view_interface<basic_rlines_view<CharType>> {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using stream_type = basic_stream<char_type>;
+
+    class iterator {
+        friend basic_rlines_view;
+
+        text_type _m_line{};
+        text_type _m_rest{};
+        text_type _m_separator{};
+        bool _m_universal = true;
+        bool _m_has_rest = false;
+        bool _m_at_end = true;
+
+        constexpr iterator(text_type text, text_type separator, bool universal) noexcept
+            : _m_rest(text), _m_separator(separator), _m_universal(universal), _m_has_rest(true) {
+            if (text.empty()) return;
+            _m_at_end = false;
+            _m_next();
+        }
+
+    public:
+        using value_type = stream_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::forward_iterator_tag;
+
+        constexpr iterator() = default;
+
+        [[nodiscard]] constexpr auto
+        operator*() const noexcept -> stream_type { return stream_type{_m_line}; }
+
+        constexpr auto operator++() noexcept -> iterator& {
+            if (not _m_has_rest) _m_at_end = true;
+            else _m_next();
+            return *this;
+        }
+
+        constexpr auto operator++(int) noexcept -> iterator {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& a, const iterator& b) noexcept -> bool {
+            if (a._m_at_end or b._m_at_end) return a._m_at_end == b._m_at_end;
+            return a._m_line.data() == b._m_line.data();
+        }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& a, std::default_sentinel_t) noexcept -> bool {
+            return a._m_at_end;
+        }
+
+    private:
+        // Split the last line off the rest of the text.
+        constexpr void _m_next() noexcept {
+            using traits = typename text_type::traits_type;
+
+            // If the separator is empty, every character is a line.
+            if (not _m_universal and _m_separator.empty()) {
+                _m_line = _m_rest.substr(_m_rest.size() - 1);
+                _m_rest.remove_suffix(1);
+                _m_has_rest = not _m_rest.empty();
+                return;
+            }
+
+            auto pos = _m_universal or _m_separator.size() == 1
+                         ? detail::rfind_char(_m_rest, _m_universal ? char_type('\n') : _m_separator.front())
+                         : _m_rest.rfind(_m_separator);
+
+            if (pos == text_type::npos) {
+                _m_line = _m_rest;
+                _m_rest = {};
+                _m_has_rest = false;
+                return;
+            }
+
+            // The line before a \n also loses a trailing \r.
+            auto len = _m_universal ? 1 : _m_separator.size();
+            _m_line = _m_rest.substr(pos + len);
+            _m_rest = _m_rest.substr(0, pos);
+            if (_m_universal and not _m_rest.empty() and traits::eq(_m_rest.back(), char_type('\r')))
+                _m_rest.remove_suffix(1);
+        }
+    };
+
+private:
+    text_type _m_text{};
+    text_type _m_separator{};
+    bool _m_universal = true;
+
+public:
+    /// Construct an empty view.
+    constexpr basic_rlines_view() = default;
+
+    /// Iterate over lines separated by \c \\n or \c \\r\\n.
+    explicit constexpr basic_rlines_view(text_type text) noexcept
+        : _m_text(text) {}
+
+    /// Iterate over lines separated by \p separator.
+    constexpr basic_rlines_view(text_type text, text_type separator) noexcept
+        : _m_text(text), _m_separator(separator), _m_universal(false) {}
+
+    [[nodiscard]] constexpr auto
+    begin() const noexcept -> iterator { return iterator{_m_text, _m_separator, _m_universal}; }
+
+    [[nodiscard]] constexpr auto
+    end() const noexcept -> std::default_sentinel_t { return std::default_sentinel; }
+};
+
+/// \brief A range over chunks of a stream.
+///
+/// \see basic_stream::chunks()
+template <typename CharType>
+class basic_chunks_view : public std::ranges::view_interface<basic_chunks_view<CharType>> {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using size_type = std::size_t;
+    using stream_type = basic_stream<char_type>;
+
+    class iterator {
+        friend basic_chunks_view;
+
+        text_type _m_chunk{};
+        text_type _m_rest{};
+        size_type _m_chunk_size = 1;
+        char_type _m_separator{};
+
+        constexpr iterator(text_type text, size_type chunk_size, char_type separator) noexcept
+            : _m_rest(text), _m_chunk_size(std::max<size_type>(chunk_size, 1)), _m_separator(separator) {
+            _m_next();
+        }
+
+    public:
+        using value_type = stream_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::forward_iterator_tag;
+
+        constexpr iterator() = default;
+
+        [[nodiscard]] constexpr auto
+        operator*() const noexcept -> stream_type { return stream_type{_m_chunk}; }
+
+        constexpr auto operator++() noexcept -> iterator& {
+            _m_next();
+            return *this;
+        }
+
+        constexpr auto operator++(int) noexcept -> iterator {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& a, const iterator& b) noexcept -> bool {
+            return a._m_chunk.data() == b._m_chunk.data() and a._m_chunk.size() == b._m_chunk.size();
+        }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& a, std::default_sentinel_t) noexcept -> bool {
+            return a._m_chunk.empty();
+        }
+
+    private:
+        constexpr void _m_next() noexcept {
+            auto pos = _m_chunk_size > _m_rest.size()
+                         ? text_type::npos
+                         : _m_rest.find(_m_separator, _m_chunk_size - 1);
+            auto end = pos == text_type::npos ? _m_rest.size() : pos + 1;
+            _m_chunk = _m_rest.substr(0, end);
+            _m_rest.remove_prefix(end);
+        }
+    };
+
+private:
+    text_type _m_text{};
+    size_type _m_chunk_size = 1;
+    char_type _m_separator{};
+
+public:
+    /// Construct an empty view.
+    constexpr basic_chunks_view() = default;
+
+    /// \see basic_stream::chunks()
+    constexpr basic_chunks_view(text_type text, size_type chunk_size, char_type separator) noexcept
+        : _m_text(text), _m_chunk_size(chunk_size), _m_separator(separator) {}
+
+    [[nodiscard]] constexpr auto
+    begin() const noexcept -> iterator { return iterator{_m_text, _m_chunk_size, _m_separator}; }
+
+    [[nodiscard]] constexpr auto
+    end() const noexcept -> std::default_sentinel_t { return std::default_sentinel; }
+};
+
+/// \brief A range over the key-value pairs in a stream.
+///
+/// \see basic_stream::kv_pairs()
+template <typename CharType>
+class basic_kv_view : public std::ranges::view_interface<basic_kv_view<CharType>> {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using stream_type = basic_stream<char_type>;
+    using char_set_type = char_set<char_type>;
+    using kv_pair = typename stream_type::kv_pair;
+
+    class iterator {
+        friend basic_kv_view;
+
+        kv_pair _m_pair{};
+        stream_type _m_rest{};
+        char_set_type _m_terminators{};
+        char_type _m_sep{};
+        bool _m_at_end = true;
+
+        constexpr iterator(text_type text, char_type sep, const char_set_type& terminators) noexcept
+            : _m_rest(text), _m_terminators(terminators), _m_sep(sep) {
+            _m_next();
+        }
+
+    public:
+        using value_type = kv_pair;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::forward_iterator_tag;
+
+        constexpr iterator() = default;
+
+        [[nodiscard]] constexpr auto
+        operator*() const noexcept -> kv_pair { return _m_pair; }
+
+        constexpr auto operator++() noexcept -> iterator& {
+            _m_next();
+            return *this;
+        }
+
+        constexpr auto operator++(int) noexcept -> iterator {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& a, const iterator& b) noexcept -> bool {
+            if (a._m_at_end or b._m_at_end) return a._m_at_end == b._m_at_end;
+            return a._m_rest.text().data() == b._m_rest.text().data();
+        }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& a, std::default_sentinel_t) noexcept -> bool {
+            return a._m_at_end;
+        }
+
+    private:
+        // Skip over fields without a separator until we find a pair.
+        constexpr void _m_next() noexcept {
+            for (;;) {
+                if (auto kv = _m_rest.take_kv(_m_sep, _m_terminators)) {
+                    _m_pair = *kv;
+                    _m_at_end = false;
+                    return;
+                }
+
+                _m_rest.drop_until(_m_terminators);
+                if (_m_rest.empty()) break;
+                _m_rest.drop();
+            }
+
+            _m_at_end = true;
+        }
+    };
+
+private:
+    text_type _m_text{};
+    char_set_type _m_terminators{};
+    char_type _m_sep{};
+
+public:
+    /// Construct an empty view.
+    constexpr basic_kv_view() = default;
+
+    /// \see basic_stream::kv_pairs()
+    constexpr basic_kv_view(text_type text, char_type sep, const char_set_type& terminators) noexcept
+        : _m_text(text), _m_terminators(terminators), _m_sep(sep) {}
+
+    [[nodiscard]] constexpr auto
+    begin() const noexcept -> iterator { return iterator{_m_text, _m_sep, _m_terminators}; }
+
+    [[nodiscard]] constexpr auto
+    end() const noexcept -> std::default_sentinel_t { return std::default_sentinel; }
 };
 
 using stream = basic_stream<char>;
@@ -724,7 +3570,21 @@ using u16stream = basic_stream<char16_t>;
 using u32stream = basic_stream<char32_t>;
 
 #undef LIBSTREAM_ASSERT
+#undef LIBSTREAM_STATS_SCOPE
+#undef LIBSTREAM_STATS_EXAMINE
 
 } // namespace streams
 
+template <typename CharType>
+inline constexpr bool std::ranges::enable_borrowed_range<streams::basic_lines_view<CharType>> = true;
+
+template <typename CharType>
+inline constexpr bool std::ranges::enable_borrowed_range<streams::basic_rlines_view<CharType>> = true;
+
+template <typename CharType>
+inline constexpr bool std::ranges::enable_borrowed_range<streams::basic_chunks_view<CharType>> = true;
+
+template <typename CharType>
+inline constexpr bool std::ranges::enable_borrowed_range<streams::basic_kv_view<CharType>> = true;
+
 #endif // STREAM_STREAM_HH
@@ -0,0 +1,258 @@
+#ifndef STREAM_SYMBOL_TABLE_HH
+#define STREAM_SYMBOL_TABLE_HH
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "arena.hh"
+#include "stream.hh"
+
+namespace streams {
+namespace detail {
+// A fast hash for short strings: code units are packed into 64-bit words,
+// each of which is mixed in with a single multiply. This is not meant to
+// resist collisions chosen by an attacker.
+template <typename CharType>
+[[nodiscard]] constexpr auto hash_text(std::basic_string_view<CharType> text) noexcept -> std::uint64_t {
+    static_assert(sizeof(CharType) <= 4);
+    constexpr std::uint64_t k = 0x9E37'79B9'7F4A'7C15;
+    constexpr std::size_t per_word = 8 / sizeof(CharType);
+    std::uint64_t h = (text.size() + 1) * k;
+    auto mix = [&](std::uint64_t w) {
+        h = (h ^ w) * k;
+        h ^= h >> 32;
+    };
+
+    // The word layout depends on the byte order here, but hashes are
+    // only ever compared within the same evaluation. Short strings are
+    // read with two overlapping loads rather than byte by byte; since
+    // the length is part of the hash, this still covers every byte once.
+    if not consteval {
+        auto bytes = text.size() * sizeof(CharType);
+        auto p = reinterpret_cast<const char*>(text.data());
+        auto load = [p]<typename T>(std::size_t i, T) {
+            T w;
+            std::memcpy(&w, p + i, sizeof(T));
+            return std::uint64_t(w);
+        };
+
+        if (bytes >= 8) {
+            for (std::size_t i = 0; i + 8 < bytes; i += 8) mix(load(i, std::uint64_t{}));
+            mix(load(bytes - 8, std::uint64_t{}));
+        } else if (bytes >= 4) {
+            mix(load(0, std::uint32_t{}) | load(bytes - 4, std::uint32_t{}) << 32);
+        } else if (bytes != 0) {
+            mix(std::uint64_t(std::uint8_t(p[0])) | std::uint64_t(std::uint8_t(p[bytes / 2])) << 8 | std::uint64_t(std::uint8_t(p[bytes - 1])) << 16);
+        }
+    } else {
+        for (std::size_t i = 0; i < text.size(); i += per_word) {
+            std::uint64_t w = 0;
+            for (std::size_t j = 0; j < per_word and i + j < text.size(); ++j)
+                w |= std::uint64_t(code_unit(text[i + j])) << (j * 8 * sizeof(CharType));
+            mix(w);
+        }
+    }
+
+    h ^= h >> 29;
+    h *= 0xBF58'476D'1CE4'E5B9;
+    h ^= h >> 32;
+    return h;
+}
+} // namespace detail
+
+/// \brief A table of interned strings.
+///
+/// Every distinct string added to the table is assigned an id; ids are
+/// assigned in order, starting at 0, so they can be used as indices into
+/// other arrays. The strings are copied into an arena owned by the table,
+/// so they can outlive the text they came from, and looking one up does
+/// not need to allocate.
+///
+/// This is an open-addressing hash table. Each slot has a control byte,
+/// which is either empty or holds 7 bits of the hash of the string in
+/// that slot; slots are probed in groups of 8, and the control bytes of
+/// a group are compared against the hash all at once, so most lookups
+/// only look at a single string.
+///
+/// \see basic_stream::take_symbol()
+template <typename CharType>
+class basic_symbol_table {
+public:
+    using char_type = CharType;
+    using text_type = std::basic_string_view<char_type>;
+    using size_type = std::size_t;
+    using id_type = symbol_id;
+
+private:
+    static constexpr size_type group_size = 8;
+    static constexpr std::uint8_t empty_slot = 0x80;
+    static constexpr std::uint64_t lsb = 0x0101'0101'0101'0101;
+    static constexpr std::uint64_t msb = 0x8080'8080'8080'8080;
+
+    std::vector<std::uint8_t> _m_ctrl;
+    std::vector<id_type> _m_slots;
+    std::vector<text_type> _m_names;
+    std::vector<std::uint64_t> _m_hashes;
+    basic_arena<char_type> _m_arena;
+
+public:
+    /// Construct an empty table; this does not allocate.
+    constexpr basic_symbol_table() = default;
+
+    /// Remove all symbols from the table.
+    ///
+    /// This invalidates all ids and all views returned by \c name().
+    constexpr void clear() noexcept {
+        std::ranges::fill(_m_ctrl, empty_slot);
+        _m_names.clear();
+        _m_hashes.clear();
+        _m_arena.reset();
+    }
+
+    /// Check if a string is in the table.
+    [[nodiscard]] constexpr auto
+    contains(text_type text) const noexcept -> bool { return find(text).has_value(); }
+
+    /// Check if the table is empty.
+    [[nodiscard]] constexpr auto
+    empty() const noexcept -> bool { return _m_names.empty(); }
+
+    /// Look up a string.
+    ///
+    /// \return The id of the string, or an empty optional if it is not
+    ///         in the table.
+    [[nodiscard]] constexpr auto
+    find(text_type text) const noexcept -> std::optional<id_type> {
+        return _m_find(text, detail::hash_text(text));
+    }
+
+    /// Add a string to the table.
+    ///
+    /// \return The id of the string; if it is already in the table, this
+    ///         returns the existing id.
+    constexpr auto intern(text_type text) -> id_type {
+        auto h = detail::hash_text(text);
+        if (auto id = _m_find(text, h)) return *id;
+        reserve(size() + 1);
+        auto id = id_type(_m_names.size());
+        _m_names.push_back(_m_arena.copy(text));
+        _m_hashes.push_back(h);
+        _m_insert_slot(h, id);
+        return id;
+    }
+
+    /// \return The string with the given id.
+    [[nodiscard]] constexpr auto
+    name(id_type id) const noexcept -> text_type {
+        return _m_names[id];
+    }
+
+    /// Make room for at least \p n symbols.
+    constexpr void reserve(size_type n) {
+        // Keep the load factor at or below 7/8.
+        if (n * 8 <= _m_slots.size() * 7) return;
+        auto capacity = std::max<size_type>(_m_slots.size(), group_size);
+        while (n * 8 > capacity * 7) capacity *= 2;
+
+        _m_ctrl.assign(capacity, empty_slot);
+        _m_slots.assign(capacity, 0);
+        for (size_type id = 0; id < _m_names.size(); ++id) _m_insert_slot(_m_hashes[id], id_type(id));
+        _m_names.reserve(n);
+        _m_hashes.reserve(n);
+    }
+
+    /// \return The number of symbols in the table.
+    [[nodiscard]] constexpr auto
+    size() const noexcept -> size_type { return _m_names.size(); }
+
+private:
+    // Groups are probed with triangular steps, which visits every group
+    // once the number of groups is a power of 2.
+    struct probe_seq {
+        size_type pos;
+        size_type mask;
+        size_type step = 0;
+
+        constexpr void next() noexcept {
+            step += group_size;
+            pos = (pos + step) & mask;
+        }
+    };
+
+    [[nodiscard]] constexpr auto _m_find(text_type text, std::uint64_t h) const noexcept -> std::optional<id_type> {
+        if (_m_slots.empty()) return std::nullopt;
+        auto tag = _s_tag(h);
+        for (auto probe = _m_probe(h);; probe.next()) {
+            auto ctrl = _m_load_group(probe.pos);
+            for (auto m = _s_match(ctrl, tag); m; m &= m - 1) {
+                auto id = _m_slots[probe.pos + _s_first(m)];
+                if (_m_names[id] == text) return id;
+            }
+
+            if (ctrl & msb) return std::nullopt;
+        }
+    }
+
+    [[nodiscard]] constexpr auto _m_probe(std::uint64_t h) const noexcept -> probe_seq {
+        auto mask = _m_slots.size() - group_size;
+        return {size_type(h >> 7) & mask, mask};
+    }
+
+    // Load the control bytes of the group at `pos` into a word, with the
+    // first slot in the lowest byte.
+    [[nodiscard]] constexpr auto _m_load_group(size_type pos) const noexcept -> std::uint64_t {
+        if not consteval {
+            if constexpr (std::endian::native == std::endian::little) {
+                std::uint64_t w;
+                std::memcpy(&w, _m_ctrl.data() + pos, group_size);
+                return w;
+            }
+        }
+
+        std::uint64_t w = 0;
+        for (size_type i = 0; i < group_size; ++i) w |= std::uint64_t(_m_ctrl[pos + i]) << (8 * i);
+        return w;
+    }
+
+    constexpr void _m_insert_slot(std::uint64_t h, id_type id) noexcept {
+        for (auto probe = _m_probe(h);; probe.next()) {
+            if (auto empty = _m_load_group(probe.pos) & msb) {
+                auto pos = probe.pos + _s_first(empty);
+                _m_ctrl[pos] = _s_tag(h);
+                _m_slots[pos] = id;
+                return;
+            }
+        }
+    }
+
+    [[nodiscard]] static constexpr auto _s_first(std::uint64_t m) noexcept -> size_type {
+        return size_type(std::countr_zero(m)) / 8;
+    }
+
+    // Find the bytes of a group equal to `tag`. This may report a byte
+    // above a match that is off by one, but since every candidate is
+    // compared against the string anyway, that only costs a comparison.
+    [[nodiscard]] static constexpr auto _s_match(std::uint64_t ctrl, std::uint8_t tag) noexcept -> std::uint64_t {
+        auto x = ctrl ^ (lsb * tag);
+        return (x - lsb) & ~x & msb;
+    }
+
+    [[nodiscard]] static constexpr auto _s_tag(std::uint64_t h) noexcept -> std::uint8_t {
+        return std::uint8_t(h & 0x7F);
+    }
+};
+
+using symbol_table = basic_symbol_table<char>;
+using wsymbol_table = basic_symbol_table<wchar_t>;
+using u8symbol_table = basic_symbol_table<char8_t>;
+using u16symbol_table = basic_symbol_table<char16_t>;
+using u32symbol_table = basic_symbol_table<char32_t>;
+} // namespace streams
+
+#endif // STREAM_SYMBOL_TABLE_HH
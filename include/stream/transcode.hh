@@ -0,0 +1,256 @@
+#ifndef STREAM_TRANSCODE_HH
+#define STREAM_TRANSCODE_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "stream.hh"
+
+namespace streams {
+/// The default size of the blocks of a \c basic_transcode_view, in bytes.
+inline constexpr std::size_t default_transcode_block_bytes = 16 * 1'024;
+
+namespace detail {
+// The Unicode encoding of a character type is implied by its size, which is
+// what makes `wchar_t` UTF-16 on Windows and UTF-32 elsewhere.
+template <typename CharType>
+inline constexpr std::size_t max_encoded_units = sizeof(CharType) == 1 ? 4 : sizeof(CharType) == 2 ? 2 : 1;
+
+inline constexpr char32_t replacement_character = 0xFFFD;
+
+inline constexpr byte_set ascii_set = [] {
+    byte_set s;
+    for (unsigned b = 0; b < 0x80; ++b) s.insert(std::uint8_t(b));
+    return s;
+}();
+
+// Decode the code point at the start of `in`, which must not be empty, and
+// remove it; an invalid code unit is removed and replaced on its own.
+template <typename CharType>
+[[nodiscard]] constexpr auto take_code_point(basic_stream<CharType>& in) noexcept -> char32_t {
+    if constexpr (sizeof(CharType) == 1) {
+        if (auto c = in.take_codepoint()) return *c;
+    } else if constexpr (sizeof(CharType) == 2) {
+        auto text = in.text();
+        char32_t hi = std::uint16_t(text[0]);
+        if (hi < 0xD800 or hi > 0xDFFF) {
+            in.drop();
+            return hi;
+        }
+
+        if (hi < 0xDC00 and text.size() > 1) {
+            char32_t lo = std::uint16_t(text[1]);
+            if (lo >= 0xDC00 and lo <= 0xDFFF) {
+                in.drop(2);
+                return 0x1'0000 + ((hi - 0xD800) << 10) + (lo - 0xDC00);
+            }
+        }
+    } else {
+        char32_t c = std::uint32_t(in.text()[0]);
+        if (c <= 0x10'FFFF and (c < 0xD800 or c > 0xDFFF)) {
+            in.drop();
+            return c;
+        }
+    }
+
+    in.drop();
+    return replacement_character;
+}
+
+// Encode a valid code point at `out`; returns the number of units written.
+template <typename CharType>
+constexpr auto put_code_point(CharType* out, char32_t c) noexcept -> std::size_t {
+    if constexpr (sizeof(CharType) == 1) {
+        if (c < 0x80) {
+            out[0] = CharType(c);
+            return 1;
+        }
+
+        if (c < 0x800) {
+            out[0] = CharType(0xC0 | (c >> 6));
+            out[1] = CharType(0x80 | (c & 0x3F));
+            return 2;
+        }
+
+        if (c < 0x1'0000) {
+            out[0] = CharType(0xE0 | (c >> 12));
+            out[1] = CharType(0x80 | ((c >> 6) & 0x3F));
+            out[2] = CharType(0x80 | (c & 0x3F));
+            return 3;
+        }
+
+        out[0] = CharType(0xF0 | (c >> 18));
+        out[1] = CharType(0x80 | ((c >> 12) & 0x3F));
+        out[2] = CharType(0x80 | ((c >> 6) & 0x3F));
+        out[3] = CharType(0x80 | (c & 0x3F));
+        return 4;
+    } else if constexpr (sizeof(CharType) == 2) {
+        if (c < 0x1'0000) {
+            out[0] = CharType(c);
+            return 1;
+        }
+
+        c -= 0x1'0000;
+        out[0] = CharType(0xD800 + (c >> 10));
+        out[1] = CharType(0xDC00 + (c & 0x3FF));
+        return 2;
+    } else {
+        out[0] = CharType(c);
+        return 1;
+    }
+}
+} // namespace detail
+
+/// \brief A stream converted to another Unicode encoding, one block at a time.
+///
+/// This converts the text of a stream from the encoding of \c From to that of
+/// \c To as it is iterated over, yielding the result as a sequence of streams
+/// that all refer to the same buffer, which the view owns. Memory use is thus
+/// bounded by the block size no matter how long the text is; in exchange,
+/// each block is only valid until the iterator is incremented.
+///
+/// \code
+///     for (auto block : transcode<char8_t>(u16stream{text}))
+///         sink.write(block.text());
+/// \endcode
+///
+/// The encoding of a character type is determined by its size: UTF-8 for
+/// single-byte types, UTF-16 for two-byte types, and UTF-32 otherwise. Every
+/// code unit that is not part of a valid code point in the input, e.g. an
+/// unpaired surrogate, is replaced by U+FFFD.
+///
+/// Code points are never split between blocks, but anything else might be,
+/// e.g. lines. Runs of ASCII text, which are the same in every encoding, are
+/// found with the same vectorised search as \c basic_stream::take_while_any(),
+/// and copied over in bulk.
+///
+/// This is an input range: iterating over it consumes the input.
+///
+/// \see transcode()
+template <typename To, typename From>
+class basic_transcode_view {
+public:
+    using char_type = To;
+    using size_type = std::size_t;
+    using stream_type = basic_stream<To>;
+    using input_type = basic_stream<From>;
+
+    /// The default block size, in characters.
+    static constexpr size_type default_block_size = std::max<size_type>(
+        default_transcode_block_bytes / sizeof(To),
+        detail::max_encoded_units<To>
+    );
+
+    class iterator {
+        basic_transcode_view* _m_view = nullptr;
+
+    public:
+        using value_type = stream_type;
+        using difference_type = std::ptrdiff_t;
+
+        constexpr iterator() = default;
+        constexpr explicit iterator(basic_transcode_view* view) noexcept : _m_view(view) {}
+
+        [[nodiscard]] constexpr auto
+        operator*() const noexcept -> stream_type { return {_m_view->_m_buffer.data(), _m_view->_m_size}; }
+
+        constexpr auto operator++() noexcept -> iterator& {
+            _m_view->_m_convert();
+            return *this;
+        }
+
+        constexpr void operator++(int) noexcept { ++*this; }
+
+        [[nodiscard]] friend constexpr auto
+        operator==(const iterator& it, std::default_sentinel_t) noexcept -> bool { return it._m_done(); }
+
+    private:
+        [[nodiscard]] constexpr auto _m_done() const noexcept -> bool { return _m_view->_m_size == 0; }
+    };
+
+private:
+    input_type _m_input;
+    std::vector<To> _m_buffer;
+    size_type _m_size = 0;
+    bool _m_started = false;
+
+public:
+    /// Create a view that converts \p input in blocks of \p block_size
+    /// characters; blocks may be a few characters shorter so that code
+    /// points are not split.
+    ///
+    /// \throw std::bad_alloc if the buffer cannot be allocated.
+    explicit constexpr basic_transcode_view(input_type input, size_type block_size = default_block_size)
+        : _m_input(input), _m_buffer(std::max(block_size, detail::max_encoded_units<To>)) {}
+
+    /// \return An iterator to the first block.
+    [[nodiscard]] constexpr auto
+    begin() noexcept -> iterator {
+        if (not _m_started) {
+            _m_started = true;
+            _m_convert();
+        }
+
+        return iterator{this};
+    }
+
+    [[nodiscard]] constexpr auto
+    end() const noexcept -> std::default_sentinel_t { return std::default_sentinel; }
+
+    /// \return The part of the input that has not been converted yet.
+    [[nodiscard]] constexpr auto
+    input() const noexcept -> input_type { return _m_input; }
+
+private:
+    constexpr void _m_convert() noexcept {
+        auto out = _m_buffer.data();
+        auto room = _m_buffer.size();
+        size_type n = 0;
+        while (not _m_input.empty() and n < room) {
+            auto ascii = detail::find_first<true>(_m_input.text().substr(0, room - n), detail::ascii_set);
+            if (ascii == std::basic_string_view<From>::npos) ascii = std::min(room - n, _m_input.size());
+            std::ranges::transform(_m_input.text().substr(0, ascii), out + n, [](From c) { return To(c); });
+            _m_input.drop(ascii);
+            n += ascii;
+
+            // Encode each code point on the side first, since we only know
+            // whether it fits once we know how long it is.
+            while (not _m_input.empty() and std::make_unsigned_t<From>(_m_input.text()[0]) >= 0x80) {
+                auto rest = _m_input;
+                To units[detail::max_encoded_units<To>]{};
+                auto len = detail::put_code_point(units, detail::take_code_point(rest));
+                if (len > room - n) {
+                    _m_size = n;
+                    return;
+                }
+
+                std::ranges::copy_n(units, std::ptrdiff_t(len), out + n);
+                n += len;
+                _m_input = rest;
+            }
+        }
+
+        _m_size = n;
+    }
+};
+
+/// \brief Convert a stream to another Unicode encoding lazily.
+///
+/// \code
+///     auto utf8 = transcode<char8_t>(u16stream{text});
+/// \endcode
+///
+/// \see basic_transcode_view
+template <typename To, typename From>
+[[nodiscard]] constexpr auto transcode(
+    basic_stream<From> input,
+    std::size_t block_size = basic_transcode_view<To, From>::default_block_size
+) -> basic_transcode_view<To, From> {
+    return basic_transcode_view<To, From>{input, block_size};
+}
+} // namespace streams
+
+#endif // STREAM_TRANSCODE_HH
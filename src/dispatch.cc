@@ -0,0 +1,4 @@
+// The runtime dispatch tables and their entry points, for programs built
+// with `LIBSTREAM_DISPATCH_LIBRARY`; see the dispatch section of simd.hh.
+#define LIBSTREAM_DISPATCH_SOURCE 1
+#include <stream/detail/simd.hh>
@@ -0,0 +1,669 @@
+#include <stream/async_stream.hh>
+#include <stream/chunked_stream.hh>
+#include <stream/compressed_stream.hh>
+#include <stream/mapped_stream.hh>
+#include <stream/parallel.hh>
+#include <stream/pipeline.hh>
+#include <stream/stream.hh>
+
+#include <algorithm>
+#include <bitset>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <coroutine>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace streams;
+using namespace std::literals;
+
+// Tests for the parts of the library that cannot run in constant expressions,
+// e.g. because they use threads, files, or coroutines; everything else is in
+// test.cc. Each test is a function that is called from main(), and a failed
+// check prints its line and lets the other checks run.
+
+#define STR(x) STR_(x)
+#define STR_(x) #x
+
+#define Check(cond) \
+    if (not(cond)) std::fprintf(stderr, "Failure on line " STR(__LINE__) ": %s\n", #cond), ++failures
+
+namespace {
+int failures = 0;
+
+/// A file in the temporary directory that is deleted again at the end of
+/// the test that created it.
+struct TempFile {
+    std::filesystem::path path;
+
+    explicit TempFile(std::string_view name, std::string_view contents = "")
+        : path(std::filesystem::temp_directory_path() / ("libstream-" + std::string(name))) {
+        std::ofstream{path, std::ios::binary}.write(contents.data(), std::streamsize(contents.size()));
+    }
+
+    TempFile(const TempFile&) = delete;
+    auto operator=(const TempFile&) -> TempFile& = delete;
+    ~TempFile() {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+};
+
+template <typename CharType>
+auto Lines(basic_stream<CharType> s) -> std::vector<std::basic_string_view<CharType>> {
+    std::vector<std::basic_string_view<CharType>> out;
+    for (auto line : s.lines()) out.push_back(line.text());
+    return out;
+}
+
+void test_parallel_lines() {
+    for (auto text : {"a\nbb\r\n\nccc\ndddd\neeeee\n"sv, "a\nbb\r\n\nccc\ndddd\neeeee"sv, "\n\n"sv, "x"sv, ""sv}) {
+        for (std::size_t chunk_size : {1, 3, 7, 1'000}) {
+            auto lines = parallel_lines(stream{text}, 4, [](stream line) { return line.text(); }, chunk_size);
+            Check(lines == Lines(stream{text}));
+        }
+    }
+
+    std::u16string big;
+    for (int i = 0; i < 10'000; ++i) big += u"line " + std::u16string(std::size_t(i % 13), u'é') + u"\n";
+    auto lines = parallel_lines(u16stream{big}, 8, [](u16stream line) { return line.text(); }, 64);
+    Check(lines == Lines(u16stream{big}));
+    Check(lines.size() == 10'001 and lines.back().empty());
+}
+
+void test_mapped_stream() {
+    TempFile file{"mapped", "foo\nbar\n"};
+    auto s = mapped_stream::open(file.path);
+    Check(s.has_value());
+    Check(s->text() == "foo\nbar\n");
+    Check(s->take_until('\n') == "foo");
+    Check(s->mapped_text() == "foo\nbar\n");
+
+    // Only whole characters are mapped.
+    auto u16 = u16mapped_stream::open(file.path);
+    Check(u16.has_value());
+    Check(u16->size() == 4);
+
+    TempFile empty{"mapped-empty"};
+    auto e = mapped_stream::open(empty.path);
+    Check(e.has_value());
+    Check(e->empty());
+
+    // On Windows, the reason is reported by GetLastError() instead.
+#ifndef _WIN32
+    errno = 0;
+    Check(not mapped_stream::open(empty.path.string() + ".missing").has_value());
+    Check(errno == ENOENT);
+
+    // Neither of these is a regular file, and both report a size of 0.
+    errno = 0;
+    Check(not mapped_stream::open(std::filesystem::temp_directory_path()).has_value());
+    Check(errno == ENODEV);
+    if (std::filesystem::exists("/dev/null")) {
+        errno = 0;
+        Check(not mapped_stream::open("/dev/null").has_value());
+        Check(errno == ENODEV);
+    }
+#endif
+}
+
+void test_chunked_stream() {
+    // A search that fails resumes when more data is appended.
+    chunked_stream s{8};
+    s.append("foo");
+    Check(not s.take_until('\n'));
+    Check(s.text() == "foo");
+    s.append("bar\nbaz");
+    Check(s.take_until('\n') == "foobar");
+    Check(s.consume('\n'));
+    Check(not s.take_until('\n'));
+    Check(not s.take(4));
+
+    // After close(), we get whatever is left.
+    s.close();
+    Check(s.eof() and not s.exhausted());
+    Check(s.take_until('\n') == "baz");
+    Check(s.exhausted());
+    Check(not s.take_until('\n'));
+    Check(not s.take());
+
+    // A delimiter that is split across appends, including the case where
+    // the needle is too long to be stored inline in the resume hint.
+    for (auto delim : {"\r\n"sv, "--boundary-0123456789abcdef--"sv}) {
+        chunked_stream c{4};
+        c.append("abc");
+        c.append(delim.substr(0, 1));
+        Check(not c.take_until(delim));
+        c.append(delim.substr(1, delim.size() / 2 - 1));
+        Check(not c.take_until(delim));
+        c.append(delim.substr(delim.size() / 2));
+        c.append("def");
+        Check(c.take_until(delim) == "abc");
+        c.drop(delim.size());
+        Check(c.text() == "def");
+    }
+
+    // Interleaving searches for different things.
+    chunked_stream i;
+    i.append("key=value");
+    Check(not i.take_until(';'));
+    Check(i.take_until('=') == "key");
+    Check(not i.take_until_any(";,"));
+    i.append(",rest");
+    Check(i.drop().take_until_any(";,") == "value");
+
+    // Consumed data is moved out of the way before the buffer grows.
+    chunked_stream g{4};
+    g.append("abcd");
+    Check(g.take(2) == "ab");
+    g.append("ef");
+    Check(g.capacity() == 4);
+    Check(g.text() == "cdef");
+    g.append("ghijk");
+    Check(g.capacity() >= 9);
+    Check(g.text() == "cdefghijk");
+    g.drop(3);
+    g.compact();
+    Check(g.text() == "fghijk");
+
+    // Writing into the buffer directly.
+    u16chunked_stream w{2};
+    auto buf = w.prepare(5);
+    Check(buf.size() >= 5);
+    std::ranges::copy(u"ab\ncd"sv.substr(0, 5), buf.begin());
+    w.commit(5);
+    Check(w.take_until(u'\n') == u"ab");
+    Check(w.drop().text() == u"cd");
+}
+
+// from_chars() for floating-point types is not constexpr.
+void test_take_float() {
+    u16stream s{u"1.5e3 -0.25;"sv};
+    Check(s.take_float() == 1.5e3);
+    Check(s.drop().take_float() == -0.25);
+    Check(s.text() == u";");
+    Check(not s.take_float());
+    Check(s.text() == u";");
+
+    // Numbers that do not fit in the buffer used for non-char streams.
+    for (std::size_t ones : {126, 127, 128, 129, 300}) {
+        std::u16string text(ones, u'1');
+        text += u"e5;";
+        auto expected = std::stod(std::string(ones, '1') + "e5");
+
+        u16stream u{text};
+        Check(u.take_float() == expected);
+        Check(u.text() == u";");
+
+        std::u32string text32{text.begin(), text.end()};
+        u32stream w{text32};
+        Check(w.take_float() == expected);
+        Check(w.text() == U";");
+    }
+
+    // Long numbers must parse exactly like they do for char, which passes
+    // the text to from_chars() as is.
+    auto same_as_char = []<typename T>(std::string_view text, std::chars_format fmt, T) {
+        stream c{text};
+        auto expected = c.take_float<T>(fmt);
+        std::u16string wide{text.begin(), text.end()};
+        u16stream u{wide};
+        auto actual = u.take_float<T>(fmt);
+        if (expected.has_value() != actual.has_value() or c.size() != u.size()) return false;
+        return not expected or *expected == *actual or (std::isnan(*expected) and std::isnan(*actual));
+    };
+
+    // 1 + 2^-53 is halfway between 1 and the next double, so it rounds to
+    // even, unless there is a nonzero digit after it, however far.
+    auto halfway = "1.00000000000000011102230246251565404236316680908203125"s;
+    auto zeros = std::string(200, '0');
+    std::vector<std::string> texts{
+        halfway,
+        halfway + zeros + ";",
+        halfway + zeros + "1;",
+        halfway + zeros + "e0",
+        "-0." + zeros + "1e-3",
+        "0." + zeros + zeros + zeros + zeros + "1",
+        zeros + zeros + "123.5e-2x",
+        "1" + zeros + "." + zeros + "9",
+        "1" + zeros + "e",
+        "1" + zeros + "e+",
+        "1" + zeros + "e-007",
+        "1" + zeros + "e999999999999999999999",
+        "1" + zeros + "e-999999999999999999999",
+        "." + zeros + "5",
+        zeros + ".",
+        zeros,
+        "-" + zeros + "x",
+        "nan(" + zeros + ")",
+        "-nan(" + zeros,
+        "infinity" + zeros,
+        std::string(200, '-'),
+        std::string(200, '.'),
+        "0x" + zeros,
+        "abc" + zeros + "p-4",
+    };
+
+    for (auto& text : texts) {
+        for (auto fmt : {std::chars_format::general, std::chars_format::fixed, std::chars_format::scientific, std::chars_format::hex}) {
+            Check(same_as_char(text, fmt, 0.0));
+            Check(same_as_char(text, fmt, 0.0f));
+            Check(same_as_char(text, fmt, 0.0L));
+        }
+    }
+
+    u16stream h{u"1.00000000000000011102230246251565404236316680908203125"
+                u"000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001"sv};
+    Check(h.take_float() == std::nextafter(1.0, 2.0));
+    Check(h.empty());
+}
+
+// For wide characters, the _any functions scan a short prefix (or suffix)
+// one character at a time before they use a byte set, so place the match
+// on either side of that boundary.
+template <typename CharType>
+void test_find_any() {
+    using text = std::basic_string_view<CharType>;
+    const CharType ab[] = {'a', 'b'};
+    const CharType wide[] = {'a', CharType(0x3B1)};
+    for (auto chars : {text{ab, 2}, text{wide, 2}}) {
+        for (std::size_t size : {1, 31, 64, 96, 97, 200}) {
+            for (std::size_t pos = 0; pos <= size; ++pos) {
+                std::basic_string<CharType> str(size, CharType('x'));
+                if (pos < size) str[pos] = chars.back();
+                auto expected = std::min(pos, size);
+
+                basic_stream<CharType> s{str};
+                Check(s.take_until_any(chars).size() == expected);
+                Check(basic_stream<CharType>{str}.take_back_until_any(chars).size() == (pos < size ? size - pos - 1 : size));
+
+                // Not any of the characters, i.e. trimming them.
+                std::basic_string<CharType> ws(size, chars.front());
+                if (pos < size) ws[pos] = CharType('x');
+                Check(basic_stream<CharType>{ws}.trim_front(chars).size() == size - expected);
+                Check(basic_stream<CharType>{ws}.trim_back(chars).size() == (pos < size ? pos + 1 : 0));
+            }
+        }
+    }
+}
+
+// Character class predicates are turned into a char_set for long inputs,
+// so one with more wide ranges than a set can hold must still match the
+// same characters as it does on short ones.
+void test_wide_pred() {
+    constexpr auto cjk = pred::any_of(u"\x4e00\x4e10\x4e20\x4e30\x4e40\x4e50\x4e60\x4e70\x4e80\x4e90\x4ea0\x4eb0\x4ec0\x4ed0\x4ee0\x4ef0\x4f00");
+    static_assert(cjk.to_char_set<char16_t>().overflowed());
+    for (std::size_t size : {4, 64, 200}) {
+        for (std::size_t pos = 0; pos <= size; ++pos) {
+            std::u16string str;
+            for (std::size_t i = 0; i < size; ++i) str += cjk.chars[i % cjk.chars.size()];
+            if (pos < size) str[pos] = u'x';
+            auto back = pos < size ? size - pos - 1 : size;
+
+            Check(u16stream{str}.take_while(cjk).size() == pos);
+            Check(u16stream{str}.take_until(!cjk).size() == pos);
+            Check(u16stream{str}.drop_while(cjk).size() == size - pos);
+            Check(u16stream{str}.take_back_while(cjk).size() == back);
+            Check(u16stream{str}.take_back_until(!cjk).size() == back);
+            Check(u16stream{str}.drop_back_while(cjk).size() == size - back);
+        }
+    }
+}
+
+template <typename CharType>
+void test_pipeline(std::size_t buffer_bytes) {
+    using pipeline = basic_stream_pipeline<CharType>;
+    using string = std::basic_string<CharType>;
+
+    // Records of increasing length, so that some do not fit in a buffer,
+    // and one file that does not end with a separator.
+    std::vector<string> contents;
+    for (std::size_t f = 0; f < 3; ++f) {
+        string text;
+        for (std::size_t i = 0; i < 50; ++i) text += string(i % 17 + f, CharType('a' + i % 26)) + CharType('\n');
+        contents.push_back(std::move(text));
+    }
+    contents.back() += CharType('z');
+
+    std::vector<std::unique_ptr<TempFile>> files;
+    std::vector<std::filesystem::path> paths;
+    for (auto& text : contents) {
+        auto name = "pipeline-" + std::to_string(files.size());
+        auto bytes = std::string_view{reinterpret_cast<const char*>(text.data()), text.size() * sizeof(CharType)};
+        paths.push_back(files.emplace_back(std::make_unique<TempFile>(name, bytes))->path);
+    }
+
+    std::mutex mutex;
+    std::vector<typename pipeline::chunk> chunks;
+    std::vector<string> texts;
+    pipeline p{{.workers = 3, .buffer_bytes = buffer_bytes, .buffers = 4}};
+    auto failed = p.run(paths, [&](typename pipeline::chunk c) {
+        std::unique_lock lock{mutex};
+        texts.emplace_back(c.stream.text());
+        c.stream = {};
+        chunks.push_back(c);
+    });
+    Check(failed.empty());
+
+    // The chunks of each file, in order, add up to the file, and only the
+    // last one does not end at a separator unless a record did not fit.
+    auto capacity = p.options().buffer_bytes / sizeof(CharType);
+    auto records_fit = capacity > 20;
+    for (std::size_t f = 0; f < contents.size(); ++f) {
+        std::vector<std::pair<std::uint64_t, string>> parts;
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+            if (chunks[i].file == f) parts.emplace_back(chunks[i].offset, texts[i]);
+        std::ranges::sort(parts);
+
+        string joined;
+        for (auto& [offset, text] : parts) {
+            Check(offset == joined.size());
+            Check(text.size() <= capacity);
+            if (records_fit and &text != &parts.back().second) Check(text.back() == CharType('\n'));
+            joined += text;
+        }
+        Check(joined == contents[f]);
+    }
+}
+
+void test_pipeline_errors() {
+    TempFile a{"pipeline-a", "a\nb\n"};
+    TempFile b{"pipeline-b", "boom\n"};
+    auto missing = a.path;
+    missing += ".missing";
+
+    stream_pipeline p{{.workers = 2, .buffer_bytes = 4}};
+    std::vector<std::filesystem::path> paths{a.path, missing, a.path};
+    std::atomic<std::size_t> records = 0;
+    auto count = [&](stream_pipeline::chunk c) { records += std::size_t(std::ranges::count(c.stream.text(), '\n')); };
+    auto failed = p.run(paths, count);
+    Check(failed.size() == 1);
+    Check(failed.front().file == 1);
+    Check(failed.front().error == std::errc::no_such_file_or_directory);
+    Check(records == 4);
+
+    // An exception thrown by the callback is rethrown by run().
+    paths = {a.path, b.path, a.path};
+    auto thrown = false;
+    try {
+        (void) p.run(paths, [](stream_pipeline::chunk c) {
+            if (c.stream.starts_with("boom")) throw std::runtime_error{"boom"};
+        });
+    } catch (const std::runtime_error& e) {
+        thrown = e.what() == "boom"sv;
+    }
+    Check(thrown);
+
+    // And the pipeline can still be used afterwards.
+    records = 0;
+    Check(p.run(std::span{paths}.first(1), count).empty());
+    Check(records == 2);
+}
+
+/// The simplest coroutine type there is: it starts running right away, and
+/// it is destroyed along with this object, whether it has finished or not.
+struct Task {
+    struct promise_type {
+        auto get_return_object() -> Task { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+        auto final_suspend() noexcept -> std::suspend_always { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> h) noexcept : handle(h) {}
+    Task(const Task&) = delete;
+    auto operator=(const Task&) -> Task& = delete;
+    ~Task() { handle.destroy(); }
+
+    [[nodiscard]] auto done() const noexcept -> bool { return handle.done(); }
+};
+
+auto ReadLines(async_stream& s, std::vector<std::string>& lines) -> Task {
+    while (auto line = co_await s.take_until('\n')) {
+        lines.emplace_back(*line);
+        s.drop();
+    }
+}
+
+void test_async_stream() {
+    async_stream s{4};
+    std::vector<std::string> lines;
+    {
+        auto task = ReadLines(s, lines);
+
+        // No delimiter yet, so the coroutine waits.
+        Check(s.waiting());
+        s.append("foo");
+        Check(s.waiting());
+        Check(lines.empty());
+
+        // It is resumed from the call that completes its line.
+        s.append("\nbar\nba");
+        Check(s.waiting());
+        std::vector<std::string> expected{"foo", "bar"};
+        Check(lines == expected);
+
+        // Same for data written directly into the buffer.
+        auto buf = s.prepare(3);
+        "z\nq"sv.copy(buf.data(), 3);
+        s.commit(3);
+        Check(lines.back() == "baz");
+        Check(s.text() == "q");
+
+        // close() resumes it with whatever is left, and then it is done.
+        s.close();
+        Check(not s.waiting());
+        Check(task.done());
+        Check(lines.back() == "q");
+        Check(lines.size() == 4);
+    }
+
+    // Destroying a waiting coroutine cancels the wait.
+    async_stream t;
+    lines.clear();
+    {
+        auto task = ReadLines(t, lines);
+        t.append("partial");
+        Check(t.waiting());
+    }
+    Check(not t.waiting());
+    t.append(" line\n");
+    Check(lines.empty());
+    Check(t.buffer().take_until('\n') == "partial line");
+
+    // A result that is there already does not suspend, and neither does
+    // one that can never arrive.
+    async_stream u;
+    u.append("a\nb\n");
+    u.close();
+    lines.clear();
+    auto task = ReadLines(u, lines);
+    Check(task.done());
+    std::vector<std::string> expected{"a", "b"};
+    Check(lines == expected);
+}
+
+// Read a compressed_stream line by line, and return what it read and the
+// error it ended with, if any.
+auto ReadAll(const std::filesystem::path& path, compression expected_format) -> std::pair<std::string, std::error_code> {
+    std::error_code ec;
+    auto s = compressed_stream::open(path, ec, compression::detect, 1'024);
+    Check(s.has_value());
+    Check(not ec);
+    if (not s) return {{}, ec};
+    Check(s->compression_format() == expected_format);
+
+    std::string out;
+    while (auto line = s->take_until('\n')) {
+        out += *line;
+        if (s->consume('\n')) out += '\n';
+    }
+
+    Check(s->exhausted());
+    return {out, s->error()};
+}
+
+// Compress the same text in each of the formats, and check that it
+// decompresses to the same thing, including when the file consists of
+// several members or frames, and that a truncated file is reported.
+void test_compressed_stream() {
+    std::string corpus;
+    for (int i = 0; i < 50'000; ++i) corpus += "line " + std::to_string(i * 7'919 % 100'003) + "\n";
+    auto half = corpus.substr(0, corpus.size() / 2);
+    auto rest = corpus.substr(corpus.size() / 2);
+
+    TempFile plain{"compressed-plain", corpus};
+    auto [text, ec] = ReadAll(plain.path, compression::none);
+    Check(text == corpus);
+    Check(not ec);
+
+    std::vector<std::pair<compression, std::string (*)(std::string_view)>> formats;
+#if LIBSTREAM_ZLIB
+    formats.emplace_back(compression::gzip, [](std::string_view in) {
+        z_stream z{};
+        std::string out(::deflateBound(&z, uLong(in.size())) + 64, '\0');
+        (void) ::deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+        z.avail_in = uInt(in.size());
+        z.next_out = reinterpret_cast<Bytef*>(out.data());
+        z.avail_out = uInt(out.size());
+        (void) ::deflate(&z, Z_FINISH);
+        out.resize(z.total_out);
+        ::deflateEnd(&z);
+        return out;
+    });
+#else
+    std::fprintf(stderr, "Skipping gzip tests: zlib is not available\n");
+#endif
+#if LIBSTREAM_ZSTD
+    formats.emplace_back(compression::zstd, [](std::string_view in) {
+        std::string out(::ZSTD_compressBound(in.size()), '\0');
+        out.resize(::ZSTD_compress(out.data(), out.size(), in.data(), in.size(), 3));
+        return out;
+    });
+#else
+    std::fprintf(stderr, "Skipping zstd tests: libzstd is not available\n");
+#endif
+
+    for (auto [format, compress] : formats) {
+        auto whole = compress(corpus);
+        TempFile one{"compressed-one", whole};
+        auto [a, a_ec] = ReadAll(one.path, format);
+        Check(a == corpus);
+        Check(not a_ec);
+
+        TempFile two{"compressed-two", compress(half) + compress(rest)};
+        auto [b, b_ec] = ReadAll(two.path, format);
+        Check(b == corpus);
+        Check(not b_ec);
+
+        // Whatever is decompressed before the data ends is still returned.
+        TempFile cut{"compressed-cut", std::string_view{whole}.substr(0, whole.size() / 2)};
+        auto [c, c_ec] = ReadAll(cut.path, format);
+        Check(c_ec == std::errc::io_error);
+        Check(corpus.starts_with(c));
+        Check(c.size() < corpus.size());
+
+        auto garbage = whole;
+        garbage[garbage.size() / 2] ^= 0x55;
+        garbage[garbage.size() / 2 + 1] ^= 0x55;
+        TempFile bad{"compressed-bad", garbage};
+        auto [d, d_ec] = ReadAll(bad.path, format);
+        Check(d_ec == std::errc::io_error);
+    }
+}
+
+// Compare set operations on wide characters against a bitmap: the result must
+// be exact, and only overflow if neither it nor its complement fits. The sets
+// are made of short ranges of CJK characters and the first and last wide
+// character, so only those parts of the bitmap need to be compared.
+void test_char_set_ranges() {
+    using set = char_set<char16_t>;
+    using bitmap = std::bitset<0x10000>;
+    std::mt19937 rng{42};
+
+    std::vector<char16_t> checked;
+    for (unsigned c = 0; c < 0x10000; ++c)
+        if (c < 0x200 or (c >= 0x4d00 and c < 0x5000) or c >= 0xff00) checked.push_back(char16_t(c));
+
+    auto random_set = [&](bitmap& bits) {
+        set s;
+        bits.reset();
+        for (auto n = rng() % 20; n-- > 0;) {
+            auto first = char16_t(0x4e00 + rng() % 0x100);
+            auto last = char16_t(first + rng() % 8);
+            if (rng() % 8 == 0) first = last = rng() % 2 ? u'\x100' : u'\xffff';
+            s = s | set::range(first, last);
+            for (unsigned c = first; c <= last; ++c) bits.set(c);
+        }
+        return s;
+    };
+
+    auto wide_ranges = [&](const bitmap& bits) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < checked.size(); ++i)
+            n += checked[i] >= 256 and bits[checked[i]] and (checked[i] == 256 or not bits[checked[i - 1]]);
+        return n;
+    };
+
+    auto matches = [&](const set& s, const bitmap& bits) {
+        auto fits = std::min(wide_ranges(bits), wide_ranges(~bits)) <= set::max_ranges;
+        if (s.overflowed()) return not fits;
+        for (auto c : checked)
+            if (s.contains(c) != bits[c]) return false;
+        return fits;
+    };
+
+    std::size_t overflowed = 0;
+    for (int i = 0; i < 300; ++i) {
+        bitmap a_bits, b_bits;
+        auto a = random_set(a_bits);
+        auto b = random_set(b_bits);
+        Check(matches(a, a_bits));
+        Check(matches(b, b_bits));
+        Check(matches(~a, ~a_bits));
+        Check(matches(a | b, a_bits | b_bits));
+        Check(matches(a & b, a_bits & b_bits));
+        Check(matches(~a & b, ~a_bits & b_bits));
+        Check(matches(~a | ~b, ~a_bits | ~b_bits));
+        overflowed += (a | b).overflowed();
+    }
+
+    // Make sure that both cases actually happen.
+    Check(overflowed > 0 and overflowed < 300);
+}
+} // namespace
+
+int main() {
+    test_parallel_lines();
+    test_mapped_stream();
+    test_chunked_stream();
+    test_take_float();
+    test_char_set_ranges();
+    test_find_any<char>();
+    test_find_any<wchar_t>();
+    test_find_any<char16_t>();
+    test_find_any<char32_t>();
+    test_wide_pred();
+    for (std::size_t bytes : {1, 5, 16, 64, 4'096}) {
+        test_pipeline<char>(bytes);
+        test_pipeline<char16_t>(bytes);
+    }
+    test_pipeline_errors();
+    test_async_stream();
+    test_compressed_stream();
+    if (failures) std::fprintf(stderr, "%d checks failed\n", failures);
+    return failures != 0;
+}
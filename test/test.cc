@@ -1,4 +1,10 @@
 #include <stream/stream.hh>
+#include <stream/arena.hh>
+#include <stream/lexer.hh>
+#include <stream/line_index.hh>
+#include <stream/multi_searcher.hh>
+#include <stream/symbol_table.hh>
+#include <stream/transcode.hh>
 #include <functional>
 
 using namespace streams;
@@ -107,9 +113,795 @@ Test(
     Check(it == lines.end());
 );
 
+static_assert(stream{words}.take_while_any("hel") == "hell");
+static_assert(stream{words}.take_while_any("abc").empty());
+static_assert(stream{word}.take_while_any("ehlo") == "hello");
+static_assert(stream{word}.take_while_any_or_empty("ehlo").empty());
+static_assert(stream{words}.take_until_any("wz") == "hello ");
+static_assert(stream{words}.take_until_any("\xff\x80") == words);
 
+static_assert(stream{lt_spaces}.trim() == "hello world");
+static_assert(stream{lt_spaces}.trim_front() == "hello world        ");
+static_assert(stream{lt_spaces}.trim_back() == "  hello world");
+static_assert(stream{whitespace}.trim().empty());
+static_assert(stream{word}.trim("ho") == "ell");
 
+constexpr char_set<char> vowels{"aeiou"sv};
+static_assert(vowels.contains('e'));
+static_assert(not vowels.contains('x'));
+static_assert(not char_set<char>{}.contains('\0'));
+static_assert(char_set<char>::range('a', 'z').contains('q'));
+static_assert(not char_set<char>::range('a', 'z').contains('A'));
+static_assert(char_set<char>::range('\x80', '\xff').contains('\xaa'));
+static_assert((vowels | char_set<char>{"xyz"sv}).contains('y'));
+static_assert(char_set<char>{"hello"sv} == char_set<char>{"ehlo"sv});
 
+static_assert(stream{words}.take_until(vowels) == "h");
+static_assert(stream{words}.take_until(char_set<char>{"xq"sv}) == words);
+static_assert(stream{words}.take_until_or_empty(char_set<char>{"xq"sv}).empty());
+static_assert(stream{words}.take_while(char_set<char>::range('a', 'z')) == "hello");
+static_assert(stream{word}.take_while_or_empty(char_set<char>::range('a', 'z')).empty());
+static_assert(stream{words}.drop_until(char_set<char>{" "sv}) == " world foo bar baz");
+static_assert(stream{words}.drop_while(char_set<char>{"hel"sv}) == "o world foo bar baz");
+static_assert(stream{word}.trim(char_set<char>{"ho"sv}) == "ell");
+static_assert(stream{lt_spaces}.trim_front(stream::whitespace_set()) == "hello world        ");
 
+static_assert((~vowels).contains('x'));
+static_assert(not (~vowels).contains('a'));
+static_assert((~char_set<char>{}).contains('\xff'));
+static_assert((vowels & char_set<char>{"abc"sv}) == char_set<char>{"a"sv});
+static_assert(~~vowels == vowels);
+static_assert((~char_set<char16_t>::range(u'一', u'鿿')).contains(u'\xffff'));
+static_assert(not (~char_set<char16_t>::range(u'一', u'鿿')).contains(u'丁'));
+static_assert(~~char_set<char16_t>::range(u'一', u'鿿') == char_set<char16_t>::range(u'一', u'鿿'));
 
+// Sets at the limit of the range table, whose complements need one more range.
+constexpr char_set<char16_t> scattered{u"\x4e00\x4e10\x4e20\x4e30\x4e40\x4e50\x4e60\x4e70\x4e80\x4e90\x4ea0\x4eb0\x4ec0\x4ed0\x4ee0\x4ef0"sv};
+static_assert(not scattered.overflowed());
+static_assert((~scattered).contains(u'\xffff'));
+static_assert((~scattered).contains(u'\x4e01'));
+static_assert(not (~scattered).contains(u'\x4ef0'));
+static_assert(not (~scattered).overflowed());
+static_assert(~~scattered == scattered);
+static_assert((scattered & scattered) == scattered);
+static_assert((scattered & ~scattered).empty());
+static_assert((scattered | ~scattered) == ~char_set<char16_t>{});
+static_assert((scattered & char_set<char16_t>::range(u'\x4e05', u'\x4e25')) == char_set<char16_t>{u"\x4e10\x4e20"sv});
+static_assert((~scattered & ~char_set<char16_t>{u"\x4e01"sv}).contains(u'\xffff'));
+static_assert(not (~scattered & ~char_set<char16_t>{u"\x4e01"sv}).contains(u'\x4e01'));
 
+// Seventeen ranges only fit if the complement has fewer.
+static_assert(char_set<char16_t>{u"\x4e00\x4e10\x4e20\x4e30\x4e40\x4e50\x4e60\x4e70\x4e80\x4e90\x4ea0\x4eb0\x4ec0\x4ed0\x4ee0\x4ef0\x4f00"sv}.overflowed());
+constexpr auto edges = (scattered & ~char_set<char16_t>{u"\x4ef0"sv}) | char_set<char16_t>{u"\x100\xffff"sv};
+static_assert(not edges.overflowed());
+static_assert(edges.contains(u'\x100') and edges.contains(u'\xffff') and edges.contains(u'\x4ee0'));
+static_assert(not edges.contains(u'\x4ef0') and not edges.contains(u'\x101'));
+static_assert((scattered | char_set<char16_t>{u"\x4f00"sv} | char_set<char16_t>{u"\x100"sv}).overflowed());
+
+Test(
+    std::uint64_t out[3]{~0ull, ~0ull, ~0ull};
+    Check(stream{"a,b\"c\"\n"sv}.classify(char_set<char>{",\"\n"sv}, out) == 7);
+    Check(out[0] == 0b110'1010 and out[1] == ~0ull);
+
+    std::string text(150, 'x');
+    text[0] = text[63] = text[64] = text[149] = ',';
+    Check(stream{text}.classify(char_set<char>{","sv}, out) == 150);
+    Check(out[0] == (1ull | 1ull << 63) and out[1] == 1 and out[2] == 1ull << 21);
+    Check(stream{text}.classify(char_set<char>{","sv}, std::span{out}.first(1)) == 64);
+
+    Check(u16stream{u"a丁b丁"sv}.classify(char_set<char16_t>::range(u'一', u'鿿'), out) == 4);
+    Check(out[0] == 0b1010);
+    Check(u16stream{u"a丁b丁"sv}.classify(~char_set<char16_t>{u"a"sv}, out) == 4);
+    Check(out[0] == 0b1110);
+    Check(stream{empty}.classify(vowels, out) == 0);
+);
+
+Test(
+    stream s{"key: 42;"sv};
+    auto cp = s.checkpoint();
+    s.drop(3).drop_back();
+    Check(s.consumed_since(cp) == 4 and s == ": 42");
+    Check(s.rewind(cp) == "key: 42;" and s.consumed_since(cp) == 0);
+    Check(s.checkpoint() == cp);
+
+    auto number = [](stream& s) { return s.drop_until(' ').trim_front().take_uint<unsigned>(); };
+    auto missing = [](stream& s) { return s.drop_until('=').consume('='); };
+    Check(not s.try_parse(missing) and s == "key: 42;");
+    Check(s.try_parse(number) == 42u and s == ";");
+);
+
+static_assert(std::ranges::input_range<basic_transcode_view<char8_t, char16_t>>);
+
+template <typename To, typename From>
+constexpr auto Transcode(std::basic_string_view<From> text, std::size_t block_size) -> std::basic_string<To> {
+    std::basic_string<To> out;
+    for (auto block : transcode<To>(basic_stream<From>{text}, block_size)) {
+        if (block.empty() or block.size() > std::max<std::size_t>(block_size, 4)) return {};
+        out += block.text();
+    }
+    return out;
+}
+
+Test(
+    for (std::size_t block : {1, 4, 5, 7, 64}) {
+        Check(Transcode<char8_t>(u"héllo, 世界 😀!"sv, block) == u8"héllo, 世界 😀!");
+        Check(Transcode<char16_t>(u8"héllo, 世界 😀!"sv, block) == u"héllo, 世界 😀!");
+        Check(Transcode<char32_t>(u8"héllo, 世界 😀!"sv, block) == U"héllo, 世界 😀!");
+        Check(Transcode<char16_t>(U"héllo, 世界 😀!"sv, block) == u"héllo, 世界 😀!");
+        Check(Transcode<char>(u"a\xD800" u"b\xDC00\xD83D"sv, block) == "a\uFFFDb\uFFFD\uFFFD");
+        Check(Transcode<char16_t>("a\xC3\x28\xF0\x9F\x98"sv, block) == u"a\uFFFD(\uFFFD\uFFFD\uFFFD");
+    }
+
+    Check(Transcode<char8_t>(u""sv, 16).empty());
+    Check(Transcode<char16_t>(U"\x110000\xDFFFx"sv, 16) == u"\uFFFD\uFFFDx");
+
+    basic_transcode_view<char8_t, char16_t> v{u"aébc"sv, 4};
+    auto it = v.begin();
+    Check((*it).text() == u8"aéb" and v.input() == u"c");
+    ++it;
+    Check((*it).text() == u8"c" and v.input().empty());
+    ++it;
+    Check(it == v.end());
+);
+
+static_assert(pred::digit('5') and not pred::digit('a'));
+static_assert(pred::alnum(u'Z') and not pred::alnum(u'_'));
+static_assert((!pred::space)('x') and not (!pred::space)('\n'));
+static_assert((pred::alpha & !pred::xdigit)('g') and not (pred::alpha & !pred::xdigit)('f'));
+static_assert(pred::any_of(u"中文")(u'文'));
+static_assert(pred::punct.to_char_set<char>() == char_set<char>{"!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"sv});
+static_assert((!pred::ascii).to_char_set<char>() == char_set<char>::range('\x80', '\xff'));
+static_assert(pred::range(U'\x100', U'\x200').to_char_set<char>().empty());
+static_assert(pred::range(U'a', U'\x10000').to_char_set<char16_t>() == char_set<char16_t>::range(u'a', u'\xffff'));
+
+static_assert(stream{words}.take_while(pred::lower) == "hello");
+static_assert(stream{words}.take_until(pred::space) == "hello");
+static_assert(stream{words}.take_until_or_empty(pred::digit).empty());
+static_assert(stream{"foo_bar123 = 42"sv}.take_while(pred::alnum | pred::is('_')) == "foo_bar123");
+static_assert(stream{"    \t\n    \t\n    \t\n   x"sv}.take_while(pred::space) == "    \t\n    \t\n    \t\n   ");
+static_assert(stream{"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz0"sv}.take_until(pred::digit).size() == 52);
+static_assert(stream{"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz0"sv}.drop_while(!pred::digit) == "0");
+static_assert(u16stream{u"中文中文中文中文中文中文中文中文 text"sv}.take_while(!pred::ascii).size() == 16);
+
+template <typename CharType>
+constexpr bool SearchMatchesFind(std::basic_string_view<CharType> text, std::basic_string_view<CharType> needle) {
+    return searcher<CharType>{needle}.find(text) == text.find(needle);
+}
+
+constexpr auto long_needle = "abcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcX"sv;
+constexpr auto long_text = "abcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcX!"sv;
+static_assert(SearchMatchesFind(words.text(), ""sv));
+static_assert(SearchMatchesFind(words.text(), "o"sv));
+static_assert(SearchMatchesFind(words.text(), "foo"sv));
+static_assert(SearchMatchesFind(words.text(), "baz"sv));
+static_assert(SearchMatchesFind(words.text(), "bay"sv));
+static_assert(SearchMatchesFind(words.text(), "hello world foo bar baz!"sv));
+static_assert(SearchMatchesFind(long_text, long_needle));
+static_assert(SearchMatchesFind(long_text.substr(1), long_needle));
+static_assert(SearchMatchesFind(long_text.substr(0, long_text.size() - 2), long_needle));
+static_assert(SearchMatchesFind(long_text, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"sv));
+static_assert(SearchMatchesFind(u"AŁBŁCɁBŁ"sv, u"ŁBŁ"sv));
+
+Test(
+    constexpr searcher<char> crlf{"\r\n\r\n"sv};
+    stream s{"GET / HTTP/1.1\r\nHost: a\r\n\r\nbody"sv};
+    Check(s.take_until(crlf) == "GET / HTTP/1.1\r\nHost: a");
+    Check(s.drop(crlf.size()).text() == "body");
+    Check(s.take_until_or_empty(crlf).empty());
+    Check(s.text() == "body");
+    Check(s.drop_until(crlf).empty());
+);
+
+Test(
+    constexpr auto cjk = char_set<char16_t>::range(u'一', u'鿿');
+    constexpr auto set = cjk | char_set<char16_t>{u" 　"sv} | char_set<char16_t>::range(u'䀀', u'丁');
+    Check(set.contains(u'一'));
+    Check(set.contains(u'䀀'));
+    Check(set.contains(u'　'));
+    Check(set.contains(u' '));
+    Check(not set.contains(u'、'));
+    Check(not set.contains(u'a'));
+    Check(u16stream{u"中文 text"sv}.take_while(cjk) == u"中文");
+    Check(u16stream{u"　 text 　"sv}.trim(set | u16stream::whitespace_set()) == u"text");
+);
+
+// Sets that contain every wide character are searched through their complement.
+Test(
+    constexpr auto not_ascii = ~char_set<char16_t>::range(u'\0', u'\x7f');
+    constexpr auto text = u"abc中文\u00FFd\u0100"sv;
+    Check(not_ascii.contains(u'中'));
+    Check(not not_ascii.contains(u'a'));
+    Check(not_ascii.find_first(text) == 3);
+    Check(not_ascii.find_last(text) == 7);
+    Check(not_ascii.find_first_not(text.substr(3)) == 3);
+    Check(not_ascii.find_last_not(text) == 6);
+    Check(u16stream{text}.take_while(!pred::alpha) == u"");
+    Check(u16stream{text}.take_until(!pred::alpha) == u"abc");
+    Check(u32stream{U"\U0001F600\U0001F600 x"sv}.take_while(!pred::space) == U"\U0001F600\U0001F600");
+);
+
+static_assert(u16stream{u"中文中文中文中文中文中文中文中文\n"sv}.take_until(u'\n').size() == 16);
+static_assert(u32stream{U"a\U0001F600b"sv}.take_until(U'\U0001F600') == U"a");
+static_assert(u32stream{U"  hello\t"sv}.trim() == U"hello");
+static_assert(u32stream{U"hello world"sv}.take_until_any(U" \U0001F600"sv) == U"hello");
+
+static_assert(std::ranges::forward_range<decltype(stream{}.lines())>);
+static_assert(std::ranges::borrowed_range<decltype(stream{}.lines())>);
+static_assert(std::ranges::view<decltype(stream{}.lines())>);
+static_assert(std::ranges::empty(stream{empty}.lines()));
+
+Test(
+    auto lines = stream{"a\r\nb\n\r\nc\r"sv}.lines();
+    auto it = lines.begin();
+    Check(*it++ == "a");
+    Check(*it++ == "b");
+    Check(*it++ == "");
+    Check(*it++ == "c\r");
+    Check(it == lines.end());
+);
+
+Test(
+    auto lines = stream{"a\r\nb\nc\r\n"sv}.lines("\r\n");
+    auto it = lines.begin();
+    Check(*it++ == "a");
+    Check(*it++ == "b\nc");
+    Check(*it++ == "");
+    Check(it == lines.end());
+);
+
+Test(
+    auto lines = u16stream{u"foo\nbar"sv}.lines();
+    Check(std::ranges::distance(lines) == 2);
+    Check(*lines.begin() == u"foo");
+    Check(*std::ranges::next(lines.begin()) == u"bar");
+);
+
+Test(
+    stream s{"Host: example.com\r\nAccept:text/html \r\n\r\nX-Empty:\r\nbad line\r\n  Time : 12:30"sv};
+    auto kv = s.take_kv(':', "\r\n");
+    Check(kv and kv->key == "Host" and kv->value == "example.com");
+    kv = s.take_kv(':', "\r\n");
+    Check(kv and kv->key == "Accept" and kv->value == "text/html");
+    kv = s.take_kv(':', "\r\n");
+    Check(kv and kv->key == "X-Empty" and kv->value.empty());
+    Check(not s.take_kv(':', "\r\n"));
+    Check(s.starts_with("\nbad line"));
+    s.drop_until("  Time");
+    kv = s.take_kv(':', "\r\n");
+    Check(kv and kv->key == "Time" and kv->value == "12:30");
+    Check(s.empty() and not s.take_kv(':', "\r\n"));
+);
+
+static_assert(std::ranges::forward_range<decltype(stream{}.kv_pairs('=', " "))>);
+static_assert(std::ranges::borrowed_range<decltype(stream{}.kv_pairs('=', " "))>);
+static_assert(std::ranges::empty(stream{empty}.kv_pairs('=', " ")));
+
+Test(
+    auto pairs = stream{"level=info  msg=started flag id=42 url=/a?b=c "sv}.kv_pairs('=', " ");
+    auto it = pairs.begin();
+    Check((*it).key == "level" and (*it).value == "info");
+    ++it;
+    Check((*it).key == "msg" and (*it).value == "started");
+    ++it;
+    Check((*it).key == "id" and (*it).value == "42");
+    ++it;
+    Check((*it).key == "url" and (*it).value == "/a?b=c");
+    Check(++it == pairs.end());
+    Check(std::ranges::distance(stream{"a=1;b=2;c"sv}.kv_pairs('=', ";")) == 2);
+
+    // Empty keys must not make different pairs compare equal.
+    auto empty_keys = stream{"=1 =2"sv}.kv_pairs('=', " ");
+    Check(empty_keys.begin() != std::ranges::next(empty_keys.begin()));
+    Check(std::ranges::distance(empty_keys) == 2);
+    Check((*empty_keys.begin()).key.data() == (*empty_keys.begin()).value.data() - 1);
+
+    auto [key, value] = *u16stream{u"  ключ = значение\n"sv}.kv_pairs(u'=', u"\n").begin();
+    Check(key == u"ключ" and value == u"значение");
+);
+
+static_assert(std::ranges::forward_range<decltype(stream{}.rlines())>);
+static_assert(std::ranges::borrowed_range<decltype(stream{}.rlines())>);
+static_assert(std::ranges::view<decltype(stream{}.rlines())>);
+static_assert(std::ranges::empty(stream{empty}.rlines()));
+
+Test(
+    auto lines = stream{"a\r\nb\n\r\nc\r"sv}.rlines();
+    auto it = lines.begin();
+    Check(*it++ == "c\r");
+    Check(*it++ == "");
+    Check(*it++ == "b");
+    Check(*it++ == "a");
+    Check(it == lines.end());
+);
+
+Test(
+    auto lines = stream{"\r\na\n\n"sv}.rlines();
+    auto it = lines.begin();
+    Check(*it++ == "");
+    Check(*it++ == "");
+    Check(*it++ == "a");
+    Check(*it++ == "");
+    Check(it == lines.end());
+    Check(std::ranges::distance(stream{"ab"sv}.rlines(""sv)) == 2);
+    Check(*stream{"ab"sv}.rlines(""sv).begin() == "b");
+);
+
+Test(
+    auto lines = stream{"a\r\nb\nc\r\n"sv}.rlines("\r\n");
+    auto it = lines.begin();
+    Check(*it++ == "");
+    Check(*it++ == "b\nc");
+    Check(*it++ == "a");
+    Check(it == lines.end());
+);
+
+Test(
+    stream s{"/var/log/app.log"sv};
+    Check(s.take_back_until('.') == "log");
+    Check(s.drop_back().take_back_until('/') == "app");
+    Check(s.text() == "/var/log/");
+    Check(s.take_back_until_or_empty('x').empty());
+    Check(s.take_back_while('/') == "/");
+    Check(s.take_back_until("/"sv) == "log");
+    Check(s.take_back_until_or_empty("//"sv).empty());
+    Check(s.take_back_until("//"sv) == "/var/");
+    Check(s.empty());
+);
+
+Test(
+    stream s{"key = value 42   "sv};
+    Check(s.take_back_while(pred::space) == "   ");
+    Check(s.take_back_while(pred::digit) == "42");
+    Check(s.take_back_while_or_empty(pred::digit).empty());
+    Check(s.take_back_until(pred::space) == "");
+    Check(s.drop_back(1).take_back_until_any(" ="sv) == "value");
+    Check(s.take_back_while_any(" ="sv) == " = ");
+    Check(s.take_back_until_any_or_empty(" ="sv).empty());
+    Check(s.take_back_while_any_or_empty("yek"sv).empty());
+    Check(s.text() == "key");
+    Check(s.take_back(2) == "ey");
+    Check(s.take_back(5) == "k");
+);
+
+Test(
+    constexpr auto text = "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz!!!"sv;
+    stream s{text};
+    Check(s.take_back_until(!pred::alnum).empty());
+    Check(s.drop_back_while(pred::is('!')).take_back_while(pred::alpha).size() == 26);
+    Check(s.drop_back_while(pred::digit).take_back_until_or_empty(pred::digit).empty());
+    Check(s.take_back_while(pred::alpha).size() == 52);
+    Check(s.empty());
+    Check(stream{text}.drop_back_until(char_set<char>{"0"sv}).text() == text.substr(0, 53));
+    Check(stream{text}.drop_back_while(~char_set<char>{"9"sv}).text() == text.substr(0, 62));
+    Check(stream{text}.drop_back_until_or_empty(char_set<char>{"?"sv}).text() == text);
+    Check(u16stream{u"中文 text"sv}.take_back_while(!pred::space) == u"text");
+    Check(u32stream{U"a\U0001F600b"sv}.take_back_until(U'\U0001F600') == U"b");
+);
+
+static_assert(std::ranges::borrowed_range<decltype(stream{}.chunks(1))>);
+static_assert(std::ranges::empty(stream{empty}.chunks(4)));
+
+Test(
+    auto chunks = stream{multiline}.chunks(4);
+    auto it = chunks.begin();
+    Check(*it++ == "hello\n");
+    Check(*it++ == "world\n");
+    Check(*it++ == "\nfoo\n");
+    Check(*it++ == "bar\n");
+    Check(*it++ == "baz\n");
+    Check(it == chunks.end());
+);
+
+Test(
+    auto chunks = stream{words}.chunks(100, ' ');
+    Check(std::ranges::distance(chunks) == 1);
+    Check(*chunks.begin() == words.text());
+    Check(std::ranges::distance(stream{words}.chunks(0, ' ')) == 5);
+);
+
+Test(
+    std::array<std::string_view, 3> fields{};
+    stream s{"a,,bc,d,"sv};
+    Check(s.split_into(fields, ',') == 3);
+    Check(fields[0] == "a" and fields[1] == "" and fields[2] == "bc");
+    Check(s == "d,");
+    Check(s.split_into(fields, ',') == 1);
+    Check(fields[0] == "d");
+    Check(s.empty());
+    Check(s.split_into(fields, ',') == 0);
+    Check(stream{"x"sv}.split_into(std::span<std::string_view>{}, ',') == 0);
+);
+
+Test(
+    std::array<std::string_view, 8> fields{};
+    stream s{"1700000000 GET /index.html\t200\n"sv};
+    Check(s.split_into(fields, char_set<char>{" \t\n"sv}) == 4);
+    Check(fields[0] == "1700000000" and fields[1] == "GET");
+    Check(fields[2] == "/index.html" and fields[3] == "200");
+    Check(s.empty());
+
+    std::array<std::u16string_view, 2> wide{};
+    u16stream w{u"Ω→Ψ→"sv};
+    Check(w.split_into(wide, u'→') == 2);
+    Check(wide[0] == u"Ω" and wide[1] == u"Ψ");
+);
+
+Test(
+    stream s{"123 -42 +7 0x1f 99999999999 4294967295 -2147483648 x"sv};
+    Check(s.take_int() == 123);
+    Check(s.consume(' '));
+    Check(s.take_int() == -42);
+    Check(s.consume(' '));
+    Check(not s.take_int());
+    Check(s.consume('+'));
+    Check(s.take_uint() == 7u);
+    Check(s.consume(' '));
+    Check(s.take_uint() == 0u);
+    Check(s.consume('x'));
+    Check(s.take_uint(16) == 0x1fu);
+    Check(s.consume(' '));
+    Check(not s.take_int());
+    Check(s.starts_with("99999999999"));
+    Check(s.take_int<long long>() == 99999999999);
+    Check(s.consume(' '));
+    Check(s.take_uint<std::uint32_t>() == 4294967295u);
+    Check(s.consume(' '));
+    Check(s.take_int<std::int32_t>() == -2147483648);
+    Check(s.consume(' '));
+    Check(not s.take_int());
+    Check(not s.take_uint());
+    Check(s == "x");
+);
+
+Test(
+    std::string_view str;
+    stream s{R"(""x" 'ab' <<c<<<<)"sv};
+    Check(s.take_delimited('"', str));
+    Check(str.empty());
+    Check(s == R"(x" 'ab' <<c<<<<)");
+    Check(not s.take_delimited('"', str));
+    Check(s.consume('x'));
+    Check(not s.take_delimited('"', str));
+    Check(s.consume('"'));
+    Check(s.consume(' '));
+    Check(s.take_delimited_any(str, "\"'"));
+    Check(str == "ab");
+    Check(s.consume(' '));
+    Check(s.take_delimited(str, "<<"));
+    Check(str == "c");
+    Check(s == "<<");
+    Check(not s.take_delimited(str, "<<"));
+    Check(s.take_delimited_any(str, "<"));
+    Check(str.empty());
+    Check(s.empty());
+);
+
+Test(
+    stream s{R"("a\"b\\" "plain" "x)"sv};
+    Check(s.take_quoted() == R"(a\"b\\)");
+    Check(s.consume(' '));
+
+    std::array<char, 8> buf{};
+    auto plain = s.take_quoted(buf);
+    Check(plain == "plain");
+    Check(plain->data() != buf.data());
+    Check(s.consume(' '));
+    Check(not s.take_quoted());
+    Check(s == R"("x)");
+
+    stream t{R"("a\"b\\c" rest)"sv};
+    auto unescaped = t.take_quoted(buf);
+    Check(unescaped == R"(a"b\c)");
+    Check(unescaped->data() == buf.data());
+    Check(t == " rest");
+    Check(not t.take_quoted(buf));
+);
+
+Test(
+    std::array<char, 4> buf{};
+    stream s{R"("say ""hi""",'it''s',"")"sv};
+    Check(not s.take_quoted(buf, '"', '"'));
+    Check(s.starts_with('"'));
+    Check(s.take_quoted('"', '"') == R"(say ""hi"")");
+    Check(s.consume(','));
+    Check(s.take_quoted(buf, '\'', '\'') == "it's");
+    Check(s.consume(','));
+    Check(s.take_quoted(buf, '"', '"') == "");
+    Check(s.empty());
+
+    Check(not stream{R"("abc\")"sv}.take_quoted());
+    Check(stream{R"("abc\\")"sv}.take_quoted() == R"(abc\\)");
+    Check(u16stream{u"«a»b»"sv}.take_quoted(u'«', u'»') == std::nullopt);
+    Check(u16stream{u"»a\\»b»"sv}.take_quoted(u'»') == u"a\\»b");
+);
+
+static_assert(stream{"-"sv}.take_int() == std::nullopt);
+static_assert(stream{"-128"sv}.take_int<std::int8_t>() == -128);
+static_assert(stream{"-129"sv}.take_int<std::int8_t>() == std::nullopt);
+static_assert(stream{"255"sv}.take_uint<std::uint8_t>() == 255);
+static_assert(stream{"256"sv}.take_uint<std::uint8_t>() == std::nullopt);
+static_assert(stream{"zz"sv}.take_uint(36) == 36u * 36 - 1);
+static_assert(stream{"12"sv}.take_uint(37) == std::nullopt);
+static_assert(u16stream{u"1234567890"sv}.take_uint<std::uint64_t>() == 1234567890);
+static_assert(u32stream{U"-17"sv}.take_int() == -17);
+
+Test(
+    u8stream s{u8"aé€😀"sv};
+    Check(s.validate_utf8());
+    Check(s.take_codepoint() == U'a');
+    Check(s.take_codepoint() == U'é');
+    Check(s.take_codepoint() == U'€');
+    Check(s.take_codepoint() == U'😀');
+    Check(s.empty());
+    Check(not s.take_codepoint());
+);
+
+static_assert(stream{"\xC0\x80"sv}.take_codepoint() == std::nullopt);
+static_assert(stream{"\xE0\x80\x80"sv}.take_codepoint() == std::nullopt);
+static_assert(stream{"\xED\xA0\x80"sv}.take_codepoint() == std::nullopt);
+static_assert(stream{"\xF4\x90\x80\x80"sv}.take_codepoint() == std::nullopt);
+static_assert(stream{"\xF4\x8F\xBF\xBF"sv}.take_codepoint() == U'\U0010FFFF');
+static_assert(stream{"\xE2\x82"sv}.take_codepoint() == std::nullopt);
+static_assert(stream{"\x80"sv}.take_codepoint() == std::nullopt);
+static_assert(stream{"\xFF"sv}.take_codepoint() == std::nullopt);
+static_assert(not stream{"abc\xE2\x82"sv}.validate_utf8());
+static_assert(not stream{"abc\x80" "def"sv}.validate_utf8());
+static_assert(stream{"abc\xE2\x82\xAC"sv}.validate_utf8());
+static_assert(stream{empty}.validate_utf8());
+
+Test(
+    stream s{"héllo wörld\xC0\x80"sv};
+    Check(s.take_codepoints(0).empty());
+    Check(s.take_codepoints(2) == "hé");
+    Check(s.take_codepoints(4) == "llo ");
+    Check(s.take_codepoints(100) == "wörld");
+    Check(s == "\xC0\x80");
+    Check(s.take_codepoints(1).empty());
+);
+
+Test(
+    stream s{"naïve café"sv};
+    Check(s.take_while_cp(pred::digit).empty());
+    Check(s.take_while_cp(pred::alpha) == "na");
+    Check(s.take_while_cp([](char32_t c) { return c != U' '; }) == "ïve");
+    Check(s.take_while_cp(pred::space) == " ");
+    Check(s.take_while_cp(pred::alpha | pred::range(0x80, 0x10'FFFF)) == "café");
+    Check(s.empty());
+
+    stream t{"abc\xC3"sv};
+    Check(t.take_while_cp([](char32_t) { return true; }) == "abc");
+    Check(t == "\xC3");
+);
+
+Test(
+    constexpr auto text = "foo\nbar baz\r\n\nqux"sv;
+    line_index idx{text};
+    Check(idx.locate(0) == (source_position{1, 1}));
+    Check(idx.lines_scanned() == 1);
+    Check(idx.locate(2) == (source_position{1, 3}));
+    Check(idx.locate(3) == (source_position{1, 4}));
+    Check(idx.locate(8) == (source_position{2, 5}));
+    Check(idx.locate(13) == (source_position{3, 1}));
+    Check(idx.locate(text.size()) == (source_position{4, 4}));
+    Check(idx.locate(1'000) == (source_position{4, 4}));
+    Check(idx.locate(4) == (source_position{2, 1}));
+    Check(idx.line(1) == "foo");
+    Check(idx.line(2) == "bar baz\r");
+    Check(idx.line(3) == "");
+    Check(idx.line(4) == "qux");
+    Check(idx.line(5).empty());
+    Check(idx.line(0).empty());
+
+    stream s{text};
+    s.drop_until("baz");
+    Check(idx.locate(s) == (source_position{2, 5}));
+    Check(idx.locate(s.text().substr(5)) == (source_position{3, 1}));
+);
+
+Test(
+    u16line_index idx{u"a\n"sv};
+    Check(idx.line(2).empty());
+    Check(idx.lines_scanned() == 2);
+    Check(idx.locate(2) == (source_position{2, 1}));
+    Check(line_index{}.locate(0) == (source_position{1, 1}));
+);
+
+Test(
+    arena a{8};
+    std::string_view kept[3];
+    {
+        std::string text = "alpha,beta,gamma";
+        stream s{text};
+        for (auto& k : kept) {
+            k = a.copy(s.take_until(','));
+            s.drop();
+        }
+    }
+
+    Check(kept[0] == "alpha" and kept[1] == "beta" and kept[2] == "gamma");
+    Check(a.size() == 14);
+    Check(a.capacity() == 24);
+    Check(a.copy(""sv).empty());
+
+    auto big = a.copy("this is longer than a chunk"sv);
+    Check(big == "this is longer than a chunk");
+    Check(a.capacity() == 24 + big.size());
+    Check(a.copy(stream{"ab"sv}.text()) == "ab");
+    Check(kept[2] == "gamma");
+
+    auto first = kept[0].data();
+    a.reset();
+    Check(a.size() == 0);
+    Check(a.copy("x"sv).data() == first);
+    Check(a.copy("this is also longer than a chunk"sv).size() == 32);
+    Check(a.capacity() == 24 + 27 + 32);
+    Check(a.copy("a shorter, but still long text"sv).size() == 30);
+    Check(a.capacity() == 24 + 27 + 32 + 30);
+    Check(a.copy("fits in the old one"sv).size() == 19);
+    Check(a.capacity() == 24 + 27 + 32 + 30);
+
+    arena b = std::move(a);
+    Check(a.capacity() == 0);
+    Check(b.copy("y"sv) == "y");
+    b.release();
+    Check(b.capacity() == 0 and b.size() == 0);
+);
+
+Test(
+    u16arena a;
+    Check(a.capacity() == 0);
+    Check(a.copy(u"€"sv) == u"€");
+    Check(a.capacity() == u16arena::default_chunk_size);
+);
+
+Test(
+    symbol_table t;
+    Check(t.empty() and not t.find("x"));
+    Check(t.intern("if") == 0);
+    Check(t.intern("else") == 1);
+    Check(t.intern("if") == 0);
+    Check(t.intern("") == 2);
+    Check(t.find("") == 2u);
+
+    std::string names[300];
+    for (int i = 0; i < 300; ++i) {
+        names[i] = "sym";
+        for (int n = i; n; n /= 10) names[i] += char('0' + n % 10);
+        Check(t.intern(names[i]) == symbol_id(i + 3));
+    }
+
+    Check(t.size() == 303);
+    for (int i = 0; i < 300; ++i) Check(t.find(names[i]) == symbol_id(i + 3));
+    Check(t.name(1) == "else" and t.name(302) == names[299]);
+    Check(not t.contains("sym10") and t.contains("sym01"));
+
+    t.clear();
+    Check(t.empty() and not t.find("if"));
+    Check(t.intern("else") == 0);
+);
+
+Test(
+    symbol_table t;
+    auto kw_if = t.intern("if");
+    auto kw_int = t.intern("int");
+    stream s{"int x; if_y if(z)"sv};
+    Check(s.take_symbol(t) == kw_int);
+    Check(s.consume(' '));
+    Check(not s.take_symbol(t));
+    Check(s.starts_with("x;"));
+    s.drop(3);
+    Check(not s.take_symbol(t));
+    Check(s.take_symbol(t, pred::lower) == kw_if);
+    Check(s == "_y if(z)");
+    s.drop(3);
+    Check(s.take_symbol(t) == kw_if);
+    Check(not s.take_symbol(t));
+    Check(s == "(z)");
+
+    u16symbol_table w;
+    Check(w.intern(u"λ") == 0);
+    Check(u16stream{u"λ+"sv}.take_symbol(w, [](char16_t c) { return c != u'+'; }) == 0u);
+);
+
+Test(
+    auto find = [](std::initializer_list<std::string_view> needles, std::string_view text) {
+        auto m = multi_searcher{needles}.find(text);
+        return std::pair{m.pos, m.needle};
+    };
+
+    Check(find({"\r\n", "; ", "-->"}, "a; b\r\nc") == std::pair(1uz, 1uz));
+    Check(find({"\r\n", "; ", "-->"}, "a -> b --> c; d") == std::pair(7uz, 2uz));
+    Check(find({"\r\n", "; ", "-->"}, "none").first == std::string_view::npos);
+    Check(find({"abc", "ab"}, "xabcd") == std::pair(1uz, 0uz));
+    Check(find({"ab", "abc"}, "xabcd") == std::pair(1uz, 0uz));
+    Check(find({"bcd", "abcde"}, "abcdx") == std::pair(1uz, 0uz));
+    Check(find({"bcd", "abcde"}, "abcde") == std::pair(0uz, 1uz));
+    Check(find({"he", "she", "his", "hers"}, "ushers") == std::pair(1uz, 1uz));
+    Check(find({"x", ""}, "ax") == std::pair(0uz, 1uz));
+    Check(find({"a", ""}, "ax") == std::pair(0uz, 0uz));
+    Check(find({}, "abc").first == std::string_view::npos);
+
+    std::string words[100];
+    std::string_view needles[100];
+    for (int i = 0; i < 100; ++i) {
+        words[i] = "w";
+        for (int n = i; n; n /= 10) words[i] += char('0' + n % 10);
+        words[i] += ';';
+        needles[i] = words[i];
+    }
+
+    multi_searcher many{needles};
+    Check(many.size() == 100);
+    Check(many.find("a w7; w38;").pos == 2 and many.find("a w7; w38;").needle == 7);
+    Check(many.find("a w7 w38").pos == std::string_view::npos);
+);
+
+Test(
+    multi_searcher m{"\r\n", "; ", "-->"};
+    stream s{"GET / HTTP/1.1\r\nHost: x; y-->z"sv};
+    auto [line, crlf] = s.take_until(m);
+    Check(line == "GET / HTTP/1.1" and crlf == 0u);
+    s.drop(2);
+    Check(s.take_until(m).needle == 1u);
+    s.drop(2).drop_until(m);
+    Check(s == "-->z");
+    s.drop(3);
+    auto [rest, none] = s.take_until_or_empty(m);
+    Check(rest.empty() and not none and s == "z");
+    Check(s.take_until(m).text == "z" and s.empty());
+
+    u16multi_searcher w{u"✓", u"wor", u"Ω"};
+    Check(u16stream{u"hello Ωworld ✓"sv}.take_until(w).text == u"hello ");
+);
+
+using test_lexer = lexer<
+    skip<pred::space, pred::space>,
+    skip<pred::is('#'), !pred::is('\n')>,
+    literal<"if", "if">,
+    rule<"ident", pred::alpha | pred::is('_'), pred::alnum | pred::is('_')>,
+    rule<"number", pred::digit, pred::digit>,
+    literal<"eq", "==">,
+    literal<"assign", "=">,
+    rule<"op", pred::any_of("+-*/")>
+>;
+
+static_assert(test_lexer::kind_of<"ident"> == 3);
+
+Test(
+    stream s{"if iffy == 42 # comment\n  x_1=y+-7"sv};
+    auto tok = test_lexer::next(s);
+    Check(tok and tok->is<"if">() and tok->text == "if");
+    tok = test_lexer::next(s);
+    Check(tok and tok->is<"ident">() and tok->text == "iffy");
+    tok = test_lexer::next(s);
+    Check(tok and tok->name() == "eq");
+    tok = test_lexer::next(s);
+    Check(tok and tok->is<"number">() and tok->text == "42");
+
+    std::array<test_lexer::token, 5> buf{};
+    Check(test_lexer::tokenize(s, std::span{buf}) == 5);
+    Check(buf[0].is<"ident">() and buf[0].text == "x_1");
+    Check(buf[1].is<"assign">());
+    Check(buf[2].text == "y");
+    Check(buf[3].text == "+" and buf[4].text == "-");
+    Check(test_lexer::tokenize(s, std::span{buf}) == 1);
+    Check(buf[0].is<"number">() and buf[0].text == "7");
+    Check(s.empty());
+    Check(not test_lexer::next(s));
+);
+
+Test(
+    stream s{"a $b"sv};
+    Check(test_lexer::next(s)->text == "a");
+    Check(not test_lexer::next(s));
+    Check(s == "$b");
+
+    u16stream w{u"ab Ω1"sv};
+    using wide_lexer = u16lexer<skip<pred::blank>, rule<"ident", pred::alpha | pred::range(u'Ͱ', u'Ͽ'), pred::alnum>>;
+    Check(wide_lexer::next(w)->text == u"ab");
+    Check(wide_lexer::next(w)->text == u"Ω1");
+    Check(w.empty());
+);
+
+static_assert(stats::name(stats::family::take_until) == "take_until");
+static_assert(stats::name(stats::family::take_delimited) == "take_delimited");